@@ -0,0 +1,53 @@
+#version 450 core
+#extension GL_ARB_separate_shader_objects : enable
+
+// Positions and normals come already skinned from skinning.comp, pulled by instance so one instanced draw renders the whole crowd
+
+layout(location = 2) in vec2 uvs;
+
+layout(location = 0) out vec3 position_out;
+layout(location = 1) out vec3 normal_out;
+layout(location = 2) out vec2 uv_out;
+layout(location = 3) out vec3 color_out;
+
+layout(binding = 0) uniform UBO
+{
+	mat4 model;
+	mat4 view_projection;
+}ubo;
+
+layout(std430, binding = 2) readonly buffer Skinned
+{
+	float skinned[];        // Position xyz then normal xyz, vertex_count vertices per instance
+};
+
+struct Instance
+{
+	mat4 model;
+	uint palette_offset;        // Only read by skinning.comp
+};
+
+layout(std430, binding = 3) readonly buffer Instances
+{
+	Instance instances[];
+};
+
+layout(push_constant) uniform Layout
+{
+	uint vertex_count;
+}layout_info;
+
+void main()
+{
+	uint instance = uint(gl_InstanceIndex);
+	uint index    = (instance * layout_info.vertex_count + uint(gl_VertexIndex)) * 6;
+	vec3 position = vec3(skinned[index + 0], skinned[index + 1], skinned[index + 2]);
+	vec3 normal   = vec3(skinned[index + 3], skinned[index + 4], skinned[index + 5]);
+	mat4 model    = ubo.model * instances[instance].model;
+
+	normal_out          = mat3(transpose(inverse(model))) * normal;
+	position_out        = vec3(model * vec4(position, 1.0));
+	gl_Position         = ubo.view_projection * vec4(position_out, 1.0);
+	uv_out              = uvs;
+	color_out           = normal;
+}
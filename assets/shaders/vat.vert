@@ -0,0 +1,54 @@
+#version 450 core
+#extension GL_ARB_separate_shader_objects : enable
+
+// Plays back astro boy from the vertex animation texture, see vertex_animation_texture.hpp for its layout.
+// Nothing is skinned, every vertex is two frames of two texel fetches blended by the time between them
+
+layout(location = 2) in vec2 uvs;
+layout(location = 4) in vec4 placement;        // Per instance, xyz offset in model space and w seconds into the clip at time 0
+
+layout(location = 0) out vec3 position_out;
+layout(location = 1) out vec3 normal_out;
+layout(location = 2) out vec2 uv_out;
+layout(location = 3) out vec3 color_out;
+
+layout(binding = 0) uniform UBO
+{
+	mat4  model;
+	mat4  view_projection;
+	float time;
+}ubo;
+
+layout(binding = 4) uniform sampler2D vertex_animation;
+
+layout(push_constant) uniform Layout
+{
+	uint  vertex_count;
+	uint  width;
+	uint  frame_count;
+	float frames_per_second;
+}layout_info;
+
+vec4 fetch(uint a_frame, uint a_texel)
+{
+	uint rows_per_frame = (layout_info.vertex_count * 2 + layout_info.width - 1) / layout_info.width;
+	return texelFetch(vertex_animation, ivec2(a_texel % layout_info.width, a_frame * rows_per_frame + a_texel / layout_info.width), 0);
+}
+
+void main()
+{
+	float frame = mod((ubo.time + placement.w) * layout_info.frames_per_second, float(layout_info.frame_count));
+	uint  first = min(uint(frame), layout_info.frame_count - 1);
+	uint  next  = (first + 1) % layout_info.frame_count;
+	float t     = frame - float(first);
+
+	uint texel    = uint(gl_VertexIndex) * 2;
+	vec3 position = mix(fetch(first, texel).xyz, fetch(next, texel).xyz, t) + placement.xyz;
+	vec3 normal   = normalize(mix(fetch(first, texel + 1).xyz, fetch(next, texel + 1).xyz, t));
+
+	normal_out          = mat3(transpose(inverse(ubo.model))) * normal;
+	position_out        = vec3(ubo.model * vec4(position, 1.0));
+	gl_Position         = ubo.view_projection * vec4(position_out, 1.0);
+	uv_out              = uvs;
+	color_out           = normal;
+}
@@ -0,0 +1,488 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "animation/array_view.hpp"
+#include "animation/compressed_clip.hpp"
+#include "animation/skeleton.hpp"
+#include <bitset>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <foundation/rortypes.hpp>
+#include <profiling/rorlog.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+/*  AnimationAsset usage
+ *  Binary container for one skeleton and any number of compressed clips, written offline with
+ *  write_animation_asset() by the animation converter. At runtime load() maps the file and all
+ *  views point straight into the mapping, nothing is parsed or copied so load time only depends
+ *  on the page faults of what actually gets sampled.
+ *  Layout is header, clip table, then 16 byte aligned sections. All sections are little endian
+ *  and use the in memory layout of the runtime types which is pinned by the static_asserts below.
+ *  Bump animation_asset_version whenever any of those types or the header change.
+ */
+
+namespace ror
+{
+constexpr uint32_t animation_asset_magic     = 0x4E414556;        // "VEAN" in little endian
+constexpr uint32_t animation_asset_version   = 1;
+constexpr uint32_t animation_asset_alignment = 16;
+
+static_assert(sizeof(Matrix4f) == 16 * sizeof(float32_t), "Matrix4f layout changed, bump animation_asset_version");
+static_assert(sizeof(CompressedTrack) == 56, "CompressedTrack layout changed, bump animation_asset_version");
+static_assert(sizeof(CompressedKey) == 24, "CompressedKey layout changed, bump animation_asset_version");
+
+struct AnimationAssetSection
+{
+	uint32_t m_offset;        // Byte offset from start of the file
+	uint32_t m_count;         // Number of elements, not bytes
+};
+
+struct AnimationAssetClip
+{
+	AnimationAssetSection m_times;
+	AnimationAssetSection m_animated_mask;
+	AnimationAssetSection m_tracks;
+	AnimationAssetSection m_frames;
+	AnimationAssetSection m_keys;
+};
+
+struct AnimationAssetHeader
+{
+	uint32_t              m_magic;                 // Always animation_asset_magic
+	uint32_t              m_version;               // Always animation_asset_version
+	uint32_t              m_size;                  // Size of the whole file in bytes
+	uint32_t              m_clip_count;            // Number of AnimationAssetClip entries after the header
+	AnimationAssetSection m_parents;               // int32_t per node
+	AnimationAssetSection m_bind_locals;           // Matrix4f per node
+	AnimationAssetSection m_joints;                // uint32_t per joint
+	AnimationAssetSection m_skinning_binds;        // Matrix4f per joint
+	AnimationAssetSection m_level_offsets;         // uint32_t per level + 1
+};
+
+class AnimationAsset final
+{
+  public:
+	FORCE_INLINE AnimationAsset()                                  = default;        //! Default constructor
+	FORCE_INLINE AnimationAsset(const AnimationAsset &a_other)     = delete;         //! Copy constructor
+	FORCE_INLINE AnimationAsset &operator=(const AnimationAsset &) = delete;         //! Copy assignment operator
+
+	FORCE_INLINE AnimationAsset(AnimationAsset &&a_other) noexcept
+	{
+		*this = std::move(a_other);
+	}
+
+	FORCE_INLINE AnimationAsset &operator=(AnimationAsset &&a_other) noexcept
+	{
+		if (this != &a_other)
+		{
+			this->unload();
+
+			std::swap(this->m_data, a_other.m_data);
+			std::swap(this->m_size, a_other.m_size);
+			std::swap(this->m_skeleton, a_other.m_skeleton);
+			std::swap(this->m_clips, a_other.m_clips);
+#if defined(_WIN32)
+			std::swap(this->m_file, a_other.m_file);
+			std::swap(this->m_mapping, a_other.m_mapping);
+#endif
+		}
+
+		return *this;
+	}
+
+	FORCE_INLINE ~AnimationAsset() noexcept
+	{
+		this->unload();
+	}
+
+	bool load(const std::filesystem::path &a_file_path)
+	{
+		this->unload();
+
+		if (!this->map(a_file_path))
+		{
+			ror::log_critical("Can't map animation asset {}", a_file_path.string());
+			return false;
+		}
+
+		if (!this->validate())
+		{
+			ror::log_critical("Animation asset {} is corrupt or has the wrong version", a_file_path.string());
+			this->unload();
+			return false;
+		}
+
+		const AnimationAssetHeader *header = this->header();
+
+		this->m_skeleton = SkeletonView{this->section<int32_t>(header->m_parents),
+		                                this->section<Matrix4f>(header->m_bind_locals),
+		                                this->section<uint32_t>(header->m_joints),
+		                                this->section<Matrix4f>(header->m_skinning_binds),
+		                                this->section<uint32_t>(header->m_level_offsets)};
+
+		const AnimationAssetClip *clips = reinterpret_cast<const AnimationAssetClip *>(this->m_data + sizeof(AnimationAssetHeader));
+
+		this->m_clips.reserve(header->m_clip_count);
+		for (uint32_t i = 0; i < header->m_clip_count; ++i)
+			this->m_clips.push_back(CompressedClipView{this->section<float32_t>(clips[i].m_times),
+			                                           this->section<uint64_t>(clips[i].m_animated_mask),
+			                                           this->section<CompressedTrack>(clips[i].m_tracks),
+			                                           this->section<uint16_t>(clips[i].m_frames),
+			                                           this->section<CompressedKey>(clips[i].m_keys)});
+
+		return true;
+	}
+
+	void unload()
+	{
+		if (this->m_data)
+		{
+#if defined(_WIN32)
+			UnmapViewOfFile(this->m_data);
+			CloseHandle(this->m_mapping);
+			CloseHandle(this->m_file);
+			this->m_mapping = nullptr;
+			this->m_file    = INVALID_HANDLE_VALUE;
+#else
+			munmap(const_cast<uint8_t *>(this->m_data), this->m_size);
+#endif
+		}
+
+		this->m_data     = nullptr;
+		this->m_size     = 0;
+		this->m_skeleton = SkeletonView{};
+		this->m_clips.clear();
+	}
+
+	bool loaded() const
+	{
+		return this->m_data != nullptr;
+	}
+
+	const SkeletonView &skeleton() const
+	{
+		return this->m_skeleton;
+	}
+
+	uint32_t clip_count() const
+	{
+		return static_cast<uint32_t>(this->m_clips.size());
+	}
+
+	const CompressedClipView &clip(uint32_t a_index) const
+	{
+		assert(a_index < this->m_clips.size() && "Clip index out of range");
+		return this->m_clips[a_index];
+	}
+
+  private:
+	const AnimationAssetHeader *header() const
+	{
+		return reinterpret_cast<const AnimationAssetHeader *>(this->m_data);
+	}
+
+	template <class _type>
+	ArrayView<_type> section(const AnimationAssetSection &a_section) const
+	{
+		return ArrayView<_type>{reinterpret_cast<const _type *>(this->m_data + a_section.m_offset), a_section.m_count};
+	}
+
+	template <class _type>
+	bool section_valid(const AnimationAssetSection &a_section) const
+	{
+		return a_section.m_offset % animation_asset_alignment == 0 &&
+		       static_cast<size_t>(a_section.m_offset) + static_cast<size_t>(a_section.m_count) * sizeof(_type) <= this->m_size;
+	}
+
+	bool validate() const
+	{
+		if (this->m_size < sizeof(AnimationAssetHeader))
+			return false;
+
+		const AnimationAssetHeader *header = this->header();
+
+		if (header->m_magic != animation_asset_magic || header->m_version != animation_asset_version || header->m_size != this->m_size)
+			return false;
+
+		if (sizeof(AnimationAssetHeader) + static_cast<size_t>(header->m_clip_count) * sizeof(AnimationAssetClip) > this->m_size)
+			return false;
+
+		bool valid = this->section_valid<int32_t>(header->m_parents) && this->section_valid<Matrix4f>(header->m_bind_locals) &&
+		             this->section_valid<uint32_t>(header->m_joints) && this->section_valid<Matrix4f>(header->m_skinning_binds) &&
+		             this->section_valid<uint32_t>(header->m_level_offsets);
+
+		valid = valid && header->m_bind_locals.m_count == header->m_parents.m_count && header->m_skinning_binds.m_count == header->m_joints.m_count && header->m_level_offsets.m_count >= 2;
+		valid = valid && this->skeleton_valid(*header);
+
+		const AnimationAssetClip *clips = reinterpret_cast<const AnimationAssetClip *>(this->m_data + sizeof(AnimationAssetHeader));
+		for (uint32_t i = 0; valid && i < header->m_clip_count; ++i)
+			valid = this->section_valid<float32_t>(clips[i].m_times) && this->section_valid<uint64_t>(clips[i].m_animated_mask) &&
+			        this->section_valid<CompressedTrack>(clips[i].m_tracks) && this->section_valid<uint16_t>(clips[i].m_frames) &&
+			        this->section_valid<CompressedKey>(clips[i].m_keys) && clips[i].m_frames.m_count == clips[i].m_keys.m_count &&
+			        this->clip_valid(clips[i], header->m_parents.m_count);
+
+		return valid;
+	}
+
+	// Everything update_worlds and update_palette index with unchecked, sections must already be in range
+	bool skeleton_valid(const AnimationAssetHeader &a_header) const
+	{
+		const uint32_t  node_count    = a_header.m_parents.m_count;
+		const int32_t  *parents       = this->section<int32_t>(a_header.m_parents).data();
+		const uint32_t *joints        = this->section<uint32_t>(a_header.m_joints).data();
+		const uint32_t *level_offsets = this->section<uint32_t>(a_header.m_level_offsets).data();
+		const uint32_t  level_count   = a_header.m_level_offsets.m_count - 1;
+
+		if (level_offsets[0] != 0 || level_offsets[level_count] != node_count)
+			return false;
+
+		for (uint32_t level = 0; level < level_count; ++level)
+			if (level_offsets[level] >= level_offsets[level + 1])
+				return false;
+
+		// Roots are exactly the first level, every other parent is in an earlier level than its child
+		for (uint32_t i = 0; i < level_offsets[1]; ++i)
+			if (parents[i] != -1)
+				return false;
+
+		for (uint32_t level = 1; level < level_count; ++level)
+			for (uint32_t i = level_offsets[level]; i < level_offsets[level + 1]; ++i)
+				if (parents[i] < 0 || static_cast<uint32_t>(parents[i]) >= level_offsets[level])
+					return false;
+
+		for (uint32_t i = 0; i < a_header.m_joints.m_count; ++i)
+			if (joints[i] >= node_count)
+				return false;
+
+		return true;
+	}
+
+	bool clip_valid(const AnimationAssetClip &a_clip, uint32_t a_node_count) const
+	{
+		const float32_t       *times  = this->section<float32_t>(a_clip.m_times).data();
+		const uint64_t        *mask   = this->section<uint64_t>(a_clip.m_animated_mask).data();
+		const CompressedTrack *tracks = this->section<CompressedTrack>(a_clip.m_tracks).data();
+		const uint16_t        *frames = this->section<uint16_t>(a_clip.m_frames).data();
+
+		if (a_clip.m_animated_mask.m_count != (a_node_count + 63) / 64)
+			return false;
+
+		// ClipPlayer interpolates between pairs of keys, so there have to be at least two and time has to move forward
+		if (a_clip.m_times.m_count < 2)
+			return false;
+
+		for (uint32_t i = 1; i < a_clip.m_times.m_count; ++i)
+			if (!(times[i] > times[i - 1]))
+				return false;
+
+		uint32_t animated = 0;
+		for (uint32_t i = 0; i < a_clip.m_animated_mask.m_count; ++i)
+			animated += static_cast<uint32_t>(std::bitset<64>(mask[i]).count());
+
+		// Bits past the last node would be counted without having a node to animate
+		if (a_node_count % 64 != 0 && (mask[a_clip.m_animated_mask.m_count - 1] >> (a_node_count % 64)) != 0)
+			return false;
+
+		if (animated != a_clip.m_tracks.m_count)
+			return false;
+
+		for (uint32_t i = 0; i < a_clip.m_tracks.m_count; ++i)
+		{
+			if (tracks[i].m_key_count == 0 || static_cast<uint64_t>(tracks[i].m_first_key) + tracks[i].m_key_count > a_clip.m_keys.m_count)
+				return false;
+
+			// sample_track() starts every track at frame 0 and divides by the gap between kept frames
+			const uint16_t *track_frames = frames + tracks[i].m_first_key;
+			if (track_frames[0] != 0)
+				return false;
+
+			for (uint32_t k = 1; k < tracks[i].m_key_count; ++k)
+				if (track_frames[k] <= track_frames[k - 1] || track_frames[k] >= a_clip.m_times.m_count)
+					return false;
+		}
+
+		return true;
+	}
+
+	bool map(const std::filesystem::path &a_file_path)
+	{
+#if defined(_WIN32)
+		this->m_file = CreateFileW(a_file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (this->m_file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(this->m_file, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(this->m_file);
+			this->m_file = INVALID_HANDLE_VALUE;
+			return false;
+		}
+
+		this->m_mapping = CreateFileMappingW(this->m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!this->m_mapping)
+		{
+			CloseHandle(this->m_file);
+			this->m_file = INVALID_HANDLE_VALUE;
+			return false;
+		}
+
+		this->m_data = static_cast<const uint8_t *>(MapViewOfFile(this->m_mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!this->m_data)
+		{
+			CloseHandle(this->m_mapping);
+			CloseHandle(this->m_file);
+			this->m_mapping = nullptr;
+			this->m_file    = INVALID_HANDLE_VALUE;
+			return false;
+		}
+
+		this->m_size = static_cast<size_t>(size.QuadPart);
+#else
+		int file = open(a_file_path.c_str(), O_RDONLY);
+		if (file == -1)
+			return false;
+
+		struct stat status;
+		if (fstat(file, &status) != 0 || status.st_size <= 0)
+		{
+			close(file);
+			return false;
+		}
+
+		void *data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);        // Mapping stays valid after the descriptor is closed
+
+		if (data == MAP_FAILED)
+			return false;
+
+		this->m_data = static_cast<const uint8_t *>(data);
+		this->m_size = static_cast<size_t>(status.st_size);
+#endif
+		return this->m_data != nullptr;
+	}
+
+	const uint8_t                  *m_data{nullptr};        // Start of the mapped file
+	size_t                          m_size{0};              // Size of the mapped file
+	SkeletonView                    m_skeleton{};           // Points into the mapping
+	std::vector<CompressedClipView> m_clips{};              // Point into the mapping
+#if defined(_WIN32)
+	HANDLE m_file{INVALID_HANDLE_VALUE};        // Kept open for the lifetime of the mapping
+	HANDLE m_mapping{nullptr};                  // File mapping object
+#endif
+};
+
+namespace detail
+{
+template <class _type>
+AnimationAssetSection append_section(std::vector<uint8_t> &a_buffer, const _type *a_data, size_t a_count)
+{
+	a_buffer.resize((a_buffer.size() + animation_asset_alignment - 1) / animation_asset_alignment * animation_asset_alignment, 0);
+
+	AnimationAssetSection section{static_cast<uint32_t>(a_buffer.size()), static_cast<uint32_t>(a_count)};
+
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(a_data);
+	a_buffer.insert(a_buffer.end(), bytes, bytes + a_count * sizeof(_type));
+
+	return section;
+}
+
+template <class _type>
+AnimationAssetSection append_section(std::vector<uint8_t> &a_buffer, const ArrayView<_type> &a_view)
+{
+	return append_section(a_buffer, a_view.data(), a_view.size());
+}
+}        // namespace detail
+
+inline bool write_animation_asset(const std::filesystem::path &a_file_path, const SkeletonView &a_skeleton, const std::vector<CompressedClip> &a_clips)
+{
+	std::vector<uint8_t> buffer(sizeof(AnimationAssetHeader) + a_clips.size() * sizeof(AnimationAssetClip), 0);
+
+	AnimationAssetHeader header{};
+	header.m_magic          = animation_asset_magic;
+	header.m_version        = animation_asset_version;
+	header.m_clip_count     = static_cast<uint32_t>(a_clips.size());
+	header.m_parents        = detail::append_section(buffer, a_skeleton.m_parents);
+	header.m_bind_locals    = detail::append_section(buffer, a_skeleton.m_bind_locals);
+	header.m_joints         = detail::append_section(buffer, a_skeleton.m_joints);
+	header.m_skinning_binds = detail::append_section(buffer, a_skeleton.m_skinning_binds);
+	header.m_level_offsets  = detail::append_section(buffer, a_skeleton.m_level_offsets);
+
+	std::vector<AnimationAssetClip> clips;
+	for (auto &clip : a_clips)
+	{
+		AnimationAssetClip entry{};
+		entry.m_times         = detail::append_section(buffer, clip.m_times.data(), clip.m_times.size());
+		entry.m_animated_mask = detail::append_section(buffer, clip.m_animated_mask.data(), clip.m_animated_mask.size());
+		entry.m_tracks        = detail::append_section(buffer, clip.m_tracks.data(), clip.m_tracks.size());
+		entry.m_frames        = detail::append_section(buffer, clip.m_frames.data(), clip.m_frames.size());
+		entry.m_keys          = detail::append_section(buffer, clip.m_keys.data(), clip.m_keys.size());
+		clips.push_back(entry);
+	}
+
+	if (buffer.size() > UINT32_MAX)
+	{
+		ror::log_critical("Animation asset {} is too big for 32 bit offsets", a_file_path.string());
+		return false;
+	}
+
+	header.m_size = static_cast<uint32_t>(buffer.size());
+
+	std::memcpy(buffer.data(), &header, sizeof(header));
+	if (!clips.empty())
+		std::memcpy(buffer.data() + sizeof(header), clips.data(), clips.size() * sizeof(AnimationAssetClip));
+
+	FILE *file = std::fopen(a_file_path.string().c_str(), "wb");
+	if (!file)
+	{
+		ror::log_critical("Can't open {} for writing", a_file_path.string());
+		return false;
+	}
+
+	size_t written = std::fwrite(buffer.data(), 1, buffer.size(), file);
+	std::fclose(file);
+
+	return written == buffer.size();
+}
+
+}        // namespace ror
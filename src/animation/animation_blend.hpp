@@ -0,0 +1,290 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "animation/array_view.hpp"
+#include "animation/clip_player.hpp"
+#include "animation/compressed_clip.hpp"
+#include "animation/skeleton.hpp"
+#include "animation/transform.hpp"
+#include "memory/frame_arena.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <foundation/rortypes.hpp>
+#include <vector>
+
+/*  Animation blending usage
+ *  A BlendState is a fixed set of layers evaluated bottom up, it has no heap storage so it can
+ *  live inside every crowd instance. Override layers blend towards their clip by weight, additive
+ *  layers add the difference between their clip and its first key on top of what is below.
+ *  Each layer plays through its own ClipPlayer. blend_play() switches the clip of a layer and
+ *  cross-fades from the old one over a duration.
+ *  Optional per bone masks scale a layer per sorted node, i.e. bone_mask_for_subtree() to only
+ *  drive the upper body. Masks are not owned by the layer and must outlive it.
+ *  BlendContext holds what is shared by all instances of a skeleton and evaluates a BlendState into
+ *  local matrices using only scratch from the given FrameArena, so blending never allocates.
+ */
+
+namespace ror
+{
+constexpr uint32_t max_blend_layers = 4;
+
+enum class BlendMode : uint32_t
+{
+	override,
+	additive
+};
+
+struct BlendLayer
+{
+	ClipPlayer       m_player{};                            // Clip playing on this layer
+	ClipPlayer       m_previous{};                          // Clip being faded out
+	float32_t        m_fade_duration{0.0f};                 // Length of the current cross-fade, 0 if not fading
+	float32_t        m_fade_elapsed{0.0f};                  // Time spent in the current cross-fade
+	float32_t        m_weight{1.0f};                        // Contribution of the whole layer
+	BlendMode        m_mode{BlendMode::override};           // How the layer combines with the layers below
+	const float32_t *m_mask{nullptr};                       // Weight per sorted node, nullptr means 1 for all
+};
+
+struct BlendState
+{
+	uint32_t add_layer(const ClipPlayer &a_player, BlendMode a_mode = BlendMode::override, float32_t a_weight = 1.0f, const float32_t *a_mask = nullptr)
+	{
+		assert(this->m_layer_count < max_blend_layers && "Too many blend layers");
+
+		BlendLayer &layer = this->m_layers[this->m_layer_count];
+		layer             = BlendLayer{};
+		layer.m_player    = a_player;
+		layer.m_mode      = a_mode;
+		layer.m_weight    = a_weight;
+		layer.m_mask      = a_mask;
+
+		return this->m_layer_count++;
+	}
+
+	BlendLayer &layer(uint32_t a_index)
+	{
+		assert(a_index < this->m_layer_count && "Layer index out of range");
+		return this->m_layers[a_index];
+	}
+
+	BlendLayer m_layers[max_blend_layers];        // Evaluated from 0 upwards
+	uint32_t   m_layer_count{0};                  // Used layers
+};
+
+// Starts a_player on the layer, the current clip keeps playing underneath and fades out over a_fade_seconds
+inline void blend_play(BlendLayer &a_layer, const ClipPlayer &a_player, float32_t a_fade_seconds)
+{
+	a_layer.m_previous      = a_layer.m_player;
+	a_layer.m_player        = a_player;
+	a_layer.m_fade_duration = std::max(a_fade_seconds, 0.0f);
+	a_layer.m_fade_elapsed  = 0.0f;
+}
+
+inline void blend_advance(BlendState &a_state, const std::vector<CompressedClipView> &a_clips, float32_t a_delta_seconds)
+{
+	for (uint32_t i = 0; i < a_state.m_layer_count; ++i)
+	{
+		BlendLayer &layer = a_state.m_layers[i];
+
+		layer.m_player.advance(a_clips[layer.m_player.clip()], a_delta_seconds);
+
+		if (layer.m_fade_duration > 0.0f)
+		{
+			layer.m_previous.advance(a_clips[layer.m_previous.clip()], a_delta_seconds);
+			layer.m_fade_elapsed += a_delta_seconds;
+
+			if (layer.m_fade_elapsed >= layer.m_fade_duration)
+				layer.m_fade_duration = 0.0f;
+		}
+	}
+}
+
+// Sets a_weight on a_root and everything below it, other entries are left alone
+inline void bone_mask_for_subtree(const SkeletonView &a_skeleton, uint32_t a_root, float32_t a_weight, std::vector<float32_t> &a_mask)
+{
+	const uint32_t node_count = a_skeleton.node_count();
+
+	assert(a_root < node_count && "Mask root out of range");
+	a_mask.resize(node_count, 0.0f);
+
+	// Parents come before children in sorted order so one pass finds the whole subtree
+	std::vector<bool> inside(node_count, false);
+	inside[a_root] = true;
+	a_mask[a_root] = a_weight;
+
+	for (uint32_t i = a_root + 1; i < node_count; ++i)
+	{
+		int32_t parent = a_skeleton.m_parents[i];
+		if (parent != -1 && inside[static_cast<uint32_t>(parent)])
+		{
+			inside[i]  = true;
+			a_mask[i] = a_weight;
+		}
+	}
+}
+
+class BlendContext final
+{
+  public:
+	FORCE_INLINE               BlendContext()                                = default;        //! Default constructor
+	FORCE_INLINE               BlendContext(const BlendContext &a_other)     = default;        //! Copy constructor
+	FORCE_INLINE               BlendContext(BlendContext &&a_other) noexcept = default;        //! Move constructor
+	FORCE_INLINE BlendContext &operator=(const BlendContext &a_other)        = default;        //! Copy assignment operator
+	FORCE_INLINE BlendContext &operator=(BlendContext &&a_other) noexcept    = default;        //! Move assignment operator
+	FORCE_INLINE ~BlendContext() noexcept                                    = default;        //! Destructor
+
+	BlendContext(const SkeletonView &a_skeleton, const std::vector<CompressedClipView> &a_clips) :
+	    m_skeleton(a_skeleton), m_clips(a_clips)
+	{
+		const uint32_t node_count = a_skeleton.node_count();
+
+		this->m_rest.reserve(node_count);
+		for (uint32_t i = 0; i < node_count; ++i)
+			this->m_rest.push_back(transform_from_matrix(a_skeleton.m_bind_locals[i]));
+
+		// Additive layers are relative to the first key of their clip
+		this->m_references.resize(a_clips.size() * node_count);
+		for (size_t i = 0; i < a_clips.size(); ++i)
+			sample_transforms(a_clips[i], this->m_rest.data(), node_count, 0, 0.0, this->m_references.data() + i * node_count);
+	}
+
+	// Arena bytes one evaluate() needs at most
+	size_t scratch_size() const
+	{
+		return 3 * this->m_skeleton.node_count() * sizeof(Transform) + 3 * alignof(Transform);
+	}
+
+	// Single full weight override layer that isn't fading, can be sampled straight to matrices
+	static bool is_single_clip(const BlendState &a_state)
+	{
+		const BlendLayer &layer = a_state.m_layers[0];
+		return a_state.m_layer_count == 1 && layer.m_mode == BlendMode::override && layer.m_weight >= 1.0f && !layer.m_mask && layer.m_fade_duration <= 0.0f;
+	}
+
+	// Writes the blended local matrices of all nodes into a_pose, nodes set in a_skip stay at rest pose
+	void evaluate(const BlendState &a_state, utl::FrameArena &a_arena, Pose &a_pose, const uint64_t *a_skip = nullptr) const
+	{
+		const uint32_t node_count = this->m_skeleton.node_count();
+
+		if (is_single_clip(a_state))
+		{
+			const ClipPlayer         &player = a_state.m_layers[0].m_player;
+			const CompressedClipView &clip   = this->m_clips[player.clip()];
+
+			auto [keyframe, delta_time] = player.keyframe(clip);
+			sample_locals(this->m_skeleton, clip, keyframe, delta_time, a_pose, a_skip);
+			return;
+		}
+
+		size_t     marker = a_arena.marker();
+		Transform *result = a_arena.allocate<Transform>(node_count);
+		Transform *layer  = a_arena.allocate<Transform>(node_count);
+		Transform *fade   = a_arena.allocate<Transform>(node_count);
+
+		std::copy(this->m_rest.begin(), this->m_rest.end(), result);
+
+		for (uint32_t l = 0; l < a_state.m_layer_count; ++l)
+		{
+			const BlendLayer &state = a_state.m_layers[l];
+
+			if (state.m_weight <= 0.0f)
+				continue;
+
+			float32_t fade_weight = state.m_fade_duration > 0.0f ? state.m_fade_elapsed / state.m_fade_duration : 1.0f;
+
+			if (state.m_mode == BlendMode::override)
+			{
+				this->sample(state.m_player, layer, a_skip);
+
+				if (fade_weight < 1.0f)
+				{
+					this->sample(state.m_previous, fade, a_skip);
+					for (uint32_t i = 0; i < node_count; ++i)
+						layer[i] = transform_interpolate(fade[i], layer[i], fade_weight);
+				}
+
+				for (uint32_t i = 0; i < node_count; ++i)
+					result[i] = transform_interpolate(result[i], layer[i], state.m_weight * (state.m_mask ? state.m_mask[i] : 1.0f));
+			}
+			else
+			{
+				// Each clip is relative to its own reference so a fading additive layer applies both deltas weighted
+				if (fade_weight < 1.0f)
+					this->add(state.m_previous, state.m_weight * (1.0f - fade_weight), state.m_mask, a_skip, layer, result);
+
+				this->add(state.m_player, state.m_weight * fade_weight, state.m_mask, a_skip, layer, result);
+			}
+		}
+
+		for (uint32_t i = 0; i < node_count; ++i)
+			a_pose.m_locals[i] = transform_to_matrix(result[i]);
+
+		a_arena.rewind(marker);
+	}
+
+	const SkeletonView &skeleton() const
+	{
+		return this->m_skeleton;
+	}
+
+	const std::vector<CompressedClipView> &clips() const
+	{
+		return this->m_clips;
+	}
+
+  private:
+	void sample(const ClipPlayer &a_player, Transform *a_out, const uint64_t *a_skip) const
+	{
+		const CompressedClipView &clip = this->m_clips[a_player.clip()];
+
+		auto [keyframe, delta_time] = a_player.keyframe(clip);
+		sample_transforms(clip, this->m_rest.data(), this->m_skeleton.node_count(), keyframe, delta_time, a_out, a_skip);
+	}
+
+	// Skipped nodes sample the rest pose which isn't the reference, so they are left out of the additive
+	void add(const ClipPlayer &a_player, float32_t a_weight, const float32_t *a_mask, const uint64_t *a_skip, Transform *a_scratch, Transform *a_result) const
+	{
+		const uint32_t   node_count = this->m_skeleton.node_count();
+		const Transform *reference  = this->m_references.data() + a_player.clip() * node_count;
+
+		this->sample(a_player, a_scratch, a_skip);
+
+		for (uint32_t i = 0; i < node_count; ++i)
+			if (!is_skipped(a_skip, i))
+				a_result[i] = transform_add(a_result[i], a_scratch[i], reference[i], a_weight * (a_mask ? a_mask[i] : 1.0f));
+	}
+
+	SkeletonView                    m_skeleton{};          // Shared by everything blended with this context
+	std::vector<CompressedClipView> m_clips{};             // Clips layers can refer to
+	std::vector<Transform>          m_rest{};              // Rest pose of every node, decomposed once
+	std::vector<Transform>          m_references{};        // First key of every clip, node_count per clip
+};
+
+}        // namespace ror
@@ -0,0 +1,99 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "animation/skeleton.hpp"
+#include "animation/transform.hpp"
+#include <cassert>
+#include <cstdint>
+#include <foundation/rortypes.hpp>
+#include <math/rormatrix4.hpp>
+#include <vector>
+
+/*  AnimationClip usage
+ *  Built once by an importer, i.e. clip_from_astro_boy() or clips_from_gltf(), with every key
+ *  decomposed into translation, rotation and scale. Tracks are stored joint-major in the sorted
+ *  node order of the skeleton, so sampling walks the keys front to back without any lookups and
+ *  builds one matrix per animated joint.
+ */
+
+namespace ror
+{
+struct AnimationClip
+{
+	uint32_t key_count() const
+	{
+		return static_cast<uint32_t>(this->m_times.size());
+	}
+
+	bool is_animated(uint32_t a_node) const
+	{
+		return (this->m_animated_mask[a_node >> 6] >> (a_node & 63)) & 1u;
+	}
+
+	void set_animated(uint32_t a_node)
+	{
+		this->m_animated_mask[a_node >> 6] |= (uint64_t{1} << (a_node & 63));
+	}
+
+	std::vector<float32_t> m_times;                // Keyframe times shared by all tracks
+	std::vector<uint64_t>  m_animated_mask;        // One bit per sorted node, set if the node has a track
+	std::vector<Transform> m_keys;                 // All keys of a track are contiguous, tracks in sorted node order
+};
+
+// Samples all tracks between a_keyframe and a_keyframe + 1 and evaluates the whole pose
+inline void evaluate_pose(const SkeletonView &a_skeleton, const AnimationClip &a_clip, uint32_t a_keyframe, double a_delta_time, Pose &a_pose)
+{
+	const uint32_t node_count = a_skeleton.node_count();
+	const uint32_t key_count  = a_clip.key_count();
+
+	assert(a_pose.m_worlds.size() == node_count && "Pose not allocated for this skeleton");
+	assert(a_keyframe + 1 < key_count);
+
+	float32_t a = a_clip.m_times[a_keyframe];
+	float32_t b = a_clip.m_times[a_keyframe + 1];
+	float32_t t = static_cast<float32_t>(a_delta_time) / (b - a);
+
+	const Transform *track = a_clip.m_keys.data();
+
+	for (uint32_t i = 0; i < node_count; ++i)
+	{
+		if (a_clip.is_animated(i))
+		{
+			a_pose.m_locals[i] = transform_to_matrix(transform_interpolate(track[a_keyframe], track[a_keyframe + 1], t));
+			track += key_count;
+		}
+		else
+		{
+			a_pose.m_locals[i] = a_skeleton.m_bind_locals[i];
+		}
+	}
+
+	update_worlds(a_skeleton, a_pose);
+	update_palette(a_skeleton, a_pose);
+}
+
+}        // namespace ror
@@ -0,0 +1,151 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "animation/skeleton.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <foundation/rormacros.hpp>
+#include <foundation/rortypes.hpp>
+#include <math/rormatrix4.hpp>
+#include <vector>
+
+/*  Animation LOD usage
+ *  Every frame the owner of an instance reports how big it is on screen and whether it is visible,
+ *  normally from its bounding sphere with screen_size_from_sphere(). AnimationLodPolicy maps that size
+ *  to a level, each level evaluates the instance every m_update_intervals[level] frames and the
+ *  palette shown in between is either interpolated between the last two evaluations or the latest one
+ *  held. Interpolation reads two palettes and writes one per frame, which costs about a quarter of an
+ *  evaluation, so by default only the closest reduced level does it. From m_skip_leaves_level
+ *  on, nodes in the leaf mask stay at their rest pose instead of being sampled, leaf_lod_mask() builds
+ *  a mask of fingers and similar short chains. Invisible instances keep advancing their clips but are
+ *  not evaluated until they show up again.
+ *  Instances playing a single clip at the same time, quantized to m_share_quantum, are evaluated once
+ *  at the time of the first of them and the palette is copied to the rest. An instance alone in its
+ *  group is evaluated at its own time like any unshared one.
+ */
+
+namespace ror
+{
+constexpr uint32_t animation_lod_count = 4;
+
+struct AnimationLodPolicy
+{
+	float32_t m_screen_sizes[animation_lod_count - 1]{0.25f, 0.1f, 0.04f};        // An instance smaller than m_screen_sizes[i] drops to level i + 1
+	uint32_t  m_update_intervals[animation_lod_count]{1, 2, 4, 8};                // Frames between evaluations at each level
+	bool      m_interpolate[animation_lod_count]{true, true, false, false};       // Blend between the last two evaluations instead of holding the latest one
+	uint32_t  m_skip_leaves_level{1};                                             // First level that leaves masked nodes at rest pose
+	float32_t m_share_quantum{1.0f / 60.0f};                                      // Clip time step instances share evaluations at, 0 disables sharing
+	bool      m_update_invisible{false};                                          // Evaluate instances that aren't visible at the last level instead of freezing them
+};
+
+struct AnimationLod
+{
+	float32_t m_screen_size{1.0f};        // Projected height over viewport height, set by the owner
+	bool      m_visible{true};            // Set by the owner
+	bool      m_valid{false};             // Update phase is set up for the current level
+	bool      m_refill{false};            // Next evaluation goes to both history palettes
+	uint32_t  m_level{0};                 // Level used by the last update
+	uint32_t  m_newest{0};                // History palette holding the latest evaluation
+	uint32_t  m_span{1};                  // Frames from the previous evaluation to the next one
+	uint32_t  m_elapsed{0};               // Frames since the latest evaluation
+};
+
+// Projected height of a bounding sphere as a fraction of the viewport height, a_tan_half_fov_y is tan(fov_y / 2)
+FORCE_INLINE float32_t screen_size_from_sphere(float32_t a_radius, float32_t a_distance, float32_t a_tan_half_fov_y)
+{
+	if (a_distance <= a_radius)
+		return 1.0f;
+
+	return a_radius / (a_distance * a_tan_half_fov_y);
+}
+
+FORCE_INLINE uint32_t animation_lod_level(const AnimationLodPolicy &a_policy, float32_t a_screen_size)
+{
+	uint32_t level = 0;
+	while (level < animation_lod_count - 1 && a_screen_size < a_policy.m_screen_sizes[level])
+		++level;
+
+	return level;
+}
+
+// Element wise blend of two palettes, only used between evaluations a few frames apart where the difference is small
+inline void palette_interpolate(const Matrix4f *a_from, const Matrix4f *a_to, float32_t a_t, Matrix4f *a_out, uint32_t a_count)
+{
+	for (uint32_t i = 0; i < a_count; ++i)
+	{
+		const float32_t *from = a_from[i].m_values;
+		const float32_t *to   = a_to[i].m_values;
+		float32_t       *out  = a_out[i].m_values;
+
+		for (uint32_t j = 0; j < 16; ++j)
+			out[j] = from[j] + (to[j] - from[j]) * a_t;
+	}
+}
+
+// Marks chains of at most a_max_chain nodes below a parent that has at least a_min_branches of them, i.e. fingers off a wrist.
+// Single chains like a neck and head or a foot and toe aren't marked because they are visible from much further away
+inline void leaf_lod_mask(const SkeletonView &a_skeleton, std::vector<uint64_t> &a_mask, uint32_t a_max_chain = 4, uint32_t a_min_branches = 3)
+{
+	const uint32_t node_count = a_skeleton.node_count();
+
+	a_mask.assign((node_count + 63) / 64, 0);
+
+	// Children come after parents so a reverse pass sees every subtree before its root
+	std::vector<uint32_t> heights(node_count, 0);
+	for (uint32_t i = node_count; i-- > 0;)
+	{
+		int32_t parent = a_skeleton.m_parents[i];
+		if (parent != -1)
+			heights[static_cast<uint32_t>(parent)] = std::max(heights[static_cast<uint32_t>(parent)], heights[i] + 1);
+	}
+
+	std::vector<uint32_t> branches(node_count, 0);
+	for (uint32_t i = 0; i < node_count; ++i)
+	{
+		int32_t parent = a_skeleton.m_parents[i];
+		if (parent != -1 && heights[i] < a_max_chain)
+			branches[static_cast<uint32_t>(parent)]++;
+	}
+
+	for (uint32_t i = 0; i < node_count; ++i)
+	{
+		int32_t parent = a_skeleton.m_parents[i];
+		if (parent == -1)
+			continue;
+
+		uint32_t p      = static_cast<uint32_t>(parent);
+		bool     inside = (a_mask[p >> 6] >> (p & 63)) & 1u;
+
+		if (inside || (heights[i] < a_max_chain && branches[p] >= a_min_branches))
+			a_mask[i >> 6] |= (uint64_t{1} << (i & 63));
+	}
+}
+
+}        // namespace ror
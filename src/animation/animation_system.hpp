@@ -0,0 +1,358 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "animation/animation_blend.hpp"
+#include "animation/animation_lod.hpp"
+#include "animation/clip_player.hpp"
+#include "animation/compressed_clip.hpp"
+#include "animation/skeleton.hpp"
+#include "memory/frame_arena.hpp"
+#include "profiling/cpu_profiler.hpp"
+#include "threading/job_system.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <foundation/rormacros.hpp>
+#include <foundation/rortypes.hpp>
+#include <math/rormatrix4.hpp>
+#include <utility>
+#include <vector>
+
+/*  AnimationSystem usage
+ *  Holds any number of instances of one skeleton, each with its own BlendState of layers and clip players.
+ *  update(delta) advances all instances and evaluates them in parallel on the job system, results
+ *  land in one contiguous palette buffer with joint_count matrices per instance in instance order,
+ *  ready to be uploaded in one copy. Locals, worlds and blend scratch live in per thread poses and
+ *  frame arenas so memory per instance is its palette plus two history palettes for LOD, and update()
+ *  never allocates once all instances are added.
+ *  Call set_lod() before update() to report screen size and visibility, see animation_lod.hpp for how
+ *  that turns into reduced update rates, skipped leaf joints and shared evaluations.
+ *  Skeleton and clip views must outlive the system, normally they point into an AnimationAsset.
+ */
+
+namespace ror
+{
+class AnimationSystem final
+{
+  public:
+	FORCE_INLINE                  AnimationSystem()                                   = default;        //! Default constructor
+	FORCE_INLINE                  AnimationSystem(const AnimationSystem &a_other)     = delete;         //! Copy constructor
+	FORCE_INLINE                  AnimationSystem(AnimationSystem &&a_other) noexcept = default;        //! Move constructor
+	FORCE_INLINE AnimationSystem &operator=(const AnimationSystem &a_other)           = delete;         //! Copy assignment operator
+	FORCE_INLINE AnimationSystem &operator=(AnimationSystem &&a_other) noexcept       = default;        //! Move assignment operator
+	FORCE_INLINE ~AnimationSystem() noexcept                                          = default;        //! Destructor
+
+	AnimationSystem(const SkeletonView &a_skeleton, const std::vector<CompressedClipView> &a_clips, utl::JobSystem &a_job_system) :
+	    m_context(a_skeleton, a_clips), m_job_system(&a_job_system)
+	{
+		this->m_scratch.resize(a_job_system.thread_count());
+		for (auto &pose : this->m_scratch)
+			pose.allocate(a_skeleton);
+
+		for (uint32_t i = 0; i < a_job_system.thread_count(); ++i)
+			this->m_arenas.emplace_back(this->m_context.scratch_size());
+
+		leaf_lod_mask(a_skeleton, this->m_leaf_mask);
+	}
+
+	// Adds an instance with a single override layer playing a_clip
+	uint32_t add_instance(uint32_t a_clip, float32_t a_time = 0.0f, float32_t a_speed = 1.0f, PlayMode a_mode = PlayMode::loop)
+	{
+		BlendState state;
+		state.add_layer(this->player(a_clip, a_time, a_speed, a_mode));
+
+		this->m_instances.push_back(state);
+		this->m_lods.emplace_back();
+		this->m_palettes.resize(this->m_instances.size() * this->joint_count());
+		this->m_history.resize(this->m_instances.size() * this->joint_count() * 2);
+		this->m_evaluations.reserve(this->m_instances.size());
+		this->m_groups.reserve(this->m_instances.size());
+		this->m_interpolations.reserve(this->m_instances.size());
+
+		return static_cast<uint32_t>(this->m_instances.size() - 1);
+	}
+
+	// Screen size is the projected height over the viewport height, i.e. from screen_size_from_sphere()
+	void set_lod(uint32_t a_instance, float32_t a_screen_size, bool a_visible)
+	{
+		assert(a_instance < this->m_instances.size() && "Instance index out of range");
+
+		this->m_lods[a_instance].m_screen_size = a_screen_size;
+		this->m_lods[a_instance].m_visible     = a_visible;
+	}
+
+	void set_lod_policy(const AnimationLodPolicy &a_policy)
+	{
+		this->m_lod_policy = a_policy;
+
+		// Intervals or leaf skipping may have changed for the current levels
+		for (auto &lod : this->m_lods)
+			lod.m_valid = false;
+	}
+
+	// Only moves the playheads, for when poses are evaluated elsewhere i.e. on the GPU from ClipPlayer::time()
+	void advance(float32_t a_delta_seconds)
+	{
+		for (auto &instance : this->m_instances)
+			blend_advance(instance, this->m_context.clips(), a_delta_seconds);
+	}
+
+	// Advances every instance by a_delta_seconds, looping each clip, then evaluates the poses the LOD policy asks for
+	void update(float32_t a_delta_seconds)
+	{
+		this->advance(a_delta_seconds);
+		this->schedule();
+
+		// Each group is one evaluation copied to every instance in it
+		this->m_job_system->parallel_for(static_cast<uint32_t>(this->m_groups.size()), instance_grain, [this](uint32_t a_begin, uint32_t a_end, uint32_t a_thread_index) {
+			utl::CpuZone zone{"animation evaluate"};
+			this->evaluate(a_begin, a_end, this->m_scratch[a_thread_index], this->m_arenas[a_thread_index]);
+		});
+
+		this->m_job_system->parallel_for(static_cast<uint32_t>(this->m_interpolations.size()), interpolation_grain, [this](uint32_t a_begin, uint32_t a_end, uint32_t) {
+			utl::CpuZone zone{"animation interpolate"};
+			this->interpolate(a_begin, a_end);
+		});
+	}
+
+	// Evaluations done by the last update(), less than instance_count() when LOD or sharing kicked in
+	uint32_t evaluation_count() const
+	{
+		return static_cast<uint32_t>(this->m_groups.size());
+	}
+
+	uint32_t instance_count() const
+	{
+		return static_cast<uint32_t>(this->m_instances.size());
+	}
+
+	uint32_t joint_count() const
+	{
+		return this->m_context.skeleton().joint_count();
+	}
+
+	BlendState &instance(uint32_t a_instance)
+	{
+		assert(a_instance < this->m_instances.size() && "Instance index out of range");
+		return this->m_instances[a_instance];
+	}
+
+	const Matrix4f *palette(uint32_t a_instance) const
+	{
+		assert(a_instance < this->m_instances.size() && "Instance index out of range");
+		return this->m_palettes.data() + a_instance * this->joint_count();
+	}
+
+	const std::vector<Matrix4f> &palettes() const
+	{
+		return this->m_palettes;
+	}
+
+	// Player for one of the clips of this system, for blend_play() and BlendState::add_layer()
+	ClipPlayer player(uint32_t a_clip, float32_t a_time = 0.0f, float32_t a_speed = 1.0f, PlayMode a_mode = PlayMode::loop) const
+	{
+		assert(a_clip < this->m_context.clips().size() && "Clip index out of range");
+		return ClipPlayer{a_clip, this->m_context.clips()[a_clip], a_time, a_speed, a_mode};
+	}
+
+	const BlendContext &context() const
+	{
+		return this->m_context;
+	}
+
+	const AnimationLodPolicy &lod_policy() const
+	{
+		return this->m_lod_policy;
+	}
+
+  private:
+	static constexpr uint32_t instance_grain      = 16;                     // Instances per job, a 44 joint skeleton is only a few microseconds of work
+	static constexpr uint32_t interpolation_grain = 64;                     // Palette interpolations per job, these are only a few hundred multiply-adds
+	static constexpr uint64_t unshared_key        = uint64_t{1} << 63;      // Set in the key of instances that can't share, the rest is the instance index
+
+	bool uses_history(uint32_t a_level) const
+	{
+		return this->m_lod_policy.m_update_intervals[a_level] > 1 && this->m_lod_policy.m_interpolate[a_level];
+	}
+
+	// Interpolating instances write to history and show a blend of their last two evaluations
+	Matrix4f *evaluation_target(uint32_t a_instance)
+	{
+		const AnimationLod &lod = this->m_lods[a_instance];
+
+		if (this->uses_history(lod.m_level))
+			return this->m_history.data() + (a_instance * 2 + lod.m_newest) * this->joint_count();
+
+		return this->m_palettes.data() + a_instance * this->joint_count();
+	}
+
+	// Decides what every instance does this frame and groups evaluations that can share
+	void schedule()
+	{
+		const AnimationLodPolicy &policy = this->m_lod_policy;
+
+		this->m_evaluations.clear();
+		this->m_groups.clear();
+		this->m_interpolations.clear();
+
+		for (uint32_t i = 0; i < this->instance_count(); ++i)
+		{
+			AnimationLod &lod = this->m_lods[i];
+
+			if (!lod.m_visible && !policy.m_update_invisible)
+			{
+				// Comes back with a fresh evaluation instead of interpolating from a stale one
+				lod.m_valid = false;
+				continue;
+			}
+
+			uint32_t level    = lod.m_visible ? animation_lod_level(policy, lod.m_screen_size) : animation_lod_count - 1;
+			uint32_t interval = policy.m_update_intervals[level];
+
+			if (level != lod.m_level || !lod.m_valid)
+			{
+				// First evaluation at a level fills both history palettes, later ones are spread over the interval
+				lod.m_level   = level;
+				lod.m_valid   = true;
+				lod.m_refill  = this->uses_history(level);
+				lod.m_newest  = 0;
+				lod.m_span    = 1 + i % interval;
+				lod.m_elapsed = 0;
+				this->m_evaluations.emplace_back(this->share_key(i), i);
+			}
+			else if (interval > 1 && ++lod.m_elapsed >= lod.m_span)
+			{
+				lod.m_newest ^= 1u;
+				lod.m_span    = interval;
+				lod.m_elapsed = 0;
+				this->m_evaluations.emplace_back(this->share_key(i), i);
+			}
+			else if (interval == 1)
+				this->m_evaluations.emplace_back(this->share_key(i), i);
+
+			if (this->uses_history(level))
+				this->m_interpolations.push_back(i);
+		}
+
+		std::sort(this->m_evaluations.begin(), this->m_evaluations.end());
+
+		for (uint32_t i = 0; i < this->m_evaluations.size(); ++i)
+			if (i == 0 || this->m_evaluations[i].first != this->m_evaluations[i - 1].first)
+				this->m_groups.push_back(i);
+	}
+
+	// Instances with equal keys produce the same palette
+	uint64_t share_key(uint32_t a_instance) const
+	{
+		const BlendState         &state  = this->m_instances[a_instance];
+		const AnimationLodPolicy &policy = this->m_lod_policy;
+
+		if (policy.m_share_quantum <= 0.0f || !BlendContext::is_single_clip(state))
+			return unshared_key | a_instance;
+
+		const ClipPlayer &player = state.m_layers[0].m_player;
+		uint64_t          step   = static_cast<uint64_t>(std::max(std::floor(player.time() / policy.m_share_quantum), 0.0f));
+		uint64_t          skip   = this->m_lods[a_instance].m_level >= policy.m_skip_leaves_level ? 1u : 0u;
+
+		return (uint64_t{player.clip()} << 40) | (skip << 39) | (step & 0xffffffffu);
+	}
+
+	void evaluate(uint32_t a_begin, uint32_t a_end, Pose &a_scratch, utl::FrameArena &a_arena)
+	{
+		const SkeletonView       &skeleton = this->m_context.skeleton();
+		const AnimationLodPolicy &policy   = this->m_lod_policy;
+		const uint32_t            joints   = this->joint_count();
+
+		for (uint32_t g = a_begin; g < a_end; ++g)
+		{
+			uint32_t first = this->m_groups[g];
+			uint32_t last  = g + 1 < this->m_groups.size() ? this->m_groups[g + 1] : static_cast<uint32_t>(this->m_evaluations.size());
+
+			uint32_t        leader = this->m_evaluations[first].second;
+			const uint64_t *skip   = this->m_lods[leader].m_level >= policy.m_skip_leaves_level ? this->m_leaf_mask.data() : nullptr;
+
+			// Leader samples at its own time, the rest of a shared group is within m_share_quantum of it and takes its palette
+			this->m_context.evaluate(this->m_instances[leader], a_arena, a_scratch, skip);
+
+			update_worlds(skeleton, a_scratch);
+
+			Matrix4f *palette = this->evaluation_target(leader);
+			update_palette(skeleton, a_scratch, palette);
+
+			for (uint32_t i = first + 1; i < last; ++i)
+				std::memcpy(this->evaluation_target(this->m_evaluations[i].second), palette, joints * sizeof(Matrix4f));
+
+			// A first evaluation at a reduced rate has nothing older to interpolate from
+			for (uint32_t i = first; i < last; ++i)
+			{
+				uint32_t      instance = this->m_evaluations[i].second;
+				AnimationLod &lod      = this->m_lods[instance];
+
+				if (lod.m_refill)
+				{
+					std::memcpy(this->m_history.data() + (instance * 2 + (lod.m_newest ^ 1u)) * joints, palette, joints * sizeof(Matrix4f));
+					lod.m_refill = false;
+				}
+			}
+		}
+	}
+
+	// Interpolating instances move from their older to their newest evaluation over the span between them
+	void interpolate(uint32_t a_begin, uint32_t a_end)
+	{
+		const uint32_t joints = this->joint_count();
+
+		for (uint32_t i = a_begin; i < a_end; ++i)
+		{
+			uint32_t            instance = this->m_interpolations[i];
+			const AnimationLod &lod      = this->m_lods[instance];
+			const Matrix4f     *history  = this->m_history.data() + instance * 2 * joints;
+			float32_t           t        = static_cast<float32_t>(lod.m_elapsed + 1) / static_cast<float32_t>(lod.m_span);
+
+			palette_interpolate(history + (lod.m_newest ^ 1u) * joints, history + lod.m_newest * joints, t, this->m_palettes.data() + instance * joints, joints);
+		}
+	}
+
+	BlendContext                               m_context{};                 // Skeleton, clips and rest pose shared by all instances
+	utl::JobSystem                            *m_job_system{nullptr};       // Not owned
+	AnimationLodPolicy                         m_lod_policy{};              // Maps screen size to update rate and detail
+	std::vector<BlendState>                    m_instances{};               // Per instance layers and playback state
+	std::vector<AnimationLod>                  m_lods{};                    // Per instance LOD input and update phase
+	std::vector<Pose>                          m_scratch{};                 // One per job system thread
+	std::vector<utl::FrameArena>               m_arenas{};                  // One per job system thread, sized for one blend evaluation
+	std::vector<uint64_t>                      m_leaf_mask{};               // Nodes left at rest pose from m_skip_leaves_level on
+	std::vector<Matrix4f>                      m_palettes{};                // joint_count matrices per instance, contiguous
+	std::vector<Matrix4f>                      m_history{};                 // Two evaluated palettes per instance for interpolated levels
+	std::vector<std::pair<uint64_t, uint32_t>> m_evaluations{};             // Share key and instance of everything evaluated this frame, sorted by key
+	std::vector<uint32_t>                      m_groups{};                  // First entry in m_evaluations of each group of equal keys
+	std::vector<uint32_t>                      m_interpolations{};          // Instances showing an interpolated palette this frame
+};
+
+}        // namespace ror
@@ -0,0 +1,88 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+/*  ArrayView usage
+ *  Non owning read only view over contiguous data, either a std::vector or a section of a mapped file.
+ *  The viewed memory must outlive the view.
+ */
+
+namespace ror
+{
+template <class _type>
+struct ArrayView
+{
+	ArrayView() = default;
+
+	ArrayView(const _type *a_data, uint32_t a_count) :
+	    m_data(a_data), m_count(a_count)
+	{}
+
+	ArrayView(const std::vector<_type> &a_vector) :
+	    m_data(a_vector.data()), m_count(static_cast<uint32_t>(a_vector.size()))
+	{}
+
+	const _type &operator[](uint32_t a_index) const
+	{
+		assert(a_index < this->m_count && "Array view index out of range");
+		return this->m_data[a_index];
+	}
+
+	const _type *data() const
+	{
+		return this->m_data;
+	}
+
+	uint32_t size() const
+	{
+		return this->m_count;
+	}
+
+	bool empty() const
+	{
+		return this->m_count == 0;
+	}
+
+	const _type *begin() const
+	{
+		return this->m_data;
+	}
+
+	const _type *end() const
+	{
+		return this->m_data + this->m_count;
+	}
+
+	const _type *m_data{nullptr};        // First element
+	uint32_t     m_count{0};             // Number of elements
+};
+
+}        // namespace ror
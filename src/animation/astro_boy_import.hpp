@@ -0,0 +1,98 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "animation/animation_clip.hpp"
+#include "animation/skeleton.hpp"
+#include "animation/transform.hpp"
+#include "skeletal_animation.hpp"
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+/*  Astro boy import usage
+ *  Only used offline by the animation converter and by tests against the legacy path, the runtime
+ *  loads the converted asset instead so it never pays for the static astro boy tables.
+ *  Converts the collada style tables once, this resolves all map lookups and collada transposes up front.
+ */
+
+namespace ror
+{
+inline Skeleton skeleton_from_astro_boy(AstroBoyTree *a_tree, uint32_t a_nodes_count)
+{
+	std::vector<int32_t>  parents;
+	std::vector<Matrix4f> locals;
+	std::vector<uint32_t> joint_nodes;
+	std::vector<Matrix4f> skinning_binds;
+
+	Matrix4f bind_shape = get_ror_matrix4(astro_boy_skeleton_bind_shape_matrix);
+
+	for (uint32_t i = 0; i < a_nodes_count; ++i)
+	{
+		parents.push_back(a_tree[i].m_parent_id);
+		locals.push_back(get_ror_matrix4(a_tree[i].m_transform));
+
+		// Joints stay in original node order because that is what the vertex joint ids index into
+		if (a_tree[i].m_type == 1)
+		{
+			joint_nodes.push_back(i);
+			skinning_binds.push_back(bind_shape * get_ror_matrix4(a_tree[i].m_inverse));
+		}
+	}
+
+	return skeleton_from_hierarchy(parents, locals, joint_nodes, skinning_binds);
+}
+
+inline AnimationClip clip_from_astro_boy(const Skeleton &a_skeleton)
+{
+	AnimationClip clip;
+
+	const uint32_t node_count = a_skeleton.node_count();
+
+	clip.m_times = astro_boy_animation_keyframe_times;
+	clip.m_animated_mask.resize((node_count + 63) / 64, 0);
+	clip.m_keys.reserve(astro_boy_animation_keyframe_matrices.size() * clip.key_count());
+
+	for (uint32_t i = 0; i < node_count; ++i)
+	{
+		auto track = astro_boy_animation_keyframe_matrices.find(static_cast<int>(a_skeleton.m_source_index[i]));
+
+		if (track != astro_boy_animation_keyframe_matrices.end())
+		{
+			assert(track->second.size() == clip.key_count() && "Track doesn't have a key for every keyframe");
+
+			clip.set_animated(i);
+
+			for (auto &key : track->second)
+				clip.m_keys.push_back(transform_from_matrix(get_ror_matrix4(key)));
+		}
+	}
+
+	return clip;
+}
+
+}        // namespace ror
@@ -0,0 +1,198 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "animation/compressed_clip.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <foundation/rormacros.hpp>
+#include <foundation/rortypes.hpp>
+#include <utility>
+
+/*  ClipPlayer usage
+ *  Playhead for one clip, each instance owns its own so any number of them can sample the same clip at
+ *  different times without shared state. seek() places the playhead with a binary search, advance()
+ *  moves it by a delta and walks the cached keyframe cursor forward or back, which is O(1) for normal
+ *  playback. Falls back to a binary search if the playhead jumped more than a few keys, i.e. on loop wrap.
+ *  keyframe() returns the keyframe and time since it in the form sample_locals() and friends expect.
+ *  Loop wraps around, clamp holds the last key and ping pong reverses direction at either end.
+ *  Clips need at least two keys, AnimationAsset::load() rejects any that don't have them.
+ */
+
+namespace ror
+{
+enum class PlayMode : uint32_t
+{
+	loop,
+	clamp,
+	ping_pong
+};
+
+class ClipPlayer final
+{
+  public:
+	FORCE_INLINE             ClipPlayer()                              = default;        //! Default constructor
+	FORCE_INLINE             ClipPlayer(const ClipPlayer &a_other)     = default;        //! Copy constructor
+	FORCE_INLINE             ClipPlayer(ClipPlayer &&a_other) noexcept = default;        //! Move constructor
+	FORCE_INLINE ClipPlayer &operator=(const ClipPlayer &a_other)      = default;        //! Copy assignment operator
+	FORCE_INLINE ClipPlayer &operator=(ClipPlayer &&a_other) noexcept  = default;        //! Move assignment operator
+	FORCE_INLINE ~ClipPlayer() noexcept                                = default;        //! Destructor
+
+	ClipPlayer(uint32_t a_clip, const CompressedClipView &a_view, float32_t a_time = 0.0f, float32_t a_speed = 1.0f, PlayMode a_mode = PlayMode::loop) :
+	    m_clip(a_clip), m_speed(a_speed), m_mode(a_mode)
+	{
+		this->seek(a_view, a_time);
+	}
+
+	// Places the playhead at a_time, which is wrapped or clamped by the play mode
+	void seek(const CompressedClipView &a_view, float32_t a_time)
+	{
+		assert(a_view.key_count() > 1 && "Clip needs at least two keys to be sampled");
+
+		this->m_time     = this->wrap(a_view, a_time);
+		this->m_keyframe = clip_keyframe_at(a_view, this->m_time).first;
+	}
+
+	void advance(const CompressedClipView &a_view, float32_t a_delta_seconds)
+	{
+		assert(a_view.key_count() > 1 && "Clip needs at least two keys to be sampled");
+
+		this->m_time = this->wrap(a_view, this->m_time + a_delta_seconds * this->m_speed * this->m_direction);
+
+		const float32_t *times    = a_view.m_times.data();
+		const uint32_t   last     = a_view.key_count() - 2;        // Last keyframe that starts a segment
+		uint32_t         keyframe = std::min(this->m_keyframe, last);
+
+		for (uint32_t step = 0; step < max_cursor_steps; ++step)
+		{
+			if (keyframe < last && this->m_time >= times[keyframe + 1])
+				++keyframe;
+			else if (keyframe > 0 && this->m_time < times[keyframe])
+				--keyframe;
+			else
+			{
+				this->m_keyframe = keyframe;
+				return;
+			}
+		}
+
+		this->m_keyframe = clip_keyframe_at(a_view, this->m_time).first;
+	}
+
+	// Keyframe and seconds since it, ready for sample_locals()
+	std::pair<uint32_t, double> keyframe(const CompressedClipView &a_view) const
+	{
+		assert(this->m_keyframe + 1 < a_view.key_count() && "Clip needs at least two keys to be sampled");
+
+		float32_t start = a_view.m_times[this->m_keyframe];
+		float32_t end   = a_view.m_times[this->m_keyframe + 1];
+
+		return std::make_pair(this->m_keyframe, static_cast<double>(std::min(std::max(this->m_time - start, 0.0f), end - start)));
+	}
+
+	uint32_t clip() const
+	{
+		return this->m_clip;
+	}
+
+	float32_t time() const
+	{
+		return this->m_time;
+	}
+
+	float32_t speed() const
+	{
+		return this->m_speed;
+	}
+
+	void set_speed(float32_t a_speed)
+	{
+		this->m_speed = a_speed;
+	}
+
+	PlayMode mode() const
+	{
+		return this->m_mode;
+	}
+
+	void set_mode(PlayMode a_mode)
+	{
+		this->m_mode = a_mode;
+	}
+
+  private:
+	static constexpr uint32_t max_cursor_steps = 4;        // Beyond this many keys a binary search is cheaper
+
+	float32_t wrap(const CompressedClipView &a_view, float32_t a_time)
+	{
+		float32_t start    = a_view.m_times[0];
+		float32_t end      = a_view.m_times[a_view.key_count() - 1];
+		float32_t duration = end - start;
+
+		if (duration <= 0.0f)
+			return start;
+
+		switch (this->m_mode)
+		{
+			case PlayMode::loop:
+				if (a_time >= end || a_time < start)
+					a_time = start + std::fmod(std::fmod(a_time - start, duration) + duration, duration);
+				break;
+			case PlayMode::clamp:
+				a_time = std::min(std::max(a_time, start), end);
+				break;
+			case PlayMode::ping_pong:
+			{
+				// Fold into one forward and one backward pass, the pass we land in decides the direction
+				float32_t period = std::fmod(std::fmod(a_time - start, 2.0f * duration) + 2.0f * duration, 2.0f * duration);
+				if (period > duration)
+				{
+					a_time            = end - (period - duration);
+					this->m_direction = -this->m_direction;
+				}
+				else
+				{
+					a_time = start + period;
+				}
+				break;
+			}
+		}
+
+		return a_time;
+	}
+
+	uint32_t  m_clip{0};                     // Index of the clip in whatever list the owner keeps
+	float32_t m_time{0.0f};                  // Seconds into the clip
+	float32_t m_speed{1.0f};                 // Playback rate, 1 is real time
+	float32_t m_direction{1.0f};             // -1 while ping pong plays backwards
+	uint32_t  m_keyframe{0};                 // Cached cursor, m_time is within [times[m_keyframe], times[m_keyframe + 1]]
+	PlayMode  m_mode{PlayMode::loop};        // What happens at the ends of the clip
+};
+
+}        // namespace ror
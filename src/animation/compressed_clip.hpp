@@ -0,0 +1,449 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "animation/animation_clip.hpp"
+#include "animation/array_view.hpp"
+#include "animation/skeleton.hpp"
+#include "animation/transform.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <foundation/rormacros.hpp>
+#include <foundation/rortypes.hpp>
+#include <math/rorvector3.hpp>
+#include <math/rorvector4.hpp>
+#include <utility>
+#include <vector>
+
+/*  CompressedClip usage
+ *  Build from a decomposed AnimationClip with compress_clip(), optionally with a tolerance per sorted node.
+ *  Rotations are stored smallest-three in 64 bits, translation and scale are quantized to 16 bits within
+ *  the range of each track. Keys that can be rebuilt by interpolating their neighbours within tolerance are
+ *  dropped, the error check runs on the quantized values so the tolerance bounds the final result.
+ *  Sample with the evaluate_pose() overload below, it decodes directly from the compressed keys through a
+ *  CompressedClipView, which can point into a CompressedClip or a mapped asset.
+ *  Tolerance is in model units measured at the end of the bone, so rotation and scale errors are scaled
+ *  by bone length before comparing.
+ */
+
+namespace ror
+{
+struct CompressedKey
+{
+	uint64_t m_rotation;              // Index of the dropped component in bits 60-61, three 20 bit components below it
+	uint16_t m_translation[3];        // Normalized within the track translation range
+	uint16_t m_scale[3];              // Normalized within the track scale range
+};
+
+struct CompressedTrack
+{
+	Vector3f m_translation_minimum;        // Translation range of this track
+	Vector3f m_translation_extent;         // Zero extent means the component is constant
+	Vector3f m_scale_minimum;              // Scale range of this track
+	Vector3f m_scale_extent;               // Zero extent means the component is constant
+	uint32_t m_first_key;                  // Index of the first key of this track in m_frames and m_keys
+	uint32_t m_key_count;                  // Number of keys left after reduction, at least 1
+};
+
+struct CompressedClipView
+{
+	uint32_t key_count() const
+	{
+		return this->m_times.size();
+	}
+
+	bool is_animated(uint32_t a_node) const
+	{
+		return (this->m_animated_mask[a_node >> 6] >> (a_node & 63)) & 1u;
+	}
+
+	size_t size_in_bytes() const
+	{
+		return this->m_times.size() * sizeof(float32_t) + this->m_animated_mask.size() * sizeof(uint64_t) +
+		       this->m_tracks.size() * sizeof(CompressedTrack) + this->m_frames.size() * sizeof(uint16_t) + this->m_keys.size() * sizeof(CompressedKey);
+	}
+
+	ArrayView<float32_t>       m_times;                // Keyframe times of the source clip
+	ArrayView<uint64_t>        m_animated_mask;        // One bit per sorted node
+	ArrayView<CompressedTrack> m_tracks;               // Tracks in sorted node order
+	ArrayView<uint16_t>        m_frames;               // Source keyframe of each kept key
+	ArrayView<CompressedKey>   m_keys;                 // Kept keys
+};
+
+struct CompressedClip
+{
+	operator CompressedClipView() const
+	{
+		return CompressedClipView{this->m_times, this->m_animated_mask, this->m_tracks, this->m_frames, this->m_keys};
+	}
+
+	size_t size_in_bytes() const
+	{
+		return CompressedClipView(*this).size_in_bytes();
+	}
+
+	std::vector<float32_t>       m_times;                // Keyframe times of the source clip, key frames index into this
+	std::vector<uint64_t>        m_animated_mask;        // One bit per sorted node, set if the node has a track
+	std::vector<CompressedTrack> m_tracks;               // Tracks in sorted node order
+	std::vector<uint16_t>        m_frames;               // Source keyframe of each kept key, increasing within a track
+	std::vector<CompressedKey>   m_keys;                 // Kept keys, all keys of a track are contiguous
+};
+
+constexpr float32_t compressed_rotation_range = 0.70710678f;        // Smallest three components are within +-1/sqrt(2)
+constexpr uint32_t  compressed_rotation_bits  = 20;
+constexpr uint32_t  compressed_rotation_mask  = (1u << compressed_rotation_bits) - 1u;
+
+FORCE_INLINE uint16_t quantize_unorm16(float32_t a_value, float32_t a_minimum, float32_t a_extent)
+{
+	if (a_extent <= 0.0f)
+		return 0;
+
+	float32_t normalized = std::min(std::max((a_value - a_minimum) / a_extent, 0.0f), 1.0f);
+	return static_cast<uint16_t>(normalized * 65535.0f + 0.5f);
+}
+
+FORCE_INLINE float32_t dequantize_unorm16(uint16_t a_value, float32_t a_minimum, float32_t a_extent)
+{
+	return a_minimum + static_cast<float32_t>(a_value) * (a_extent / 65535.0f);
+}
+
+inline uint64_t quantize_rotation(const Vector4f &a_rotation)
+{
+	float32_t components[4] = {a_rotation.x, a_rotation.y, a_rotation.z, a_rotation.w};
+
+	uint32_t largest = 0;
+	for (uint32_t i = 1; i < 4; ++i)
+		if (std::fabs(components[i]) > std::fabs(components[largest]))
+			largest = i;
+
+	// q and -q are the same rotation, flip so the dropped component is positive and can be rebuilt with sqrt
+	float32_t sign   = components[largest] < 0.0f ? -1.0f : 1.0f;
+	uint64_t  packed = static_cast<uint64_t>(largest) << (3 * compressed_rotation_bits);
+	uint32_t  shift  = 2 * compressed_rotation_bits;
+
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		if (i == largest)
+			continue;
+
+		float32_t normalized = (components[i] * sign + compressed_rotation_range) / (2.0f * compressed_rotation_range);
+		normalized           = std::min(std::max(normalized, 0.0f), 1.0f);
+
+		packed |= static_cast<uint64_t>(normalized * static_cast<float32_t>(compressed_rotation_mask) + 0.5f) << shift;
+		shift -= compressed_rotation_bits;
+	}
+
+	return packed;
+}
+
+inline Vector4f dequantize_rotation(uint64_t a_packed)
+{
+	uint32_t  largest       = static_cast<uint32_t>(a_packed >> (3 * compressed_rotation_bits)) & 3u;
+	uint32_t  shift         = 2 * compressed_rotation_bits;
+	float32_t components[4] = {};
+	float32_t sum           = 0.0f;
+
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		if (i == largest)
+			continue;
+
+		float32_t normalized = static_cast<float32_t>((a_packed >> shift) & compressed_rotation_mask) / static_cast<float32_t>(compressed_rotation_mask);
+		components[i]        = normalized * (2.0f * compressed_rotation_range) - compressed_rotation_range;
+		sum += components[i] * components[i];
+		shift -= compressed_rotation_bits;
+	}
+
+	components[largest] = std::sqrt(std::max(1.0f - sum, 0.0f));
+
+	return quaternion_normalize(Vector4f{components[0], components[1], components[2], components[3]});
+}
+
+inline Transform decompress_key(const CompressedTrack &a_track, const CompressedKey &a_key)
+{
+	Transform transform;
+
+	transform.m_translation = Vector3f{dequantize_unorm16(a_key.m_translation[0], a_track.m_translation_minimum.x, a_track.m_translation_extent.x),
+	                                   dequantize_unorm16(a_key.m_translation[1], a_track.m_translation_minimum.y, a_track.m_translation_extent.y),
+	                                   dequantize_unorm16(a_key.m_translation[2], a_track.m_translation_minimum.z, a_track.m_translation_extent.z)};
+	transform.m_rotation    = dequantize_rotation(a_key.m_rotation);
+	transform.m_scale       = Vector3f{dequantize_unorm16(a_key.m_scale[0], a_track.m_scale_minimum.x, a_track.m_scale_extent.x),
+                                 dequantize_unorm16(a_key.m_scale[1], a_track.m_scale_minimum.y, a_track.m_scale_extent.y),
+                                 dequantize_unorm16(a_key.m_scale[2], a_track.m_scale_minimum.z, a_track.m_scale_extent.z)};
+
+	return transform;
+}
+
+// Approximate displacement at the end of a bone of a_length caused by using a_approximate instead of a_exact
+inline float32_t transform_error(const Transform &a_exact, const Transform &a_approximate, float32_t a_length)
+{
+	float32_t dx = a_exact.m_translation.x - a_approximate.m_translation.x;
+	float32_t dy = a_exact.m_translation.y - a_approximate.m_translation.y;
+	float32_t dz = a_exact.m_translation.z - a_approximate.m_translation.z;
+
+	float32_t cosine = std::min(std::fabs(quaternion_dot(a_exact.m_rotation, a_approximate.m_rotation)), 1.0f);
+	float32_t angle  = 2.0f * std::acos(cosine);
+
+	float32_t scale = std::max(std::fabs(a_exact.m_scale.x - a_approximate.m_scale.x),
+	                           std::max(std::fabs(a_exact.m_scale.y - a_approximate.m_scale.y), std::fabs(a_exact.m_scale.z - a_approximate.m_scale.z)));
+
+	return std::sqrt(dx * dx + dy * dy + dz * dz) + (angle + scale) * a_length;
+}
+
+// Tolerances are per sorted node, only entries for animated nodes are used
+inline CompressedClip compress_clip(const SkeletonView &a_skeleton, const AnimationClip &a_clip, const std::vector<float32_t> &a_tolerances)
+{
+	const uint32_t node_count = a_skeleton.node_count();
+	const uint32_t key_count  = a_clip.key_count();
+
+	assert(a_tolerances.size() == node_count && "Need one tolerance per node");
+	assert(key_count > 1 && "Clip needs at least two keys to be sampled");
+	assert(key_count <= 65536 && "Key frames must fit in 16 bits");
+
+	// Longest child offset approximates how far rotation errors travel, leaves and tiny bones use a minimum
+	std::vector<float32_t> lengths(node_count, 0.1f);
+	for (uint32_t i = 0; i < node_count; ++i)
+	{
+		int32_t parent = a_skeleton.m_parents[i];
+		if (parent != -1)
+		{
+			const float32_t *m = a_skeleton.m_bind_locals[i].m_values;
+			lengths[static_cast<uint32_t>(parent)] = std::max(lengths[static_cast<uint32_t>(parent)], std::sqrt(m[12] * m[12] + m[13] * m[13] + m[14] * m[14]));
+		}
+	}
+
+	CompressedClip compressed;
+	compressed.m_times         = a_clip.m_times;
+	compressed.m_animated_mask = a_clip.m_animated_mask;
+
+	std::vector<CompressedKey> keys(key_count);
+	std::vector<Transform>     decoded(key_count);
+
+	const Transform *source = a_clip.m_keys.data();
+
+	for (uint32_t node = 0; node < node_count; ++node)
+	{
+		if (!a_clip.is_animated(node))
+			continue;
+
+		CompressedTrack track;
+
+		Vector3f translation_maximum, scale_maximum;
+		track.m_translation_minimum = translation_maximum = source[0].m_translation;
+		track.m_scale_minimum = scale_maximum = source[0].m_scale;
+
+		for (uint32_t k = 1; k < key_count; ++k)
+		{
+			const Vector3f &t = source[k].m_translation;
+			const Vector3f &s = source[k].m_scale;
+
+			track.m_translation_minimum = Vector3f{std::min(track.m_translation_minimum.x, t.x), std::min(track.m_translation_minimum.y, t.y), std::min(track.m_translation_minimum.z, t.z)};
+			translation_maximum         = Vector3f{std::max(translation_maximum.x, t.x), std::max(translation_maximum.y, t.y), std::max(translation_maximum.z, t.z)};
+			track.m_scale_minimum       = Vector3f{std::min(track.m_scale_minimum.x, s.x), std::min(track.m_scale_minimum.y, s.y), std::min(track.m_scale_minimum.z, s.z)};
+			scale_maximum               = Vector3f{std::max(scale_maximum.x, s.x), std::max(scale_maximum.y, s.y), std::max(scale_maximum.z, s.z)};
+		}
+
+		track.m_translation_extent = translation_maximum - track.m_translation_minimum;
+		track.m_scale_extent       = scale_maximum - track.m_scale_minimum;
+
+		for (uint32_t k = 0; k < key_count; ++k)
+		{
+			const Transform &transform = source[k];
+			CompressedKey   &key       = keys[k];
+
+			key.m_rotation       = quantize_rotation(transform.m_rotation);
+			key.m_translation[0] = quantize_unorm16(transform.m_translation.x, track.m_translation_minimum.x, track.m_translation_extent.x);
+			key.m_translation[1] = quantize_unorm16(transform.m_translation.y, track.m_translation_minimum.y, track.m_translation_extent.y);
+			key.m_translation[2] = quantize_unorm16(transform.m_translation.z, track.m_translation_minimum.z, track.m_translation_extent.z);
+			key.m_scale[0]       = quantize_unorm16(transform.m_scale.x, track.m_scale_minimum.x, track.m_scale_extent.x);
+			key.m_scale[1]       = quantize_unorm16(transform.m_scale.y, track.m_scale_minimum.y, track.m_scale_extent.y);
+			key.m_scale[2]       = quantize_unorm16(transform.m_scale.z, track.m_scale_minimum.z, track.m_scale_extent.z);
+
+			decoded[k] = decompress_key(track, key);
+		}
+
+		const float32_t tolerance = a_tolerances[node];
+		const float32_t length    = lengths[node];
+
+		// Greedy reduction, extend each segment as far as every skipped key is still within tolerance
+		auto segment_fits = [&](uint32_t a_begin, uint32_t a_end) {
+			for (uint32_t k = a_begin + 1; k < a_end; ++k)
+			{
+				float32_t t = static_cast<float32_t>(k - a_begin) / static_cast<float32_t>(a_end - a_begin);
+				if (transform_error(source[k], transform_interpolate(decoded[a_begin], decoded[a_end], t), length) > tolerance)
+					return false;
+			}
+			return true;
+		};
+
+		track.m_first_key = static_cast<uint32_t>(compressed.m_keys.size());
+
+		uint32_t anchor = 0;
+		compressed.m_frames.push_back(0);
+		compressed.m_keys.push_back(keys[0]);
+
+		while (anchor + 1 < key_count)
+		{
+			uint32_t end = anchor + 1;
+			while (end + 1 < key_count && segment_fits(anchor, end + 1))
+				++end;
+
+			compressed.m_frames.push_back(static_cast<uint16_t>(end));
+			compressed.m_keys.push_back(keys[end]);
+			anchor = end;
+		}
+
+		track.m_key_count = static_cast<uint32_t>(compressed.m_keys.size()) - track.m_first_key;
+
+		// Whole track collapsed to its end points, if every key is within tolerance of the first one keep a single constant key
+		bool constant = track.m_key_count == 2;
+		for (uint32_t k = 1; constant && k < key_count; ++k)
+			constant = transform_error(source[k], decoded[0], length) <= tolerance;
+
+		if (constant)
+		{
+			compressed.m_frames.pop_back();
+			compressed.m_keys.pop_back();
+			track.m_key_count = 1;
+		}
+
+		compressed.m_tracks.push_back(track);
+		source += key_count;
+	}
+
+	return compressed;
+}
+
+inline CompressedClip compress_clip(const SkeletonView &a_skeleton, const AnimationClip &a_clip, float32_t a_tolerance = 0.001f)
+{
+	return compress_clip(a_skeleton, a_clip, std::vector<float32_t>(a_skeleton.node_count(), a_tolerance));
+}
+
+// Converts seconds into the clip to the keyframe and time since that keyframe, a_time is clamped to the clip
+inline std::pair<uint32_t, double> clip_keyframe_at(const CompressedClipView &a_clip, float32_t a_time)
+{
+	assert(a_clip.key_count() > 1 && "Clip needs at least two keys to be sampled");
+
+	const float32_t *times    = a_clip.m_times.data();
+	uint32_t         keyframe = static_cast<uint32_t>(std::upper_bound(times, times + a_clip.key_count(), a_time) - times);
+	keyframe                  = std::min(std::max(keyframe, 1u), a_clip.key_count() - 1) - 1;
+
+	float32_t delta = std::min(std::max(a_time - times[keyframe], 0.0f), times[keyframe + 1] - times[keyframe]);
+
+	return std::make_pair(keyframe, static_cast<double>(delta));
+}
+
+// Fractional source keyframe, same time semantics as the uncompressed evaluate_pose()
+FORCE_INLINE float32_t clip_frame(const CompressedClipView &a_clip, uint32_t a_keyframe, double a_delta_time)
+{
+	assert(a_keyframe + 1 < a_clip.key_count());
+
+	float32_t a = a_clip.m_times[a_keyframe];
+	float32_t b = a_clip.m_times[a_keyframe + 1];
+
+	return static_cast<float32_t>(a_keyframe) + static_cast<float32_t>(a_delta_time) / (b - a);
+}
+
+// Tracks with removed keys are interpolated across the gap
+inline Transform sample_track(const CompressedClipView &a_clip, const CompressedTrack &a_track, uint32_t a_keyframe, float32_t a_frame)
+{
+	const uint16_t      *frames = a_clip.m_frames.data() + a_track.m_first_key;
+	const CompressedKey *keys   = a_clip.m_keys.data() + a_track.m_first_key;
+
+	if (a_track.m_key_count == 1)
+		return decompress_key(a_track, keys[0]);
+
+	// First kept key after a_keyframe, or the last one, binary searched so long tracks stay O(log keys)
+	uint32_t next = static_cast<uint32_t>(std::upper_bound(frames + 1, frames + a_track.m_key_count - 1, a_keyframe) - frames);
+
+	float32_t f0 = static_cast<float32_t>(frames[next - 1]);
+	float32_t f1 = static_cast<float32_t>(frames[next]);
+
+	return transform_interpolate(decompress_key(a_track, keys[next - 1]), decompress_key(a_track, keys[next]), (a_frame - f0) / (f1 - f0));
+}
+
+// Set bits in a_skip mark sorted nodes that stay at rest pose even if they have a track, for animation LOD
+FORCE_INLINE bool is_skipped(const uint64_t *a_skip, uint32_t a_node)
+{
+	return a_skip && ((a_skip[a_node >> 6] >> (a_node & 63)) & 1u);
+}
+
+// Writes local matrices of all nodes, nodes without a track or skipped by a_skip get their rest pose
+inline void sample_locals(const SkeletonView &a_skeleton, const CompressedClipView &a_clip, uint32_t a_keyframe, double a_delta_time, Pose &a_pose, const uint64_t *a_skip = nullptr)
+{
+	const uint32_t node_count = a_skeleton.node_count();
+
+	assert(a_pose.m_worlds.size() == node_count && "Pose not allocated for this skeleton");
+
+	float32_t              frame = clip_frame(a_clip, a_keyframe, a_delta_time);
+	const CompressedTrack *track = a_clip.m_tracks.data();
+
+	for (uint32_t i = 0; i < node_count; ++i)
+	{
+		if (!a_clip.is_animated(i))
+			a_pose.m_locals[i] = a_skeleton.m_bind_locals[i];
+		else if (is_skipped(a_skip, i))
+		{
+			a_pose.m_locals[i] = a_skeleton.m_bind_locals[i];
+			++track;
+		}
+		else
+			a_pose.m_locals[i] = transform_to_matrix(sample_track(a_clip, *track++, a_keyframe, frame));
+	}
+}
+
+// Same as sample_locals() but keeps the decomposed transforms for blending, a_rest holds the rest pose of every node
+inline void sample_transforms(const CompressedClipView &a_clip, const Transform *a_rest, uint32_t a_node_count, uint32_t a_keyframe, double a_delta_time, Transform *a_out,
+                              const uint64_t *a_skip = nullptr)
+{
+	float32_t              frame = clip_frame(a_clip, a_keyframe, a_delta_time);
+	const CompressedTrack *track = a_clip.m_tracks.data();
+
+	for (uint32_t i = 0; i < a_node_count; ++i)
+	{
+		if (!a_clip.is_animated(i))
+			a_out[i] = a_rest[i];
+		else if (is_skipped(a_skip, i))
+		{
+			a_out[i] = a_rest[i];
+			++track;
+		}
+		else
+			a_out[i] = sample_track(a_clip, *track++, a_keyframe, frame);
+	}
+}
+
+inline void evaluate_pose(const SkeletonView &a_skeleton, const CompressedClipView &a_clip, uint32_t a_keyframe, double a_delta_time, Pose &a_pose)
+{
+	sample_locals(a_skeleton, a_clip, a_keyframe, a_delta_time, a_pose);
+	update_worlds(a_skeleton, a_pose);
+	update_palette(a_skeleton, a_pose);
+}
+
+}        // namespace ror
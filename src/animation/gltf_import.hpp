@@ -0,0 +1,282 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "animation/animation_clip.hpp"
+#include "animation/skeleton.hpp"
+#include "animation/transform.hpp"
+#include "cgltf.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <foundation/rortypes.hpp>
+#include <profiling/rorlog.hpp>
+#include <string>
+#include <vector>
+
+/*  glTF skin import usage
+ *  Offline only, used by the animation converter. Reads the first skin of a glTF file into a Skeleton
+ *  and every animation into an AnimationClip. Channels in glTF have their own key times and
+ *  interpolation so all of them are resampled at a fixed rate into the shared key times clips use.
+ *  Nodes that are not part of the skin are kept so transforms of non joint parents still apply.
+ *  The translation unit that includes this must also provide the cgltf implementation.
+ */
+
+namespace ror
+{
+namespace detail
+{
+// Samples a_components floats per key at a_time, cubic spline outputs are in-tangent, value, out-tangent per key
+inline void sample_gltf_sampler(const cgltf_animation_sampler &a_sampler, float32_t a_time, float32_t *a_out, uint32_t a_components)
+{
+	const cgltf_accessor *input  = a_sampler.input;
+	const cgltf_accessor *output = a_sampler.output;
+	const bool            cubic  = a_sampler.interpolation == cgltf_interpolation_type_cubic_spline;
+	const cgltf_size      count  = input->count;
+
+	auto read = [&](cgltf_size a_key, cgltf_size a_element, float32_t *a_values) {
+		cgltf_accessor_read_float(output, cubic ? a_key * 3 + a_element : a_key, a_values, a_components);
+	};
+
+	float32_t first_time = 0.0f, last_time = 0.0f;
+	cgltf_accessor_read_float(input, 0, &first_time, 1);
+	cgltf_accessor_read_float(input, count - 1, &last_time, 1);
+
+	if (count == 1 || a_time <= first_time)
+	{
+		read(0, 1, a_out);
+		return;
+	}
+
+	if (a_time >= last_time)
+	{
+		read(count - 1, 1, a_out);
+		return;
+	}
+
+	cgltf_size next = 1;
+	float32_t  t0 = first_time, t1 = first_time;
+	for (; next < count; ++next)
+	{
+		cgltf_accessor_read_float(input, next, &t1, 1);
+		if (t1 > a_time)
+			break;
+		t0 = t1;
+	}
+
+	float32_t v0[4], v1[4];
+	read(next - 1, 1, v0);
+	read(next, 1, v1);
+
+	float32_t delta = t1 - t0;
+	float32_t t     = delta > 0.0f ? (a_time - t0) / delta : 0.0f;
+
+	if (a_sampler.interpolation == cgltf_interpolation_type_step)
+	{
+		std::copy(v0, v0 + a_components, a_out);
+	}
+	else if (cubic)
+	{
+		float32_t b0[4], a1[4];
+		read(next - 1, 2, b0);
+		read(next, 0, a1);
+
+		float32_t t2 = t * t, t3 = t2 * t;
+		for (uint32_t i = 0; i < a_components; ++i)
+			a_out[i] = (2.0f * t3 - 3.0f * t2 + 1.0f) * v0[i] + (t3 - 2.0f * t2 + t) * delta * b0[i] + (-2.0f * t3 + 3.0f * t2) * v1[i] + (t3 - t2) * delta * a1[i];
+	}
+	else if (a_components == 4)
+	{
+		Vector4f q = quaternion_slerp(Vector4f{v0[0], v0[1], v0[2], v0[3]}, Vector4f{v1[0], v1[1], v1[2], v1[3]}, t);
+		a_out[0]   = q.x;
+		a_out[1]   = q.y;
+		a_out[2]   = q.z;
+		a_out[3]   = q.w;
+	}
+	else
+	{
+		for (uint32_t i = 0; i < a_components; ++i)
+			a_out[i] = v0[i] + (v1[i] - v0[i]) * t;
+	}
+}
+
+inline Matrix4f gltf_local_matrix(const cgltf_node &a_node)
+{
+	Matrix4f matrix;
+	cgltf_node_transform_local(&a_node, matrix.m_values);
+	return matrix;
+}
+}        // namespace detail
+
+inline bool skin_from_gltf(const std::filesystem::path &a_file_path, Skeleton &a_skeleton, std::vector<AnimationClip> &a_clips, float32_t a_sample_rate = 30.0f)
+{
+	cgltf_options options{};
+	cgltf_data   *data{nullptr};
+
+	std::string file_name = a_file_path.string();
+
+	if (cgltf_parse_file(&options, file_name.c_str(), &data) != cgltf_result_success)
+	{
+		ror::log_critical("Can't parse glTF file {}", file_name);
+		return false;
+	}
+
+	if (cgltf_load_buffers(&options, data, file_name.c_str()) != cgltf_result_success || data->skins_count == 0)
+	{
+		ror::log_critical("glTF file {} has no loadable skin", file_name);
+		cgltf_free(data);
+		return false;
+	}
+
+	if (data->skins_count > 1)
+		ror::log_warn("glTF file {} has {} skins, only the first one is converted", file_name, data->skins_count);
+
+	const cgltf_skin &skin       = data->skins[0];
+	const uint32_t    node_count = static_cast<uint32_t>(data->nodes_count);
+
+	std::vector<int32_t>  parents(node_count);
+	std::vector<Matrix4f> locals(node_count);
+	std::vector<uint32_t> joint_nodes(skin.joints_count);
+	std::vector<Matrix4f> skinning_binds(skin.joints_count);
+
+	for (uint32_t i = 0; i < node_count; ++i)
+	{
+		const cgltf_node &node = data->nodes[i];
+
+		parents[i] = node.parent ? static_cast<int32_t>(node.parent - data->nodes) : -1;
+		locals[i]  = detail::gltf_local_matrix(node);
+	}
+
+	// glTF has no bind shape matrix, mesh space is already the skin space
+	for (cgltf_size i = 0; i < skin.joints_count; ++i)
+	{
+		joint_nodes[i] = static_cast<uint32_t>(skin.joints[i] - data->nodes);
+
+		if (skin.inverse_bind_matrices)
+			cgltf_accessor_read_float(skin.inverse_bind_matrices, i, skinning_binds[i].m_values, 16);
+	}
+
+	a_skeleton = skeleton_from_hierarchy(parents, locals, joint_nodes, skinning_binds);
+
+	for (cgltf_size a = 0; a < data->animations_count; ++a)
+	{
+		const cgltf_animation &animation = data->animations[a];
+
+		float32_t duration = 0.0f;
+		for (cgltf_size c = 0; c < animation.channels_count; ++c)
+		{
+			const cgltf_accessor *input = animation.channels[c].sampler->input;
+			float32_t             last  = 0.0f;
+			cgltf_accessor_read_float(input, input->count - 1, &last, 1);
+			duration = std::max(duration, last);
+		}
+
+		AnimationClip clip;
+
+		// A zero length animation is a static pose, held for one sample step since clips need a pair of keys to interpolate
+		// Stops at the first step reaching the end so rounding in duration * a_sample_rate can't repeat the last time
+		float32_t end = std::max(duration, 1.0f / a_sample_rate);
+		for (uint32_t k = 0; clip.m_times.empty() || clip.m_times.back() < end; ++k)
+			clip.m_times.push_back(std::min(static_cast<float32_t>(k) / a_sample_rate, end));
+
+		const uint32_t key_count = static_cast<uint32_t>(clip.m_times.size());
+
+		clip.m_animated_mask.resize((node_count + 63) / 64, 0);
+
+		// Channels per sorted node, index 0 translation, 1 rotation, 2 scale
+		std::vector<std::array<const cgltf_animation_sampler *, 3>> channels(node_count, {nullptr, nullptr, nullptr});
+		for (cgltf_size c = 0; c < animation.channels_count; ++c)
+		{
+			const cgltf_animation_channel &channel = animation.channels[c];
+			if (!channel.target_node)
+				continue;
+
+			uint32_t node = a_skeleton.m_sorted_index[static_cast<uint32_t>(channel.target_node - data->nodes)];
+
+			switch (channel.target_path)
+			{
+				case cgltf_animation_path_type_translation:
+					channels[node][0] = channel.sampler;
+					break;
+				case cgltf_animation_path_type_rotation:
+					channels[node][1] = channel.sampler;
+					break;
+				case cgltf_animation_path_type_scale:
+					channels[node][2] = channel.sampler;
+					break;
+				default:
+					break;        // Morph target weights are not part of skeletal animation
+			}
+		}
+
+		for (uint32_t i = 0; i < node_count; ++i)
+		{
+			if (!channels[i][0] && !channels[i][1] && !channels[i][2])
+				continue;
+
+			clip.set_animated(i);
+
+			// Paths without a channel keep the rest pose value
+			Transform rest = transform_from_matrix(a_skeleton.m_bind_locals[i]);
+
+			for (uint32_t k = 0; k < key_count; ++k)
+			{
+				Transform key = rest;
+				float32_t values[4];
+
+				if (channels[i][0])
+				{
+					detail::sample_gltf_sampler(*channels[i][0], clip.m_times[k], values, 3);
+					key.m_translation = Vector3f{values[0], values[1], values[2]};
+				}
+				if (channels[i][1])
+				{
+					detail::sample_gltf_sampler(*channels[i][1], clip.m_times[k], values, 4);
+					key.m_rotation = quaternion_normalize(Vector4f{values[0], values[1], values[2], values[3]});
+				}
+				if (channels[i][2])
+				{
+					detail::sample_gltf_sampler(*channels[i][2], clip.m_times[k], values, 3);
+					key.m_scale = Vector3f{values[0], values[1], values[2]};
+				}
+
+				clip.m_keys.push_back(key);
+			}
+		}
+
+		a_clips.push_back(std::move(clip));
+	}
+
+	cgltf_free(data);
+
+	return true;
+}
+
+}        // namespace ror
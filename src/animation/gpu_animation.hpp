@@ -0,0 +1,318 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+#pragma once
+
+#include "animation/compressed_clip.hpp"
+#include "animation/skeleton.hpp"
+#include "animation/transform.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <foundation/rormacros.hpp>
+#include <foundation/rortypes.hpp>
+#include <math/rormatrix4.hpp>
+#include <vector>
+
+/*  GPU animation usage
+ *  build_gpu_animation_tables() flattens a skeleton and its compressed clips into one array of 32 bit words
+ *  for animation.comp to read from a storage buffer. Keys stay compressed so the tables are about the size
+ *  of the clips. The array starts with a GpuAnimationHeader, every offset in it and in the sections after it
+ *  is in words from the start of the array so the shader never needs more than one buffer.
+ *  Per frame the only input is one GpuAnimationInstance per character, the clip it plays and the seconds
+ *  into it as ClipPlayer::time() reports. The shader samples every node, runs the hierarchy one level at a
+ *  time in shared memory and writes the palette straight into the buffer skinning.comp reads.
+ *  sample_gpu_animation() walks the tables the same way on the CPU, it is the reference the shader follows.
+ *  Blending, LOD and pose sharing stay CPU only, an instance on the GPU path plays a single clip.
+ */
+
+namespace ror
+{
+constexpr uint32_t gpu_animation_group_size = 64;                // local_size_x of animation.comp, one group per instance
+constexpr uint32_t gpu_animation_max_nodes  = 128;               // Shared memory worlds in animation.comp, 8 KB
+constexpr uint32_t gpu_animation_no_track   = 0xffffffffu;       // Node track entry of nodes that stay at rest pose
+constexpr uint32_t gpu_animation_track_size = 14;                // Words per track, ranges then key count and first key
+constexpr uint32_t gpu_animation_key_size   = 6;                 // Words per key, source frame then CompressedKey without padding
+constexpr uint32_t gpu_animation_clip_size  = 4;                 // Words per clip, times, key count and node tracks
+
+struct GpuAnimationHeader
+{
+	uint32_t m_node_count;            // Nodes in sorted order
+	uint32_t m_joint_count;           // Palette joints written per instance
+	uint32_t m_level_count;           // Depth levels, m_levels has one more entry
+	uint32_t m_clip_count;            // Clips GpuAnimationInstance::m_clip can refer to
+	uint32_t m_levels;                // First sorted node of each level
+	uint32_t m_parents;               // Parent per node, -1 for roots
+	uint32_t m_bind_locals;           // Rest pose locals, 16 floats per node
+	uint32_t m_joints;                // Sorted node of every joint
+	uint32_t m_skinning_binds;        // 16 floats per joint
+	uint32_t m_clips;                 // gpu_animation_clip_size words per clip
+};
+
+// std430 layout of Instance in animation.comp
+struct GpuAnimationInstance
+{
+	float32_t m_time;        // Seconds into the clip, already wrapped by the clip player
+	uint32_t  m_clip;        // Index into the clips the tables were built from
+};
+
+struct GpuAnimationTables
+{
+	GpuAnimationHeader header() const
+	{
+		GpuAnimationHeader header;
+		std::memcpy(&header, this->m_words.data(), sizeof(GpuAnimationHeader));
+		return header;
+	}
+
+	size_t size_in_bytes() const
+	{
+		return this->m_words.size() * sizeof(uint32_t);
+	}
+
+	std::vector<uint32_t> m_words;        // Header then all sections, uploaded as is
+};
+
+namespace detail
+{
+FORCE_INLINE uint32_t float_word(float32_t a_value)
+{
+	uint32_t word;
+	std::memcpy(&word, &a_value, sizeof(uint32_t));
+	return word;
+}
+
+FORCE_INLINE float32_t word_float(uint32_t a_word)
+{
+	float32_t value;
+	std::memcpy(&value, &a_word, sizeof(float32_t));
+	return value;
+}
+
+inline void append_matrices(std::vector<uint32_t> &a_words, const Matrix4f *a_matrices, uint32_t a_count)
+{
+	for (uint32_t i = 0; i < a_count; ++i)
+		for (float32_t value : a_matrices[i].m_values)
+			a_words.push_back(float_word(value));
+}
+
+inline Matrix4f read_matrix(const uint32_t *a_words)
+{
+	Matrix4f matrix;
+	for (uint32_t i = 0; i < 16; ++i)
+		matrix.m_values[i] = word_float(a_words[i]);
+	return matrix;
+}
+
+inline Transform read_key(const uint32_t *a_track, const uint32_t *a_key)
+{
+	CompressedTrack track;
+	track.m_translation_minimum = Vector3f{word_float(a_track[0]), word_float(a_track[1]), word_float(a_track[2])};
+	track.m_translation_extent  = Vector3f{word_float(a_track[3]), word_float(a_track[4]), word_float(a_track[5])};
+	track.m_scale_minimum       = Vector3f{word_float(a_track[6]), word_float(a_track[7]), word_float(a_track[8])};
+	track.m_scale_extent        = Vector3f{word_float(a_track[9]), word_float(a_track[10]), word_float(a_track[11])};
+
+	CompressedKey key;
+	key.m_rotation       = uint64_t{a_key[1]} | (uint64_t{a_key[2]} << 32);
+	key.m_translation[0] = static_cast<uint16_t>(a_key[3] & 0xffffu);
+	key.m_translation[1] = static_cast<uint16_t>(a_key[3] >> 16);
+	key.m_translation[2] = static_cast<uint16_t>(a_key[4] & 0xffffu);
+	key.m_scale[0]       = static_cast<uint16_t>(a_key[4] >> 16);
+	key.m_scale[1]       = static_cast<uint16_t>(a_key[5] & 0xffffu);
+	key.m_scale[2]       = static_cast<uint16_t>(a_key[5] >> 16);
+
+	return decompress_key(track, key);
+}
+}        // namespace detail
+
+inline GpuAnimationTables build_gpu_animation_tables(const SkeletonView &a_skeleton, const std::vector<CompressedClipView> &a_clips)
+{
+	const uint32_t node_count  = a_skeleton.node_count();
+	const uint32_t joint_count = a_skeleton.joint_count();
+
+	assert(node_count <= gpu_animation_max_nodes && "Skeleton doesn't fit in animation.comp shared memory");
+	assert(!a_clips.empty() && "Need at least one clip");
+
+	GpuAnimationHeader header;
+	header.m_node_count  = node_count;
+	header.m_joint_count = joint_count;
+	header.m_level_count = a_skeleton.m_level_offsets.size() - 1;
+	header.m_clip_count  = static_cast<uint32_t>(a_clips.size());
+
+	GpuAnimationTables     tables;
+	std::vector<uint32_t> &words = tables.m_words;
+	words.resize(sizeof(GpuAnimationHeader) / sizeof(uint32_t));
+
+	header.m_levels = static_cast<uint32_t>(words.size());
+	words.insert(words.end(), a_skeleton.m_level_offsets.begin(), a_skeleton.m_level_offsets.end());
+
+	header.m_parents = static_cast<uint32_t>(words.size());
+	for (int32_t parent : a_skeleton.m_parents)
+		words.push_back(static_cast<uint32_t>(parent));
+
+	header.m_bind_locals = static_cast<uint32_t>(words.size());
+	detail::append_matrices(words, a_skeleton.m_bind_locals.data(), node_count);
+
+	header.m_joints = static_cast<uint32_t>(words.size());
+	words.insert(words.end(), a_skeleton.m_joints.begin(), a_skeleton.m_joints.end());
+
+	header.m_skinning_binds = static_cast<uint32_t>(words.size());
+	detail::append_matrices(words, a_skeleton.m_skinning_binds.data(), joint_count);
+
+	// Clip records are filled in as their sections are appended after them
+	header.m_clips = static_cast<uint32_t>(words.size());
+	words.resize(words.size() + a_clips.size() * gpu_animation_clip_size, 0u);
+
+	for (uint32_t c = 0; c < a_clips.size(); ++c)
+	{
+		const CompressedClipView &clip   = a_clips[c];
+		const uint32_t            record = header.m_clips + c * gpu_animation_clip_size;
+
+		assert(clip.key_count() > 1 && "Clip needs at least two keys to be sampled");
+
+		words[record + 0] = static_cast<uint32_t>(words.size());
+		words[record + 1] = clip.key_count();
+		for (float32_t time : clip.m_times)
+			words.push_back(detail::float_word(time));
+
+		uint32_t node_tracks = static_cast<uint32_t>(words.size());
+		words[record + 2]    = node_tracks;
+		words.resize(words.size() + node_count, gpu_animation_no_track);
+
+		const CompressedTrack *next_track = clip.m_tracks.data();
+
+		for (uint32_t node = 0; node < node_count; ++node)
+		{
+			if (!clip.is_animated(node))
+				continue;
+
+			const CompressedTrack *track = next_track++;
+			words[node_tracks + node]    = static_cast<uint32_t>(words.size());
+
+			for (const Vector3f *range : {&track->m_translation_minimum, &track->m_translation_extent, &track->m_scale_minimum, &track->m_scale_extent})
+			{
+				words.push_back(detail::float_word(range->x));
+				words.push_back(detail::float_word(range->y));
+				words.push_back(detail::float_word(range->z));
+			}
+
+			words.push_back(track->m_key_count);
+			words.push_back(static_cast<uint32_t>(words.size()) + 1);        // Keys follow the track
+
+			for (uint32_t k = 0; k < track->m_key_count; ++k)
+			{
+				const CompressedKey &key = clip.m_keys[track->m_first_key + k];
+
+				words.push_back(clip.m_frames[track->m_first_key + k]);
+				words.push_back(static_cast<uint32_t>(key.m_rotation));
+				words.push_back(static_cast<uint32_t>(key.m_rotation >> 32));
+				words.push_back(uint32_t{key.m_translation[0]} | (uint32_t{key.m_translation[1]} << 16));
+				words.push_back(uint32_t{key.m_translation[2]} | (uint32_t{key.m_scale[0]} << 16));
+				words.push_back(uint32_t{key.m_scale[1]} | (uint32_t{key.m_scale[2]} << 16));
+			}
+		}
+	}
+
+	std::memcpy(words.data(), &header, sizeof(GpuAnimationHeader));
+
+	return tables;
+}
+
+// Reference for animation.comp, writes joint_count matrices of a_instance to a_palette
+inline void sample_gpu_animation(const GpuAnimationTables &a_tables, const GpuAnimationInstance &a_instance, Matrix4f *a_palette)
+{
+	const uint32_t          *words  = a_tables.m_words.data();
+	const GpuAnimationHeader header = a_tables.header();
+
+	assert(a_instance.m_clip < header.m_clip_count && "Clip index out of range");
+
+	const uint32_t *clip      = words + header.m_clips + a_instance.m_clip * gpu_animation_clip_size;
+	const uint32_t *times     = words + clip[0];
+	const uint32_t  key_count = clip[1];
+
+	// Same as clip_keyframe_at() and clip_frame()
+	uint32_t keyframe = 1;
+	while (keyframe < key_count - 1 && detail::word_float(times[keyframe]) <= a_instance.m_time)
+		++keyframe;
+	--keyframe;
+
+	float32_t start = detail::word_float(times[keyframe]);
+	float32_t end   = detail::word_float(times[keyframe + 1]);
+	float32_t frame = static_cast<float32_t>(keyframe) + std::min(std::max(a_instance.m_time - start, 0.0f), end - start) / (end - start);
+
+	std::vector<Matrix4f> worlds(header.m_node_count);
+
+	for (uint32_t node = 0; node < header.m_node_count; ++node)
+	{
+		uint32_t track = words[clip[2] + node];
+
+		if (track == gpu_animation_no_track)
+		{
+			worlds[node] = detail::read_matrix(words + header.m_bind_locals + node * 16);
+			continue;
+		}
+
+		const uint32_t *ranges        = words + track;
+		const uint32_t  track_keys    = ranges[12];
+		const uint32_t *keys          = words + ranges[13];
+		Transform       local;
+
+		if (track_keys == 1)
+			local = detail::read_key(ranges, keys);
+		else
+		{
+			// Same binary search as animation.comp, first kept key after keyframe or the last one
+			uint32_t next = 1;
+			uint32_t high = track_keys - 1;
+			while (next < high)
+			{
+				uint32_t middle = (next + high) / 2;
+				if (keys[middle * gpu_animation_key_size] <= keyframe)
+					next = middle + 1;
+				else
+					high = middle;
+			}
+
+			const uint32_t *from = keys + (next - 1) * gpu_animation_key_size;
+			const uint32_t *to   = keys + next * gpu_animation_key_size;
+			float32_t       f0   = static_cast<float32_t>(from[0]);
+			float32_t       f1   = static_cast<float32_t>(to[0]);
+
+			local = transform_interpolate(detail::read_key(ranges, from), detail::read_key(ranges, to), (frame - f0) / (f1 - f0));
+		}
+
+		worlds[node] = transform_to_matrix(local);
+	}
+
+	// Parents are in earlier levels, so sorted order alone is enough here, the shader needs the levels to synchronise
+	for (uint32_t node = words[header.m_levels + 1]; node < header.m_node_count; ++node)
+		worlds[node] = worlds[words[header.m_parents + node]] * worlds[node];
+
+	for (uint32_t joint = 0; joint < header.m_joint_count; ++joint)
+		a_palette[joint] = worlds[words[header.m_joints + joint]] * detail::read_matrix(words + header.m_skinning_binds + joint * 16);
+}
+
+}        // namespace ror
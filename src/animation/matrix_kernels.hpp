@@ -0,0 +1,263 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <foundation/rormacros.hpp>
+#include <foundation/rortypes.hpp>
+#include <math/rormatrix4.hpp>
+#include <random>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define ROR_KERNELS_SSE 1
+#	include <immintrin.h>
+#	if defined(__GNUC__) || defined(__clang__)
+#		define ROR_KERNELS_AVX2 1
+#	endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#	define ROR_KERNELS_NEON 1
+#	include <arm_neon.h>
+#endif
+
+/*  Matrix kernels usage
+ *  Batched column-major 4x4 multiplies used by pose evaluation, out[i] = lhs[index[i]] * rhs[i].
+ *  If index is nullptr lhs is read linearly. out must not alias lhs entries read in the same batch.
+ *  Call multiply_indexed() which picks the best path available at runtime once, SSE and NEON are
+ *  baseline and AVX2 + FMA is detected with cpuid. The scalar path is the reference for verify_matrix_kernels().
+ */
+
+namespace ror
+{
+enum class MatrixKernelPath
+{
+	scalar,
+	sse,
+	avx2,
+	neon
+};
+
+using MatrixKernelFunction = void (*)(const Matrix4f *, const uint32_t *, const Matrix4f *, Matrix4f *, uint32_t);
+
+inline void multiply_indexed_scalar(const Matrix4f *a_lhs, const uint32_t *a_lhs_index, const Matrix4f *a_rhs, Matrix4f *a_out, uint32_t a_count)
+{
+	for (uint32_t i = 0; i < a_count; ++i)
+	{
+		const float32_t *a = a_lhs[a_lhs_index ? a_lhs_index[i] : i].m_values;
+		const float32_t *b = a_rhs[i].m_values;
+		float32_t       *r = a_out[i].m_values;
+
+		for (uint32_t column = 0; column < 4; ++column)
+			for (uint32_t row = 0; row < 4; ++row)
+				r[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1] + a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+	}
+}
+
+#if defined(ROR_KERNELS_SSE)
+inline void multiply_indexed_sse(const Matrix4f *a_lhs, const uint32_t *a_lhs_index, const Matrix4f *a_rhs, Matrix4f *a_out, uint32_t a_count)
+{
+	for (uint32_t i = 0; i < a_count; ++i)
+	{
+		const float32_t *a = a_lhs[a_lhs_index ? a_lhs_index[i] : i].m_values;
+		const float32_t *b = a_rhs[i].m_values;
+		float32_t       *r = a_out[i].m_values;
+
+		__m128 a0 = _mm_loadu_ps(a);
+		__m128 a1 = _mm_loadu_ps(a + 4);
+		__m128 a2 = _mm_loadu_ps(a + 8);
+		__m128 a3 = _mm_loadu_ps(a + 12);
+
+		for (uint32_t column = 0; column < 4; ++column)
+		{
+			const float32_t *bc = b + column * 4;
+
+			__m128 result = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+			result        = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+			result        = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+			result        = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+
+			_mm_storeu_ps(r + column * 4, result);
+		}
+	}
+}
+#endif
+
+#if defined(ROR_KERNELS_AVX2)
+// Computes two result columns per 256 bit register, lhs columns are duplicated into both lanes
+__attribute__((target("avx2,fma"))) inline void multiply_indexed_avx2(const Matrix4f *a_lhs, const uint32_t *a_lhs_index, const Matrix4f *a_rhs, Matrix4f *a_out, uint32_t a_count)
+{
+	for (uint32_t i = 0; i < a_count; ++i)
+	{
+		const float32_t *a = a_lhs[a_lhs_index ? a_lhs_index[i] : i].m_values;
+		const float32_t *b = a_rhs[i].m_values;
+		float32_t       *r = a_out[i].m_values;
+
+		__m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a));
+		__m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a + 4));
+		__m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a + 8));
+		__m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a + 12));
+
+		__m256 b01 = _mm256_loadu_ps(b);
+		__m256 b23 = _mm256_loadu_ps(b + 8);
+
+		__m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00));
+		r01        = _mm256_fmadd_ps(a1, _mm256_permute_ps(b01, 0x55), r01);
+		r01        = _mm256_fmadd_ps(a2, _mm256_permute_ps(b01, 0xAA), r01);
+		r01        = _mm256_fmadd_ps(a3, _mm256_permute_ps(b01, 0xFF), r01);
+
+		__m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, 0x00));
+		r23        = _mm256_fmadd_ps(a1, _mm256_permute_ps(b23, 0x55), r23);
+		r23        = _mm256_fmadd_ps(a2, _mm256_permute_ps(b23, 0xAA), r23);
+		r23        = _mm256_fmadd_ps(a3, _mm256_permute_ps(b23, 0xFF), r23);
+
+		_mm256_storeu_ps(r, r01);
+		_mm256_storeu_ps(r + 8, r23);
+	}
+}
+#endif
+
+#if defined(ROR_KERNELS_NEON)
+inline void multiply_indexed_neon(const Matrix4f *a_lhs, const uint32_t *a_lhs_index, const Matrix4f *a_rhs, Matrix4f *a_out, uint32_t a_count)
+{
+	for (uint32_t i = 0; i < a_count; ++i)
+	{
+		const float32_t *a = a_lhs[a_lhs_index ? a_lhs_index[i] : i].m_values;
+		const float32_t *b = a_rhs[i].m_values;
+		float32_t       *r = a_out[i].m_values;
+
+		float32x4_t a0 = vld1q_f32(a);
+		float32x4_t a1 = vld1q_f32(a + 4);
+		float32x4_t a2 = vld1q_f32(a + 8);
+		float32x4_t a3 = vld1q_f32(a + 12);
+
+		for (uint32_t column = 0; column < 4; ++column)
+		{
+			float32x4_t bc = vld1q_f32(b + column * 4);
+
+			float32x4_t result = vmulq_laneq_f32(a0, bc, 0);
+			result             = vfmaq_laneq_f32(result, a1, bc, 1);
+			result             = vfmaq_laneq_f32(result, a2, bc, 2);
+			result             = vfmaq_laneq_f32(result, a3, bc, 3);
+
+			vst1q_f32(r + column * 4, result);
+		}
+	}
+}
+#endif
+
+inline MatrixKernelPath matrix_kernel_best_path()
+{
+#if defined(ROR_KERNELS_AVX2)
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return MatrixKernelPath::avx2;
+#endif
+#if defined(ROR_KERNELS_SSE)
+	return MatrixKernelPath::sse;
+#elif defined(ROR_KERNELS_NEON)
+	return MatrixKernelPath::neon;
+#else
+	return MatrixKernelPath::scalar;
+#endif
+}
+
+inline MatrixKernelFunction matrix_kernel(MatrixKernelPath a_path)
+{
+	switch (a_path)
+	{
+#if defined(ROR_KERNELS_AVX2)
+		case MatrixKernelPath::avx2:
+			return multiply_indexed_avx2;
+#endif
+#if defined(ROR_KERNELS_SSE)
+		case MatrixKernelPath::sse:
+			return multiply_indexed_sse;
+#endif
+#if defined(ROR_KERNELS_NEON)
+		case MatrixKernelPath::neon:
+			return multiply_indexed_neon;
+#endif
+		default:
+			return multiply_indexed_scalar;
+	}
+}
+
+inline const char *matrix_kernel_name(MatrixKernelPath a_path)
+{
+	switch (a_path)
+	{
+		case MatrixKernelPath::scalar:
+			return "scalar";
+		case MatrixKernelPath::sse:
+			return "sse";
+		case MatrixKernelPath::avx2:
+			return "avx2";
+		case MatrixKernelPath::neon:
+			return "neon";
+	}
+
+	return "unknown";
+}
+
+FORCE_INLINE void multiply_indexed(const Matrix4f *a_lhs, const uint32_t *a_lhs_index, const Matrix4f *a_rhs, Matrix4f *a_out, uint32_t a_count)
+{
+	static const MatrixKernelFunction kernel = matrix_kernel(matrix_kernel_best_path());
+	kernel(a_lhs, a_lhs_index, a_rhs, a_out, a_count);
+}
+
+// Runs a_count random multiplies through the selected path and the scalar reference, returns true if they agree within a_tolerance
+inline bool verify_matrix_kernels(MatrixKernelPath a_path = matrix_kernel_best_path(), uint32_t a_count = 256, float32_t a_tolerance = 1e-4f)
+{
+	std::mt19937                              generator{7};
+	std::uniform_real_distribution<float32_t> distribution{-2.0f, 2.0f};
+
+	std::vector<Matrix4f> lhs(a_count), rhs(a_count), reference(a_count), result(a_count);
+	std::vector<uint32_t> index(a_count);
+
+	for (uint32_t i = 0; i < a_count; ++i)
+	{
+		for (uint32_t j = 0; j < 16; ++j)
+		{
+			lhs[i].m_values[j] = distribution(generator);
+			rhs[i].m_values[j] = distribution(generator);
+		}
+		index[i] = (i * 7) % a_count;
+	}
+
+	multiply_indexed_scalar(lhs.data(), index.data(), rhs.data(), reference.data(), a_count);
+	matrix_kernel(a_path)(lhs.data(), index.data(), rhs.data(), result.data(), a_count);
+
+	for (uint32_t i = 0; i < a_count; ++i)
+		for (uint32_t j = 0; j < 16; ++j)
+			if (std::fabs(reference[i].m_values[j] - result[i].m_values[j]) > a_tolerance)
+				return false;
+
+	return true;
+}
+
+}        // namespace ror
@@ -0,0 +1,208 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "animation/array_view.hpp"
+#include "animation/matrix_kernels.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <foundation/rortypes.hpp>
+#include <math/rormatrix4.hpp>
+#include <numeric>
+#include <vector>
+
+/*  Skeleton usage
+ *  Create once from a node hierarchy with skeleton_from_hierarchy(), this sorts the hierarchy
+ *  so that every parent comes before all of its children and each depth level is contiguous.
+ *  Then per frame call evaluate_pose() from animation_clip.hpp which computes each local and
+ *  each world transform exactly once. Worlds and palette are computed a whole level at a time
+ *  with the batched kernels from matrix_kernels.hpp.
+ *  Runtime code only works on SkeletonView, which can point into a Skeleton or a mapped asset.
+ *  All indices inside Skeleton and Pose are in sorted order unless stated otherwise.
+ */
+
+namespace ror
+{
+struct SkeletonView
+{
+	uint32_t node_count() const
+	{
+		return this->m_parents.size();
+	}
+
+	uint32_t joint_count() const
+	{
+		return this->m_joints.size();
+	}
+
+	ArrayView<int32_t>  m_parents;              // Parent of each node in sorted order, -1 for roots
+	ArrayView<Matrix4f> m_bind_locals;          // Rest pose local transforms
+	ArrayView<uint32_t> m_joints;               // Palette index to sorted node index
+	ArrayView<Matrix4f> m_skinning_binds;       // Per palette joint bind_shape * inverse_bind
+	ArrayView<uint32_t> m_level_offsets;        // First sorted node of each depth level, last entry is node_count
+};
+
+struct Skeleton
+{
+	uint32_t node_count() const
+	{
+		return static_cast<uint32_t>(this->m_parents.size());
+	}
+
+	uint32_t joint_count() const
+	{
+		return static_cast<uint32_t>(this->m_joints.size());
+	}
+
+	operator SkeletonView() const
+	{
+		return SkeletonView{this->m_parents, this->m_bind_locals, this->m_joints, this->m_skinning_binds, this->m_level_offsets};
+	}
+
+	std::vector<int32_t>  m_parents;              // Parent of each node in sorted order, -1 for roots
+	std::vector<uint32_t> m_source_index;         // Sorted index to original node index
+	std::vector<uint32_t> m_sorted_index;         // Original node index to sorted index
+	std::vector<Matrix4f> m_bind_locals;          // Rest pose local transforms, already converted from collada row-major
+	std::vector<uint32_t> m_joints;               // Palette index to sorted node index, in original joint order
+	std::vector<Matrix4f> m_skinning_binds;       // Per palette joint bind_shape * inverse_bind, premultiplied at load time
+	std::vector<uint32_t> m_level_offsets;        // First sorted node of each depth level, last entry is node_count
+};
+
+struct Pose
+{
+	void allocate(const SkeletonView &a_skeleton)
+	{
+		this->m_locals.resize(a_skeleton.node_count());
+		this->m_worlds.resize(a_skeleton.node_count());
+		this->m_palette.resize(a_skeleton.joint_count());
+	}
+
+	std::vector<Matrix4f> m_locals;         // Local transforms in sorted order
+	std::vector<Matrix4f> m_worlds;         // World transforms in sorted order
+	std::vector<Matrix4f> m_palette;        // Skinning matrices in palette order, ready for upload
+};
+
+// Inputs are in original node order, a_joint_nodes and a_skinning_binds are in palette order.
+// Sorts by depth which is a valid topological order and keeps siblings in their original order
+inline Skeleton skeleton_from_hierarchy(const std::vector<int32_t> &a_parents, const std::vector<Matrix4f> &a_locals,
+                                        const std::vector<uint32_t> &a_joint_nodes, const std::vector<Matrix4f> &a_skinning_binds)
+{
+	const uint32_t nodes_count = static_cast<uint32_t>(a_parents.size());
+
+	assert(a_locals.size() == nodes_count && "Need one local transform per node");
+	assert(a_joint_nodes.size() == a_skinning_binds.size() && "Need one skinning bind per joint");
+
+	Skeleton skeleton;
+
+	std::vector<uint32_t> depths(nodes_count, 0);
+	for (uint32_t i = 0; i < nodes_count; ++i)
+	{
+		int32_t parent = a_parents[i];
+		while (parent != -1)
+		{
+			assert(static_cast<uint32_t>(parent) < nodes_count && "Parent index out of range");
+			assert(depths[i] < nodes_count && "Cycle in node hierarchy");
+
+			depths[i]++;
+			parent = a_parents[static_cast<uint32_t>(parent)];
+		}
+	}
+
+	skeleton.m_source_index.resize(nodes_count);
+	std::iota(skeleton.m_source_index.begin(), skeleton.m_source_index.end(), 0u);
+	std::stable_sort(skeleton.m_source_index.begin(), skeleton.m_source_index.end(), [&depths](uint32_t a_left, uint32_t a_right) { return depths[a_left] < depths[a_right]; });
+
+	skeleton.m_sorted_index.resize(nodes_count);
+	for (uint32_t i = 0; i < nodes_count; ++i)
+		skeleton.m_sorted_index[skeleton.m_source_index[i]] = i;
+
+	skeleton.m_parents.reserve(nodes_count);
+	skeleton.m_bind_locals.reserve(nodes_count);
+	for (uint32_t i = 0; i < nodes_count; ++i)
+	{
+		uint32_t source = skeleton.m_source_index[i];
+		int32_t  parent = a_parents[source];
+
+		skeleton.m_parents.push_back(parent == -1 ? -1 : static_cast<int32_t>(skeleton.m_sorted_index[static_cast<uint32_t>(parent)]));
+		skeleton.m_bind_locals.push_back(a_locals[source]);
+
+		assert(skeleton.m_parents.back() < static_cast<int32_t>(i) && "Parent must come before child");
+
+		if (i == 0 || depths[source] != depths[skeleton.m_source_index[i - 1]])
+			skeleton.m_level_offsets.push_back(i);
+	}
+	skeleton.m_level_offsets.push_back(nodes_count);
+
+	// Joints stay in palette order because that is what the vertex joint ids index into
+	for (auto joint : a_joint_nodes)
+	{
+		assert(joint < nodes_count && "Joint node out of range");
+		skeleton.m_joints.push_back(skeleton.m_sorted_index[joint]);
+	}
+
+	skeleton.m_skinning_binds = a_skinning_binds;
+
+	return skeleton;
+}
+
+// Local transforms must be up to date, nodes in one level only depend on earlier levels so each level is one batch
+inline void update_worlds(const SkeletonView &a_skeleton, Pose &a_pose)
+{
+	// Empty skeletons have at most one level offset, there is no first level to read
+	if (a_skeleton.node_count() == 0)
+		return;
+
+	const uint32_t level_count = a_skeleton.m_level_offsets.size() - 1;
+
+	for (uint32_t i = a_skeleton.m_level_offsets[0]; i < a_skeleton.m_level_offsets[1]; ++i)
+		a_pose.m_worlds[i] = a_pose.m_locals[i];
+
+	for (uint32_t level = 1; level < level_count; ++level)
+	{
+		uint32_t begin = a_skeleton.m_level_offsets[level];
+		uint32_t count = a_skeleton.m_level_offsets[level + 1] - begin;
+
+		// Parents are never -1 below the roots so they can be read as unsigned indices
+		const uint32_t *parents = reinterpret_cast<const uint32_t *>(a_skeleton.m_parents.data() + begin);
+
+		multiply_indexed(a_pose.m_worlds.data(), parents, a_pose.m_locals.data() + begin, a_pose.m_worlds.data() + begin, count);
+	}
+}
+
+// World transforms must be up to date, writes joint_count skinning matrices to a_palette
+inline void update_palette(const SkeletonView &a_skeleton, const Pose &a_pose, Matrix4f *a_palette)
+{
+	multiply_indexed(a_pose.m_worlds.data(), a_skeleton.m_joints.data(), a_skeleton.m_skinning_binds.data(), a_palette, a_skeleton.joint_count());
+}
+
+inline void update_palette(const SkeletonView &a_skeleton, Pose &a_pose)
+{
+	update_palette(a_skeleton, a_pose, a_pose.m_palette.data());
+}
+
+}        // namespace ror
@@ -0,0 +1,333 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "animation/matrix_kernels.hpp"
+#include "animation/transform.hpp"
+#include "threading/job_system.hpp"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <foundation/rormacros.hpp>
+#include <foundation/rortypes.hpp>
+#include <math/rormatrix4.hpp>
+#include <random>
+#include <vector>
+
+/*  Skinning kernels usage
+ *  CPU version of skinning.comp, used where the GPU path isn't available and as the reference GPU skinning is
+ *  checked against. Reads the same streams the astro boy vertex buffers are made of, xyz positions and
+ *  normals, 3 weights and 3 joint ids per vertex, and a column-major affine palette like AnimationSystem
+ *  produces. Writes position then normal per vertex, 6 floats, which is the layout of the skinned buffer.
+ *  skin_vertices() splits the vertices into chunks of a_grain over a JobSystem, chunks never write outside
+ *  their own vertices so they can run in any order. Paths are picked like the matrix kernels, SSE and NEON
+ *  are baseline and AVX2 + FMA skins two vertices per register when cpuid has it. The scalar path is the
+ *  reference for verify_skinning_kernels().
+ */
+
+namespace ror
+{
+constexpr uint32_t skinning_grain = 1024;        // Vertices per parallel_for chunk
+
+struct SkinningStreams
+{
+	const float32_t *m_positions{nullptr};        // xyz per vertex
+	const float32_t *m_normals{nullptr};          // xyz per vertex
+	const float32_t *m_weights{nullptr};          // 3 per vertex
+	const uint32_t  *m_joint_ids{nullptr};        // 3 per vertex, index into the palette
+	uint32_t         m_vertex_count{0};
+};
+
+using SkinningKernelFunction = void (*)(const SkinningStreams &, const Matrix4f *, uint32_t, uint32_t, float32_t *);
+
+inline void skin_vertices_scalar(const SkinningStreams &a_streams, const Matrix4f *a_palette, uint32_t a_begin, uint32_t a_end, float32_t *a_out)
+{
+	for (uint32_t v = a_begin; v < a_end; ++v)
+	{
+		const float32_t *position = a_streams.m_positions + v * 3;
+		const float32_t *normal   = a_streams.m_normals + v * 3;
+		const float32_t *weights  = a_streams.m_weights + v * 3;
+		const uint32_t  *joints   = a_streams.m_joint_ids + v * 3;
+
+		// Only the upper 3x4 of the blend is needed, palettes are affine
+		float32_t blend[12];
+		for (uint32_t i = 0; i < 12; ++i)
+		{
+			uint32_t index = (i / 3) * 4 + i % 3;
+			blend[i]       = a_palette[joints[0]].m_values[index] * weights[0] + a_palette[joints[1]].m_values[index] * weights[1] + a_palette[joints[2]].m_values[index] * weights[2];
+		}
+
+		float32_t *out = a_out + v * 6;
+
+		for (uint32_t row = 0; row < 3; ++row)
+		{
+			out[row]     = blend[row] * position[0] + blend[3 + row] * position[1] + blend[6 + row] * position[2] + blend[9 + row];
+			out[3 + row] = blend[row] * normal[0] + blend[3 + row] * normal[1] + blend[6 + row] * normal[2];
+		}
+
+		float32_t inverse_length = 1.0f / std::sqrt(out[3] * out[3] + out[4] * out[4] + out[5] * out[5]);
+
+		out[3] *= inverse_length;
+		out[4] *= inverse_length;
+		out[5] *= inverse_length;
+	}
+}
+
+#if defined(ROR_KERNELS_SSE)
+// Blends whole columns, the w lane of a blended normal is 0 since palettes are affine so a 4 wide dot gives its length
+inline void skin_vertices_sse(const SkinningStreams &a_streams, const Matrix4f *a_palette, uint32_t a_begin, uint32_t a_end, float32_t *a_out)
+{
+	for (uint32_t v = a_begin; v < a_end; ++v)
+	{
+		const float32_t *position = a_streams.m_positions + v * 3;
+		const float32_t *normal   = a_streams.m_normals + v * 3;
+		const float32_t *weights  = a_streams.m_weights + v * 3;
+		const uint32_t  *joints   = a_streams.m_joint_ids + v * 3;
+
+		const float32_t *m0 = a_palette[joints[0]].m_values;
+		const float32_t *m1 = a_palette[joints[1]].m_values;
+		const float32_t *m2 = a_palette[joints[2]].m_values;
+
+		__m128 w0 = _mm_set1_ps(weights[0]);
+		__m128 w1 = _mm_set1_ps(weights[1]);
+		__m128 w2 = _mm_set1_ps(weights[2]);
+
+		__m128 columns[4];
+		for (uint32_t c = 0; c < 4; ++c)
+			columns[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m0 + c * 4), w0), _mm_mul_ps(_mm_loadu_ps(m1 + c * 4), w1)), _mm_mul_ps(_mm_loadu_ps(m2 + c * 4), w2));
+
+		__m128 skinned_position = _mm_add_ps(_mm_add_ps(_mm_mul_ps(columns[0], _mm_set1_ps(position[0])), _mm_mul_ps(columns[1], _mm_set1_ps(position[1]))),
+		                                     _mm_add_ps(_mm_mul_ps(columns[2], _mm_set1_ps(position[2])), columns[3]));
+		__m128 skinned_normal   = _mm_add_ps(_mm_add_ps(_mm_mul_ps(columns[0], _mm_set1_ps(normal[0])), _mm_mul_ps(columns[1], _mm_set1_ps(normal[1]))),
+		                                     _mm_mul_ps(columns[2], _mm_set1_ps(normal[2])));
+
+		__m128 length_squared = _mm_mul_ps(skinned_normal, skinned_normal);
+		length_squared        = _mm_add_ps(length_squared, _mm_shuffle_ps(length_squared, length_squared, _MM_SHUFFLE(2, 3, 0, 1)));
+		length_squared        = _mm_add_ps(length_squared, _mm_shuffle_ps(length_squared, length_squared, _MM_SHUFFLE(1, 0, 3, 2)));
+		skinned_normal        = _mm_div_ps(skinned_normal, _mm_sqrt_ps(length_squared));
+
+		// Position spills its w into normal x which is written right after, normal is written as 2 + 1 so it never touches the next vertex
+		float32_t *out = a_out + v * 6;
+		_mm_storeu_ps(out, skinned_position);
+		_mm_storel_pi(reinterpret_cast<__m64 *>(out + 3), skinned_normal);
+		_mm_store_ss(out + 5, _mm_movehl_ps(skinned_normal, skinned_normal));
+	}
+}
+#endif
+
+#if defined(ROR_KERNELS_AVX2)
+FORCE_INLINE __attribute__((target("avx2,fma"))) __m256 skinning_lanes(const float32_t *a_low, const float32_t *a_high)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a_low)), _mm_loadu_ps(a_high), 1);
+}
+
+FORCE_INLINE __attribute__((target("avx2,fma"))) __m256 skinning_broadcast(float32_t a_low, float32_t a_high)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(a_low)), _mm_set1_ps(a_high), 1);
+}
+
+// Two vertices per register, the low lane skins vertex v and the high lane v + 1, an odd tail goes through the SSE path
+__attribute__((target("avx2,fma"))) inline void skin_vertices_avx2(const SkinningStreams &a_streams, const Matrix4f *a_palette, uint32_t a_begin, uint32_t a_end, float32_t *a_out)
+{
+	uint32_t v = a_begin;
+
+	for (; v + 1 < a_end; v += 2)
+	{
+		const float32_t *position = a_streams.m_positions + v * 3;
+		const float32_t *normal   = a_streams.m_normals + v * 3;
+		const float32_t *weights  = a_streams.m_weights + v * 3;
+		const uint32_t  *joints   = a_streams.m_joint_ids + v * 3;
+
+		__m256 w0 = skinning_broadcast(weights[0], weights[3]);
+		__m256 w1 = skinning_broadcast(weights[1], weights[4]);
+		__m256 w2 = skinning_broadcast(weights[2], weights[5]);
+
+		__m256 columns[4];
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			columns[c] = _mm256_mul_ps(skinning_lanes(a_palette[joints[0]].m_values + c * 4, a_palette[joints[3]].m_values + c * 4), w0);
+			columns[c] = _mm256_fmadd_ps(skinning_lanes(a_palette[joints[1]].m_values + c * 4, a_palette[joints[4]].m_values + c * 4), w1, columns[c]);
+			columns[c] = _mm256_fmadd_ps(skinning_lanes(a_palette[joints[2]].m_values + c * 4, a_palette[joints[5]].m_values + c * 4), w2, columns[c]);
+		}
+
+		__m256 skinned_position = _mm256_fmadd_ps(columns[0], skinning_broadcast(position[0], position[3]), columns[3]);
+		skinned_position        = _mm256_fmadd_ps(columns[1], skinning_broadcast(position[1], position[4]), skinned_position);
+		skinned_position        = _mm256_fmadd_ps(columns[2], skinning_broadcast(position[2], position[5]), skinned_position);
+
+		__m256 skinned_normal = _mm256_mul_ps(columns[0], skinning_broadcast(normal[0], normal[3]));
+		skinned_normal        = _mm256_fmadd_ps(columns[1], skinning_broadcast(normal[1], normal[4]), skinned_normal);
+		skinned_normal        = _mm256_fmadd_ps(columns[2], skinning_broadcast(normal[2], normal[5]), skinned_normal);
+
+		__m256 length_squared = _mm256_mul_ps(skinned_normal, skinned_normal);
+		length_squared        = _mm256_add_ps(length_squared, _mm256_permute_ps(length_squared, _MM_SHUFFLE(2, 3, 0, 1)));
+		length_squared        = _mm256_add_ps(length_squared, _mm256_permute_ps(length_squared, _MM_SHUFFLE(1, 0, 3, 2)));
+		skinned_normal        = _mm256_div_ps(skinned_normal, _mm256_sqrt_ps(length_squared));
+
+		// Stored in order so every spilled w lane is overwritten by the next store, the last normal is written as 2 + 1
+		float32_t *out         = a_out + v * 6;
+		__m128     high_normal = _mm256_extractf128_ps(skinned_normal, 1);
+
+		_mm_storeu_ps(out, _mm256_castps256_ps128(skinned_position));
+		_mm_storeu_ps(out + 3, _mm256_castps256_ps128(skinned_normal));
+		_mm_storeu_ps(out + 6, _mm256_extractf128_ps(skinned_position, 1));
+		_mm_storel_pi(reinterpret_cast<__m64 *>(out + 9), high_normal);
+		_mm_store_ss(out + 11, _mm_movehl_ps(high_normal, high_normal));
+	}
+
+	if (v < a_end)
+		skin_vertices_sse(a_streams, a_palette, v, a_end, a_out);
+}
+#endif
+
+#if defined(ROR_KERNELS_NEON)
+inline void skin_vertices_neon(const SkinningStreams &a_streams, const Matrix4f *a_palette, uint32_t a_begin, uint32_t a_end, float32_t *a_out)
+{
+	for (uint32_t v = a_begin; v < a_end; ++v)
+	{
+		const float32_t *position = a_streams.m_positions + v * 3;
+		const float32_t *normal   = a_streams.m_normals + v * 3;
+		const float32_t *weights  = a_streams.m_weights + v * 3;
+		const uint32_t  *joints   = a_streams.m_joint_ids + v * 3;
+
+		const float32_t *m0 = a_palette[joints[0]].m_values;
+		const float32_t *m1 = a_palette[joints[1]].m_values;
+		const float32_t *m2 = a_palette[joints[2]].m_values;
+
+		float32x4_t columns[4];
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			columns[c] = vmulq_n_f32(vld1q_f32(m0 + c * 4), weights[0]);
+			columns[c] = vfmaq_n_f32(columns[c], vld1q_f32(m1 + c * 4), weights[1]);
+			columns[c] = vfmaq_n_f32(columns[c], vld1q_f32(m2 + c * 4), weights[2]);
+		}
+
+		float32x4_t skinned_position = vfmaq_n_f32(columns[3], columns[0], position[0]);
+		skinned_position             = vfmaq_n_f32(skinned_position, columns[1], position[1]);
+		skinned_position             = vfmaq_n_f32(skinned_position, columns[2], position[2]);
+
+		float32x4_t skinned_normal = vmulq_n_f32(columns[0], normal[0]);
+		skinned_normal             = vfmaq_n_f32(skinned_normal, columns[1], normal[1]);
+		skinned_normal             = vfmaq_n_f32(skinned_normal, columns[2], normal[2]);
+		skinned_normal             = vmulq_n_f32(skinned_normal, 1.0f / std::sqrt(vaddvq_f32(vmulq_f32(skinned_normal, skinned_normal))));
+
+		float32_t *out = a_out + v * 6;
+		vst1q_f32(out, skinned_position);
+		vst1_f32(out + 3, vget_low_f32(skinned_normal));
+		out[5] = vgetq_lane_f32(skinned_normal, 2);
+	}
+}
+#endif
+
+inline SkinningKernelFunction skinning_kernel(MatrixKernelPath a_path)
+{
+	switch (a_path)
+	{
+#if defined(ROR_KERNELS_AVX2)
+		case MatrixKernelPath::avx2:
+			return skin_vertices_avx2;
+#endif
+#if defined(ROR_KERNELS_SSE)
+		case MatrixKernelPath::sse:
+			return skin_vertices_sse;
+#endif
+#if defined(ROR_KERNELS_NEON)
+		case MatrixKernelPath::neon:
+			return skin_vertices_neon;
+#endif
+		default:
+			return skin_vertices_scalar;
+	}
+}
+
+// Skins all of a_streams into a_out, 6 floats per vertex, on a_job_system with the best path available
+inline void skin_vertices(const SkinningStreams &a_streams, const Matrix4f *a_palette, float32_t *a_out, utl::JobSystem &a_job_system, uint32_t a_grain = skinning_grain)
+{
+	static const SkinningKernelFunction kernel = skinning_kernel(matrix_kernel_best_path());
+
+	a_job_system.parallel_for(a_streams.m_vertex_count, a_grain, [&](uint32_t a_begin, uint32_t a_end, uint32_t) {
+		kernel(a_streams, a_palette, a_begin, a_end, a_out);
+	});
+}
+
+// Skins a_count random vertices through the selected path and the scalar reference, returns true if they agree within a_tolerance
+inline bool verify_skinning_kernels(MatrixKernelPath a_path = matrix_kernel_best_path(), uint32_t a_count = 255, float32_t a_tolerance = 1e-4f)
+{
+	constexpr uint32_t joint_count = 16;
+
+	std::mt19937                              generator{11};
+	std::uniform_real_distribution<float32_t> distribution{-2.0f, 2.0f};
+	std::uniform_int_distribution<uint32_t>   joint_distribution{0, joint_count - 1};
+
+	std::vector<Matrix4f> palette(joint_count);
+	for (auto &matrix : palette)
+	{
+		Transform transform;
+		transform.m_translation = Vector3f{distribution(generator), distribution(generator), distribution(generator)};
+		transform.m_rotation    = quaternion_normalize(Vector4f{distribution(generator), distribution(generator), distribution(generator), 1.0f});
+		transform.m_scale       = Vector3f{1.0f, 1.0f, 1.0f} + Vector3f{distribution(generator), distribution(generator), distribution(generator)} * 0.1f;
+		matrix                  = transform_to_matrix(transform);
+	}
+
+	std::vector<float32_t> positions(a_count * 3), normals(a_count * 3), weights(a_count * 3);
+	std::vector<uint32_t>  joint_ids(a_count * 3);
+
+	for (uint32_t i = 0; i < a_count * 3; i += 3)
+	{
+		float32_t w0  = std::fabs(distribution(generator)) + 0.1f;
+		float32_t w1  = std::fabs(distribution(generator));
+		float32_t w2  = std::fabs(distribution(generator));
+		float32_t sum = w0 + w1 + w2;
+
+		for (uint32_t j = 0; j < 3; ++j)
+		{
+			positions[i + j] = distribution(generator);
+			normals[i + j]   = distribution(generator);
+			joint_ids[i + j] = joint_distribution(generator);
+		}
+
+		normals[i] += 3.0f;        // Keeps normals away from zero length
+
+		weights[i]     = w0 / sum;
+		weights[i + 1] = w1 / sum;
+		weights[i + 2] = w2 / sum;
+	}
+
+	SkinningStreams streams{positions.data(), normals.data(), weights.data(), joint_ids.data(), a_count};
+
+	std::vector<float32_t> reference(a_count * 6), result(a_count * 6);
+
+	skin_vertices_scalar(streams, palette.data(), 0, a_count, reference.data());
+	skinning_kernel(a_path)(streams, palette.data(), 0, a_count, result.data());
+
+	for (uint32_t i = 0; i < a_count * 6; ++i)
+		if (std::fabs(reference[i] - result[i]) > a_tolerance)
+			return false;
+
+	return true;
+}
+
+}        // namespace ror
@@ -0,0 +1,136 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "animation/transform.hpp"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <foundation/rormacros.hpp>
+#include <foundation/rortypes.hpp>
+#include <math/rormatrix4.hpp>
+
+/*  Skinning palette usage
+ *  Converts the column-major 4x4 palettes AnimationSystem produces into what the skinning shaders read.
+ *  matrix4x4 is a straight copy. affine3x4 drops the constant last row and stores the matrix as three
+ *  row vec4s, 12 floats per joint, so a point is skinned with three dot products. dual_quaternion
+ *  stores rotation (x, y, z, w) then dual part, 8 floats per joint, and is blended with DLB in the
+ *  shader which also avoids the candy wrapper artefact of linear blending. Scale can't be represented
+ *  by a dual quaternion and is dropped, use it for rigid rigs only.
+ *  All formats are made of vec4s so a palette of any format can live in the same std140 vec4 array,
+ *  palette_stride() tells how many floats a joint takes. The shader picks its format with the
+ *  specialization constant palette_format, which must be static_cast<uint32_t>(PaletteFormat).
+ */
+
+namespace ror
+{
+enum class PaletteFormat : uint32_t
+{
+	matrix4x4,
+	affine3x4,
+	dual_quaternion
+};
+
+FORCE_INLINE constexpr uint32_t palette_stride(PaletteFormat a_format)
+{
+	return a_format == PaletteFormat::matrix4x4 ? 16u : (a_format == PaletteFormat::affine3x4 ? 12u : 8u);
+}
+
+FORCE_INLINE const char *palette_format_name(PaletteFormat a_format)
+{
+	switch (a_format)
+	{
+		case PaletteFormat::matrix4x4:
+			return "matrix4x4";
+		case PaletteFormat::affine3x4:
+			return "affine3x4";
+		case PaletteFormat::dual_quaternion:
+			return "dual_quaternion";
+	}
+
+	return "unknown";
+}
+
+inline void palette_write_affine3x4(const Matrix4f *a_palette, uint32_t a_count, float32_t *a_out)
+{
+	for (uint32_t i = 0; i < a_count; ++i)
+	{
+		const float32_t *m = a_palette[i].m_values;
+
+		assert(m[3] == 0.0f && m[7] == 0.0f && m[11] == 0.0f && m[15] == 1.0f && "Skinning matrix isn't affine");
+
+		for (uint32_t row = 0; row < 3; ++row, a_out += 4)
+		{
+			a_out[0] = m[row];
+			a_out[1] = m[4 + row];
+			a_out[2] = m[8 + row];
+			a_out[3] = m[12 + row];
+		}
+	}
+}
+
+inline void palette_write_dual_quaternion(const Matrix4f *a_palette, uint32_t a_count, float32_t *a_out)
+{
+	for (uint32_t i = 0; i < a_count; ++i, a_out += 8)
+	{
+		Transform transform = transform_from_matrix(a_palette[i]);
+
+		const Vector4f &real = transform.m_rotation;
+		const Vector3f &t    = transform.m_translation;
+
+		// Dual part is half the translation as a pure quaternion times the rotation
+		Vector4f dual = quaternion_multiply(Vector4f{t.x * 0.5f, t.y * 0.5f, t.z * 0.5f, 0.0f}, real);
+
+		a_out[0] = real.x;
+		a_out[1] = real.y;
+		a_out[2] = real.z;
+		a_out[3] = real.w;
+		a_out[4] = dual.x;
+		a_out[5] = dual.y;
+		a_out[6] = dual.z;
+		a_out[7] = dual.w;
+	}
+}
+
+// Writes palette_stride(a_format) * a_count floats to a_out, which can be mapped memory since it is only written in order
+inline void palette_write(PaletteFormat a_format, const Matrix4f *a_palette, uint32_t a_count, float32_t *a_out)
+{
+	switch (a_format)
+	{
+		case PaletteFormat::matrix4x4:
+			std::memcpy(a_out, a_palette, a_count * sizeof(Matrix4f));
+			break;
+		case PaletteFormat::affine3x4:
+			palette_write_affine3x4(a_palette, a_count, a_out);
+			break;
+		case PaletteFormat::dual_quaternion:
+			palette_write_dual_quaternion(a_palette, a_count, a_out);
+			break;
+	}
+}
+
+}        // namespace ror
@@ -0,0 +1,233 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <foundation/rormacros.hpp>
+#include <foundation/rortypes.hpp>
+#include <math/rormatrix4.hpp>
+#include <math/rorvector3.hpp>
+#include <math/rorvector4.hpp>
+
+/*  Transform usage
+ *  Decompose collada matrices once at load time with transform_from_matrix(), interpolate the
+ *  components with transform_interpolate() and convert back with transform_to_matrix() once per
+ *  joint per frame. Rotation is a unit quaternion stored as (x, y, z, w).
+ *  Shear is not representable and is dropped by the decomposition.
+ */
+
+namespace ror
+{
+struct Transform
+{
+	Vector3f m_translation{0.0f, 0.0f, 0.0f};          // Translation
+	Vector4f m_rotation{0.0f, 0.0f, 0.0f, 1.0f};        // Unit quaternion, x, y, z, w
+	Vector3f m_scale{1.0f, 1.0f, 1.0f};                 // Per axis scale, x is negated for mirrored transforms
+};
+
+FORCE_INLINE float32_t quaternion_dot(const Vector4f &a_left, const Vector4f &a_right)
+{
+	return a_left.x * a_right.x + a_left.y * a_right.y + a_left.z * a_right.z + a_left.w * a_right.w;
+}
+
+FORCE_INLINE Vector4f quaternion_normalize(const Vector4f &a_quaternion)
+{
+	float32_t length_squared = quaternion_dot(a_quaternion, a_quaternion);
+	assert(length_squared > 0.0f && "Can't normalize a zero quaternion");
+
+	float32_t inverse_length = 1.0f / std::sqrt(length_squared);
+	return Vector4f{a_quaternion.x * inverse_length, a_quaternion.y * inverse_length, a_quaternion.z * inverse_length, a_quaternion.w * inverse_length};
+}
+
+FORCE_INLINE Vector4f quaternion_conjugate(const Vector4f &a_quaternion)
+{
+	return Vector4f{-a_quaternion.x, -a_quaternion.y, -a_quaternion.z, a_quaternion.w};
+}
+
+// Hamilton product, the result applies a_right first then a_left
+FORCE_INLINE Vector4f quaternion_multiply(const Vector4f &a_left, const Vector4f &a_right)
+{
+	return Vector4f{a_left.w * a_right.x + a_left.x * a_right.w + a_left.y * a_right.z - a_left.z * a_right.y,
+	                a_left.w * a_right.y - a_left.x * a_right.z + a_left.y * a_right.w + a_left.z * a_right.x,
+	                a_left.w * a_right.z + a_left.x * a_right.y - a_left.y * a_right.x + a_left.z * a_right.w,
+	                a_left.w * a_right.w - a_left.x * a_right.x - a_left.y * a_right.y - a_left.z * a_right.z};
+}
+
+// Takes the shortest path, good enough for keys that are close together which is always the case for baked clips
+FORCE_INLINE Vector4f quaternion_nlerp(const Vector4f &a_from, const Vector4f &a_to, float32_t a_t)
+{
+	float32_t sign = quaternion_dot(a_from, a_to) < 0.0f ? -1.0f : 1.0f;
+	float32_t s    = 1.0f - a_t;
+	float32_t e    = a_t * sign;
+
+	return quaternion_normalize(Vector4f{a_from.x * s + a_to.x * e, a_from.y * s + a_to.y * e, a_from.z * s + a_to.z * e, a_from.w * s + a_to.w * e});
+}
+
+// Constant angular velocity, falls back to nlerp when the keys are almost identical
+FORCE_INLINE Vector4f quaternion_slerp(const Vector4f &a_from, const Vector4f &a_to, float32_t a_t)
+{
+	float32_t cosine = quaternion_dot(a_from, a_to);
+	float32_t sign   = 1.0f;
+
+	if (cosine < 0.0f)
+	{
+		cosine = -cosine;
+		sign   = -1.0f;
+	}
+
+	if (cosine > 0.9995f)
+		return quaternion_nlerp(a_from, a_to, a_t);
+
+	float32_t angle        = std::acos(cosine);
+	float32_t inverse_sine = 1.0f / std::sin(angle);
+	float32_t s            = std::sin((1.0f - a_t) * angle) * inverse_sine;
+	float32_t e            = std::sin(a_t * angle) * inverse_sine * sign;
+
+	return Vector4f{a_from.x * s + a_to.x * e, a_from.y * s + a_to.y * e, a_from.z * s + a_to.z * e, a_from.w * s + a_to.w * e};
+}
+
+FORCE_INLINE Vector3f vector3_lerp(const Vector3f &a_from, const Vector3f &a_to, float32_t a_t)
+{
+	return Vector3f{a_from.x + (a_to.x - a_from.x) * a_t, a_from.y + (a_to.y - a_from.y) * a_t, a_from.z + (a_to.z - a_from.z) * a_t};
+}
+
+// Expects a column-major affine matrix, i.e. after get_ror_matrix4() for collada data
+inline Transform transform_from_matrix(const Matrix4f &a_matrix)
+{
+	const float32_t *m = a_matrix.m_values;
+
+	Transform transform;
+	transform.m_translation = Vector3f{m[12], m[13], m[14]};
+
+	float32_t sx = std::sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+	float32_t sy = std::sqrt(m[4] * m[4] + m[5] * m[5] + m[6] * m[6]);
+	float32_t sz = std::sqrt(m[8] * m[8] + m[9] * m[9] + m[10] * m[10]);
+
+	assert(sx > 0.0f && sy > 0.0f && sz > 0.0f && "Degenerate matrix can't be decomposed");
+
+	// Negative determinant means a mirror, push it into x scale so the rest is a proper rotation
+	float32_t determinant = m[0] * (m[5] * m[10] - m[9] * m[6]) - m[4] * (m[1] * m[10] - m[9] * m[2]) + m[8] * (m[1] * m[6] - m[5] * m[2]);
+	if (determinant < 0.0f)
+		sx = -sx;
+
+	transform.m_scale = Vector3f{sx, sy, sz};
+
+	float32_t r00 = m[0] / sx, r10 = m[1] / sx, r20 = m[2] / sx;
+	float32_t r01 = m[4] / sy, r11 = m[5] / sy, r21 = m[6] / sy;
+	float32_t r02 = m[8] / sz, r12 = m[9] / sz, r22 = m[10] / sz;
+
+	float32_t trace = r00 + r11 + r22;
+	Vector4f  q;
+
+	if (trace > 0.0f)
+	{
+		float32_t s = 0.5f / std::sqrt(trace + 1.0f);
+		q           = Vector4f{(r21 - r12) * s, (r02 - r20) * s, (r10 - r01) * s, 0.25f / s};
+	}
+	else if (r00 > r11 && r00 > r22)
+	{
+		float32_t s = 2.0f * std::sqrt(1.0f + r00 - r11 - r22);
+		q           = Vector4f{0.25f * s, (r01 + r10) / s, (r02 + r20) / s, (r21 - r12) / s};
+	}
+	else if (r11 > r22)
+	{
+		float32_t s = 2.0f * std::sqrt(1.0f + r11 - r00 - r22);
+		q           = Vector4f{(r01 + r10) / s, 0.25f * s, (r12 + r21) / s, (r02 - r20) / s};
+	}
+	else
+	{
+		float32_t s = 2.0f * std::sqrt(1.0f + r22 - r00 - r11);
+		q           = Vector4f{(r02 + r20) / s, (r12 + r21) / s, 0.25f * s, (r10 - r01) / s};
+	}
+
+	transform.m_rotation = quaternion_normalize(q);
+
+	return transform;
+}
+
+inline Matrix4f transform_to_matrix(const Transform &a_transform)
+{
+	const Vector4f &q = a_transform.m_rotation;
+	const Vector3f &s = a_transform.m_scale;
+	const Vector3f &t = a_transform.m_translation;
+
+	float32_t xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float32_t xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float32_t wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+	Matrix4f  matrix;
+	float32_t *m = matrix.m_values;
+
+	m[0]  = (1.0f - 2.0f * (yy + zz)) * s.x;
+	m[1]  = (2.0f * (xy + wz)) * s.x;
+	m[2]  = (2.0f * (xz - wy)) * s.x;
+	m[3]  = 0.0f;
+	m[4]  = (2.0f * (xy - wz)) * s.y;
+	m[5]  = (1.0f - 2.0f * (xx + zz)) * s.y;
+	m[6]  = (2.0f * (yz + wx)) * s.y;
+	m[7]  = 0.0f;
+	m[8]  = (2.0f * (xz + wy)) * s.z;
+	m[9]  = (2.0f * (yz - wx)) * s.z;
+	m[10] = (1.0f - 2.0f * (xx + yy)) * s.z;
+	m[11] = 0.0f;
+	m[12] = t.x;
+	m[13] = t.y;
+	m[14] = t.z;
+	m[15] = 1.0f;
+
+	return matrix;
+}
+
+inline Transform transform_interpolate(const Transform &a_from, const Transform &a_to, float32_t a_t)
+{
+	Transform transform;
+
+	transform.m_translation = vector3_lerp(a_from.m_translation, a_to.m_translation, a_t);
+	transform.m_rotation    = quaternion_nlerp(a_from.m_rotation, a_to.m_rotation, a_t);
+	transform.m_scale       = vector3_lerp(a_from.m_scale, a_to.m_scale, a_t);
+
+	return transform;
+}
+
+// Applies the difference between a_additive and a_reference on top of a_base, scaled by a_weight
+inline Transform transform_add(const Transform &a_base, const Transform &a_additive, const Transform &a_reference, float32_t a_weight)
+{
+	Transform transform;
+
+	Vector4f delta_rotation = quaternion_multiply(quaternion_conjugate(a_reference.m_rotation), a_additive.m_rotation);
+
+	transform.m_translation = vector3_lerp(a_base.m_translation, a_base.m_translation + (a_additive.m_translation - a_reference.m_translation), a_weight);
+	transform.m_rotation    = quaternion_normalize(quaternion_multiply(a_base.m_rotation, quaternion_nlerp(Vector4f{0.0f, 0.0f, 0.0f, 1.0f}, delta_rotation, a_weight)));
+	transform.m_scale       = Vector3f{a_base.m_scale.x * (1.0f + (a_additive.m_scale.x / a_reference.m_scale.x - 1.0f) * a_weight),
+                                 a_base.m_scale.y * (1.0f + (a_additive.m_scale.y / a_reference.m_scale.y - 1.0f) * a_weight),
+                                 a_base.m_scale.z * (1.0f + (a_additive.m_scale.z / a_reference.m_scale.z - 1.0f) * a_weight)};
+
+	return transform;
+}
+
+}        // namespace ror
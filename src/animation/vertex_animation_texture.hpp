@@ -0,0 +1,173 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "animation/animation_system.hpp"
+#include "animation/compressed_clip.hpp"
+#include "animation/skeleton.hpp"
+#include "animation/skinning_kernels.hpp"
+#include "threading/job_system.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <foundation/rormacros.hpp>
+#include <foundation/rortypes.hpp>
+#include <vector>
+
+/*  Vertex animation texture usage
+ *  bake_vertex_animation() plays a clip once at a fixed rate and stores the skinned mesh of every frame in
+ *  an RGBA half float texture, so characters far enough away can be drawn by fetching their vertices
+ *  instead of being animated and skinned. Each frame is 2 texels per vertex, position with w = 1 then
+ *  normal with w = 0, written row major and wrapping at m_width. A frame starts on a new row, so texel t
+ *  of frame f is at x = t % m_width, y = f * rows_per_frame() + t / m_width.
+ *  Frames are sampled at clip start + i / m_frames_per_second for i in [0, m_frame_count), the rate is
+ *  adjusted so the clip duration is a whole number of frames and frame m_frame_count wraps to 0 for loops.
+ *  Baking evaluates all frames in one AnimationSystem update and skins them with skin_vertices(), it takes
+ *  a few milliseconds for astro boy so it is cheap enough to do at load time.
+ */
+
+namespace ror
+{
+struct VertexAnimationTexture
+{
+	uint32_t rows_per_frame() const
+	{
+		return (this->m_vertex_count * 2 + this->m_width - 1) / this->m_width;
+	}
+
+	size_t size_in_bytes() const
+	{
+		return this->m_texels.size() * sizeof(uint16_t);
+	}
+
+	uint32_t              m_width{0};                        // Texels per row
+	uint32_t              m_height{0};                       // m_frame_count * rows_per_frame()
+	uint32_t              m_vertex_count{0};                 // Vertices in each frame
+	uint32_t              m_frame_count{0};                  // Baked frames, the last one is followed by the first
+	float32_t             m_frames_per_second{0.0f};         // Playback rate that matches the clip duration
+	std::vector<uint16_t> m_texels{};                        // RGBA half floats, m_width * m_height * 4
+};
+
+// Round to nearest, values too big for a half become infinity and too small flush through denormals to zero
+FORCE_INLINE uint16_t float_to_half(float32_t a_value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &a_value, sizeof(bits));
+
+	uint32_t sign     = (bits >> 16) & 0x8000u;
+	int32_t  exponent = static_cast<int32_t>((bits >> 23) & 0xffu) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffffu;
+
+	if (((bits >> 23) & 0xffu) == 0xffu)
+		return static_cast<uint16_t>(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+
+	if (exponent >= 31)
+		return static_cast<uint16_t>(sign | 0x7c00u);
+
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+			return static_cast<uint16_t>(sign);
+
+		mantissa |= 0x800000u;
+
+		uint32_t shift = static_cast<uint32_t>(14 - exponent);
+		uint32_t half  = mantissa >> shift;
+
+		if ((mantissa >> (shift - 1)) & 1u)
+			++half;
+
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	// A carry out of the mantissa rounds up into the exponent, which is what we want
+	uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	if (mantissa & 0x1000u)
+		++half;
+
+	return static_cast<uint16_t>(half);
+}
+
+inline VertexAnimationTexture bake_vertex_animation(const SkeletonView &a_skeleton, const CompressedClipView &a_clip, const SkinningStreams &a_streams, utl::JobSystem &a_job_system,
+                                                    float32_t a_frames_per_second = 30.0f, uint32_t a_max_width = 4096)
+{
+	assert(a_clip.key_count() > 1 && "Clip needs at least two keys to be baked");
+	assert(a_frames_per_second > 0.0f && a_max_width > 0 && "Invalid bake settings");
+
+	const float32_t start    = a_clip.m_times[0];
+	const float32_t duration = a_clip.m_times[a_clip.key_count() - 1] - start;
+
+	VertexAnimationTexture texture;
+	texture.m_vertex_count      = a_streams.m_vertex_count;
+	texture.m_width             = std::min(a_streams.m_vertex_count * 2, a_max_width);
+	texture.m_frame_count       = std::max(1u, static_cast<uint32_t>(std::lround(duration * a_frames_per_second)));
+	texture.m_frames_per_second = duration > 0.0f ? static_cast<float32_t>(texture.m_frame_count) / duration : a_frames_per_second;
+	texture.m_height            = texture.m_frame_count * texture.rows_per_frame();
+	texture.m_texels.resize(static_cast<size_t>(texture.m_width) * texture.m_height * 4, 0);
+
+	// One instance per frame, evaluated exactly, no sharing or LOD
+	AnimationLodPolicy exact_policy;
+	exact_policy.m_share_quantum = 0.0f;
+
+	AnimationSystem system{a_skeleton, {a_clip}, a_job_system};
+	system.set_lod_policy(exact_policy);
+
+	for (uint32_t i = 0; i < texture.m_frame_count; ++i)
+		system.add_instance(0, start + static_cast<float32_t>(i) / texture.m_frames_per_second);
+
+	system.update(0.0f);
+
+	std::vector<float32_t> skinned(static_cast<size_t>(a_streams.m_vertex_count) * 6);
+	const size_t           frame_texels = static_cast<size_t>(texture.rows_per_frame()) * texture.m_width;
+
+	for (uint32_t frame = 0; frame < texture.m_frame_count; ++frame)
+	{
+		skin_vertices(a_streams, system.palette(frame), skinned.data(), a_job_system);
+
+		uint16_t *texels = texture.m_texels.data() + frame * frame_texels * 4;
+
+		for (uint32_t v = 0; v < a_streams.m_vertex_count; ++v, texels += 8)
+		{
+			const float32_t *vertex = skinned.data() + v * 6;
+
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				texels[i]     = float_to_half(vertex[i]);
+				texels[4 + i] = float_to_half(vertex[3 + i]);
+			}
+
+			texels[3] = float_to_half(1.0f);
+			texels[7] = float_to_half(0.0f);
+		}
+	}
+
+	return texture;
+}
+
+}        // namespace ror
@@ -93,6 +93,12 @@ void glfw_camera_init(GLFWwindow *a_window)
 	mayaCamera->set_bounds(width, height);
 }
 
+void glfw_camera_init(int a_width, int a_height)
+{
+	mayaCamera = new OrbitCamera();
+	mayaCamera->set_bounds(a_width, a_height);
+}
+
 void glfw_camera_update(Matrix4f &a_view_projection, Matrix4f &a_model, Vector3f &a_camera_position)
 {
 	int a_width = 0, a_height = 0;
@@ -59,6 +59,9 @@ void GLFW_mouse_button(GLFWwindow *a_window, int a_button, int a_action, int a_f
 // Use to initialize camera system
 void glfw_camera_init(GLFWwindow *a_window);
 
+// Use to initialize camera system without a window, i.e. headless rendering, no input callbacks are set
+void glfw_camera_init(int a_width, int a_height);
+
 // Call once to specify visual volume for the camera
 void glfw_camera_visual_volume(Vector3f a_minimum, Vector3f a_maximum);
 
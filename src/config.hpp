@@ -87,8 +87,10 @@ FORCE_INLINE std::vector<const char *> get_instance_layers_requested()
 FORCE_INLINE std::vector<const char *> get_device_extensions_requested()
 {
 	return std::vector<const char *>{
-	    VK_KHR_SWAPCHAIN_EXTENSION_NAME,                // VK_KHR_swapchain
-	    VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME        // "VK_KHR_portability_subset"
+	    VK_KHR_SWAPCHAIN_EXTENSION_NAME,                    // VK_KHR_swapchain
+	    VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME,           // "VK_KHR_portability_subset"
+	    VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME,        // "VK_EXT_calibrated_timestamps", optional, lines GPU profiling up with CPU time
+	    VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME            // "VK_KHR_timeline_semaphore", optional, uploads signal it instead of the CPU waiting on them
 	};
 }
 
@@ -103,6 +105,71 @@ FORCE_INLINE constexpr uint32_t get_number_of_buffers()
 	return 3;        // Tripple buffering
 }
 
+FORCE_INLINE constexpr uint32_t get_crowd_size()
+{
+	return 1;        // Astro boys drawn with one instanced draw
+}
+
+FORCE_INLINE constexpr uint32_t get_vat_crowd_size()
+{
+	return 0;        // Background astro boys played back from the vertex animation texture, 0 disables the baked crowd
+}
+
+FORCE_INLINE constexpr bool get_gpu_animation()
+{
+	return false;        // Sample clips and build palettes in animation.comp instead of the CPU animation system, loses blending and LOD
+}
+
+FORCE_INLINE constexpr bool get_cpu_skinning()
+{
+	return false;        // Skin with the CPU kernels into host visible buffers instead of skinning.comp, needs CPU animation
+}
+
+FORCE_INLINE constexpr uint32_t get_headless_width()
+{
+	return 1024;        // Size of the offscreen images rendered into when there is no window
+}
+
+FORCE_INLINE constexpr uint32_t get_headless_height()
+{
+	return 900;
+}
+
+FORCE_INLINE constexpr double get_headless_frame_time()
+{
+	return 1.0 / 60.0;        // Fixed animation step per headless frame so runs are repeatable
+}
+
+FORCE_INLINE constexpr bool get_gpu_profiler_log()
+{
+	return false;        // Logs GPU scope timings every frame as they resolve
+}
+
+FORCE_INLINE constexpr uint64_t get_memory_block_size()
+{
+	return 64ull * 1024 * 1024;        // Device memory blocks resources are sub-allocated from, bigger resources get their own allocation
+}
+
+FORCE_INLINE constexpr uint64_t get_memory_small_heap_size()
+{
+	return 1024ull * 1024 * 1024;        // Heaps up to this size use an eighth of the heap as block size instead
+}
+
+FORCE_INLINE constexpr uint64_t get_uniform_ring_frame_size()
+{
+	return 256ull * 1024;        // Uniform blocks one frame in flight can bump allocate from the uniform ring
+}
+
+FORCE_INLINE constexpr uint64_t get_staging_pool_size()
+{
+	return 32ull * 1024 * 1024;        // Persistently mapped ring every upload is staged through
+}
+
+FORCE_INLINE constexpr uint64_t get_staging_chunk_size()
+{
+	return 8ull * 1024 * 1024;        // Uploads are split into pieces of at most this, so big ones stream through the staging ring
+}
+
 FORCE_INLINE constexpr bool get_visualise_mipmaps()
 {
 	return false;
@@ -23,10 +23,16 @@
 //
 // Version: 1.0.0
 
+#include "profiling/cpu_profiler.hpp"
 #include "vulkan/vulkan_rhi.hpp"
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
 
 static bool         update_animation = true;
 static unsigned int render_cycle     = 1;        // 0=Render everything, 1=Render character only, 2=Render skeleton only
@@ -99,6 +105,32 @@ class VulkanApplication
 		shutdown();
 	}
 
+	// Renders a_frames frames into offscreen images without a window, works with software ICDs like lavapipe
+	// a_verify_skinning compares the GPU skinned vertices of the last frame with CPU skinning, returns false if they differ
+	bool run_headless(uint32_t a_frames, bool a_verify_skinning)
+	{
+		this->m_context = new vkd::Context(nullptr);
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < a_frames; ++i)
+			this->m_context->draw_frame(update_animation);
+
+		this->m_context->wait_idle();
+
+		auto   end     = std::chrono::steady_clock::now();
+		double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+
+		ror::log_info("Headless rendered {} frames in {:.2f} ms, {:.3f} ms per frame", a_frames, elapsed, elapsed / std::max(a_frames, 1u));
+
+		bool skinning_matches = !a_verify_skinning || a_frames == 0 || this->m_context->verify_gpu_skinning();
+
+		delete this->m_context;
+		this->m_context = nullptr;
+
+		return skinning_matches;
+	}
+
   private:
 	static void resize(GLFWwindow *window, int width, int height)
 	{
@@ -149,7 +181,11 @@ class VulkanApplication
 	{
 		while (!glfwWindowShouldClose(this->m_window))
 		{
-			glfwPollEvents();
+			{
+				utl::CpuZone zone{"poll events"};
+				glfwPollEvents();
+			}
+
 			this->m_context->draw_frame(update_animation);
 		}
 	}
@@ -168,14 +204,47 @@ class VulkanApplication
 
 int main(int argc, char *argv[])
 {
-	(void) argc;
-	(void) argv;
+	// --headless [frames] renders offscreen without a window, i.e. on farm nodes and CI
+	// --trace file writes CPU profiler zones of the whole run as Chrome trace JSON on exit
+	// --verify-skinning with --headless checks skinning.comp against the CPU skinning kernels after the last frame
+	bool        headless        = false;
+	bool        verify_skinning = false;
+	uint32_t    headless_frames = 100;
+	std::string trace_path{};
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--headless") == 0)
+		{
+			headless = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				headless_frames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			trace_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--verify-skinning") == 0)
+		{
+			verify_skinning = true;
+		}
+	}
+
+	if (!trace_path.empty())
+	{
+		utl::CpuProfiler::instance().set_enabled(true);
+		utl::CpuProfiler::instance().set_thread_name("main");
+	}
 
 	VulkanApplication app;
+	bool              passed = true;
 
 	try
 	{
-		app.run();
+		if (headless)
+			passed = app.run_headless(headless_frames, verify_skinning);
+		else
+			app.run();
 	}
 	catch (const std::exception &e)
 	{
@@ -183,5 +252,13 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	return EXIT_SUCCESS;
+	if (!trace_path.empty())
+	{
+		if (utl::CpuProfiler::instance().write_chrome_trace(trace_path))
+			ror::log_info("CPU trace written to {}", trace_path);
+		else
+			ror::log_critical("Can't write CPU trace to {}", trace_path);
+	}
+
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
 }
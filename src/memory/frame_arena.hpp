@@ -0,0 +1,111 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <foundation/rormacros.hpp>
+#include <memory>
+#include <type_traits>
+
+/*  FrameArena usage
+ *  Linear allocator over one block reserved up front, allocate<T>(count) bumps a pointer and never
+ *  touches the heap. Either reset() once per frame or take a marker() before temporary work and
+ *  rewind() to it afterwards. Nothing is destructed so only trivially destructible types are allowed.
+ *  Running out of space is a sizing bug, it asserts in debug and returns nullptr in release.
+ */
+
+namespace utl
+{
+class FrameArena final
+{
+  public:
+	FORCE_INLINE             FrameArena()                              = default;        //! Default constructor
+	FORCE_INLINE             FrameArena(const FrameArena &a_other)     = delete;         //! Copy constructor
+	FORCE_INLINE             FrameArena(FrameArena &&a_other) noexcept = default;        //! Move constructor
+	FORCE_INLINE FrameArena &operator=(const FrameArena &a_other) = delete;              //! Copy assignment operator
+	FORCE_INLINE FrameArena &operator=(FrameArena &&a_other) noexcept = default;         //! Move assignment operator
+	FORCE_INLINE ~FrameArena() noexcept                               = default;         //! Destructor
+
+	explicit FrameArena(size_t a_capacity) :
+	    m_memory(new std::byte[a_capacity]), m_capacity(a_capacity)
+	{}
+
+	template <class _type>
+	_type *allocate(size_t a_count)
+	{
+		static_assert(std::is_trivially_destructible<_type>::value, "Arena never runs destructors");
+
+		size_t offset = (this->m_offset + alignof(_type) - 1) & ~(alignof(_type) - 1);
+		size_t end    = offset + a_count * sizeof(_type);
+
+		assert(end <= this->m_capacity && "Frame arena is too small, increase its capacity");
+		if (end > this->m_capacity)
+			return nullptr;
+
+		this->m_offset = end;
+		if (end > this->m_high_water)
+			this->m_high_water = end;
+
+		return reinterpret_cast<_type *>(this->m_memory.get() + offset);
+	}
+
+	size_t marker() const
+	{
+		return this->m_offset;
+	}
+
+	void rewind(size_t a_marker)
+	{
+		assert(a_marker <= this->m_offset && "Can only rewind to an earlier marker");
+		this->m_offset = a_marker;
+	}
+
+	void reset()
+	{
+		this->m_offset = 0;
+	}
+
+	size_t capacity() const
+	{
+		return this->m_capacity;
+	}
+
+	size_t high_water() const
+	{
+		return this->m_high_water;
+	}
+
+  private:
+	std::unique_ptr<std::byte[]> m_memory{};            // Reserved once, alignment of new is enough for all arena users
+	size_t                       m_capacity{0};         // Size of m_memory in bytes
+	size_t                       m_offset{0};           // Next free byte
+	size_t                       m_high_water{0};       // Largest m_offset seen, use it to size the arena
+};
+
+}        // namespace utl
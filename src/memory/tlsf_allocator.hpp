@@ -0,0 +1,364 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <foundation/rormacros.hpp>
+#include <vector>
+
+/*  TlsfAllocator usage
+ *  Two level segregated fit allocator over an abstract range [0, size), it hands out offsets and never
+ *  touches memory so it can sub-allocate anything, i.e. VkDeviceMemory blocks. allocate() finds a free
+ *  range in O(1) using two levels of bitmaps, first by power of 2 then by 16 linear steps within it,
+ *  and returns its offset plus a handle for free(). Freed ranges merge with free neighbours straight away.
+ *  Alignments have to be powers of 2. Padding in front of an aligned allocation always becomes a free
+ *  range of its own, however small, so it merges back into its neighbours when they are freed.
+ */
+
+namespace utl
+{
+class TlsfAllocator final
+{
+  public:
+	static constexpr uint32_t invalid_handle = ~0u;
+
+	FORCE_INLINE                TlsfAllocator()                                 = default;        //! Default constructor
+	FORCE_INLINE                TlsfAllocator(const TlsfAllocator &a_other)     = default;        //! Copy constructor
+	FORCE_INLINE                TlsfAllocator(TlsfAllocator &&a_other) noexcept = default;        //! Move constructor
+	FORCE_INLINE TlsfAllocator &operator=(const TlsfAllocator &a_other)         = default;        //! Copy assignment operator
+	FORCE_INLINE TlsfAllocator &operator=(TlsfAllocator &&a_other) noexcept     = default;        //! Move assignment operator
+	FORCE_INLINE ~TlsfAllocator() noexcept                                      = default;        //! Destructor
+
+	explicit TlsfAllocator(uint64_t a_size) :
+	    m_size(a_size)
+	{
+		assert(a_size > 0 && "Can't allocate from an empty range");
+
+		std::fill(std::begin(this->m_heads), std::end(this->m_heads), invalid_handle);
+		this->insert_free(this->new_node(0, a_size));
+	}
+
+	// Returns false if no free range fits, otherwise a_offset is aligned and a_handle frees it again
+	bool allocate(uint64_t a_size, uint64_t a_alignment, uint64_t &a_offset, uint32_t &a_handle)
+	{
+		assert(a_size > 0 && "Zero sized allocation");
+		assert(a_alignment > 0 && (a_alignment & (a_alignment - 1)) == 0 && "Alignment has to be a power of 2");
+
+		uint32_t node = this->find_free(a_size + a_alignment - 1);
+		if (node == invalid_handle)
+			return false;
+
+		this->remove_free(node);
+
+		// Give back the space in front of the aligned offset
+		uint64_t offset  = this->m_nodes[node].m_offset;
+		uint64_t aligned = (offset + a_alignment - 1) & ~(a_alignment - 1);
+
+		if (aligned > offset)
+		{
+			uint32_t front = this->new_node(offset, aligned - offset);
+			this->link_before(node, front);
+			this->m_nodes[node].m_offset = aligned;
+			this->m_nodes[node].m_size -= aligned - offset;
+			this->insert_free(front);
+		}
+
+		// And everything after its end
+		if (this->m_nodes[node].m_size > a_size)
+		{
+			uint32_t back = this->new_node(aligned + a_size, this->m_nodes[node].m_size - a_size);
+			this->link_after(node, back);
+			this->m_nodes[node].m_size = a_size;
+			this->insert_free(back);
+		}
+
+		this->m_used += a_size;
+		this->m_allocation_count++;
+
+		a_offset = aligned;
+		a_handle = node;
+
+		return true;
+	}
+
+	void free(uint32_t a_handle)
+	{
+		assert(a_handle < this->m_nodes.size() && !this->m_nodes[a_handle].m_free && "Invalid or already freed handle");
+
+		this->m_used -= this->m_nodes[a_handle].m_size;
+		this->m_allocation_count--;
+
+		uint32_t node = a_handle;
+		uint32_t prev = this->m_nodes[node].m_prev_physical;
+		uint32_t next = this->m_nodes[node].m_next_physical;
+
+		if (prev != invalid_handle && this->m_nodes[prev].m_free)
+		{
+			this->remove_free(prev);
+			this->m_nodes[prev].m_size += this->m_nodes[node].m_size;
+			this->unlink(node);
+			node = prev;
+		}
+
+		if (next != invalid_handle && this->m_nodes[next].m_free)
+		{
+			this->remove_free(next);
+			this->m_nodes[node].m_size += this->m_nodes[next].m_size;
+			this->unlink(next);
+		}
+
+		this->insert_free(node);
+	}
+
+	uint64_t size() const
+	{
+		return this->m_size;
+	}
+
+	uint64_t used() const
+	{
+		return this->m_used;
+	}
+
+	uint32_t allocation_count() const
+	{
+		return this->m_allocation_count;
+	}
+
+	bool empty() const
+	{
+		return this->m_allocation_count == 0;
+	}
+
+  private:
+	static constexpr uint32_t second_level_log2  = 4;
+	static constexpr uint32_t second_level_count = 1u << second_level_log2;        // Linear steps per power of 2
+	static constexpr uint32_t first_level_count  = 64 - second_level_log2 + 1;     // Covers any uint64_t size
+
+	struct Node
+	{
+		uint64_t m_offset{0};
+		uint64_t m_size{0};
+		uint32_t m_prev_physical{invalid_handle};        // Neighbouring ranges by offset
+		uint32_t m_next_physical{invalid_handle};
+		uint32_t m_prev_free{invalid_handle};            // Free list of the same size class, next also chains unused nodes
+		uint32_t m_next_free{invalid_handle};
+		bool     m_free{false};
+	};
+
+	static uint32_t floor_log2(uint64_t a_value)
+	{
+		uint32_t result = 0;
+		while (a_value >>= 1)
+			++result;
+
+		return result;
+	}
+
+	static uint32_t lowest_bit(uint64_t a_value)
+	{
+		uint32_t result = 0;
+		while (!(a_value & 1))
+		{
+			a_value >>= 1;
+			++result;
+		}
+
+		return result;
+	}
+
+	// Size class a_size belongs to, all sizes of a class fall in [first, second) of the class
+	static void mapping(uint64_t a_size, uint32_t &a_first, uint32_t &a_second)
+	{
+		if (a_size < second_level_count)
+		{
+			a_first  = 0;
+			a_second = static_cast<uint32_t>(a_size);
+			return;
+		}
+
+		uint32_t msb = floor_log2(a_size);
+
+		a_first  = msb - second_level_log2 + 1;
+		a_second = static_cast<uint32_t>(a_size >> (msb - second_level_log2)) - second_level_count;
+	}
+
+	// Any free range in a class above the class of a_size fits, so rounding up makes the search O(1)
+	uint32_t find_free(uint64_t a_size) const
+	{
+		uint64_t rounded = a_size;
+		if (rounded >= second_level_count)
+			rounded += (uint64_t{1} << (floor_log2(rounded) - second_level_log2)) - 1;
+
+		uint32_t first, second;
+		mapping(rounded, first, second);
+
+		if (first < first_level_count)
+		{
+			uint32_t second_map = this->m_second_bitmaps[first] & (~0u << second);
+			uint64_t first_map  = first + 1 < 64 ? this->m_first_bitmap & (~uint64_t{0} << (first + 1)) : 0;
+
+			if (second_map)
+				return this->m_heads[first * second_level_count + lowest_bit(second_map)];
+
+			if (first_map)
+			{
+				first = lowest_bit(first_map);
+				return this->m_heads[first * second_level_count + lowest_bit(this->m_second_bitmaps[first])];
+			}
+		}
+
+		// Rounding skips ranges of a_size's own class that might still fit, i.e. a range as big as the whole block
+		mapping(a_size, first, second);
+		for (uint32_t node = this->m_heads[first * second_level_count + second]; node != invalid_handle; node = this->m_nodes[node].m_next_free)
+			if (this->m_nodes[node].m_size >= a_size)
+				return node;
+
+		return invalid_handle;
+	}
+
+	void insert_free(uint32_t a_node)
+	{
+		uint32_t first, second;
+		mapping(this->m_nodes[a_node].m_size, first, second);
+
+		uint32_t &head = this->m_heads[first * second_level_count + second];
+
+		this->m_nodes[a_node].m_free      = true;
+		this->m_nodes[a_node].m_prev_free = invalid_handle;
+		this->m_nodes[a_node].m_next_free = head;
+
+		if (head != invalid_handle)
+			this->m_nodes[head].m_prev_free = a_node;
+
+		head = a_node;
+
+		this->m_first_bitmap |= uint64_t{1} << first;
+		this->m_second_bitmaps[first] |= 1u << second;
+	}
+
+	void remove_free(uint32_t a_node)
+	{
+		Node &node = this->m_nodes[a_node];
+
+		uint32_t first, second;
+		mapping(node.m_size, first, second);
+
+		if (node.m_prev_free != invalid_handle)
+			this->m_nodes[node.m_prev_free].m_next_free = node.m_next_free;
+		else
+			this->m_heads[first * second_level_count + second] = node.m_next_free;
+
+		if (node.m_next_free != invalid_handle)
+			this->m_nodes[node.m_next_free].m_prev_free = node.m_prev_free;
+
+		if (this->m_heads[first * second_level_count + second] == invalid_handle)
+		{
+			this->m_second_bitmaps[first] &= ~(1u << second);
+			if (!this->m_second_bitmaps[first])
+				this->m_first_bitmap &= ~(uint64_t{1} << first);
+		}
+
+		node.m_free      = false;
+		node.m_prev_free = invalid_handle;
+		node.m_next_free = invalid_handle;
+	}
+
+	uint32_t new_node(uint64_t a_offset, uint64_t a_size)
+	{
+		uint32_t node = this->m_unused;
+
+		if (node != invalid_handle)
+			this->m_unused = this->m_nodes[node].m_next_free;
+		else
+		{
+			node = static_cast<uint32_t>(this->m_nodes.size());
+			this->m_nodes.emplace_back();
+		}
+
+		this->m_nodes[node]          = Node{};
+		this->m_nodes[node].m_offset = a_offset;
+		this->m_nodes[node].m_size   = a_size;
+
+		return node;
+	}
+
+	void link_before(uint32_t a_node, uint32_t a_new)
+	{
+		uint32_t prev = this->m_nodes[a_node].m_prev_physical;
+
+		this->m_nodes[a_new].m_prev_physical  = prev;
+		this->m_nodes[a_new].m_next_physical  = a_node;
+		this->m_nodes[a_node].m_prev_physical = a_new;
+
+		if (prev != invalid_handle)
+			this->m_nodes[prev].m_next_physical = a_new;
+	}
+
+	void link_after(uint32_t a_node, uint32_t a_new)
+	{
+		uint32_t next = this->m_nodes[a_node].m_next_physical;
+
+		this->m_nodes[a_new].m_prev_physical  = a_node;
+		this->m_nodes[a_new].m_next_physical  = next;
+		this->m_nodes[a_node].m_next_physical = a_new;
+
+		if (next != invalid_handle)
+			this->m_nodes[next].m_prev_physical = a_new;
+	}
+
+	// Takes a node out of the physical list and keeps it for reuse
+	void unlink(uint32_t a_node)
+	{
+		uint32_t prev = this->m_nodes[a_node].m_prev_physical;
+		uint32_t next = this->m_nodes[a_node].m_next_physical;
+
+		if (prev != invalid_handle)
+			this->m_nodes[prev].m_next_physical = next;
+
+		if (next != invalid_handle)
+			this->m_nodes[next].m_prev_physical = prev;
+
+		this->m_nodes[a_node]             = Node{};
+		this->m_nodes[a_node].m_next_free = this->m_unused;
+		this->m_unused                    = a_node;
+	}
+
+	std::vector<Node> m_nodes{};                                                  // Free and used ranges, indices are handles
+	uint32_t          m_heads[first_level_count * second_level_count]{};          // Free list per size class
+	uint32_t          m_second_bitmaps[first_level_count]{};                      // Bit per size class with free ranges
+	uint64_t          m_first_bitmap{0};                                          // Bit per power of 2 with free ranges
+	uint32_t          m_unused{invalid_handle};                                   // Recycled nodes
+	uint64_t          m_size{0};                                                  // Size of the managed range
+	uint64_t          m_used{0};                                                  // Sum of allocated sizes, without alignment padding
+	uint32_t          m_allocation_count{0};
+};
+
+}        // namespace utl
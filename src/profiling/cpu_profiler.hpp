@@ -0,0 +1,286 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <foundation/rormacros.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*  CpuProfiler usage
+ *  Place a CpuZone at the top of any scope to time it, zones nest and work on any thread:
+ *      utl::CpuZone zone{"update uniforms"};
+ *  Names must be string literals or otherwise outlive the profiler, only the pointer is stored.
+ *  Zones cost one relaxed load while the profiler is disabled, set_enabled(true) starts recording.
+ *  Every thread writes into its own ring of cpu_profiler_ring_size zones which it alone writes to, so
+ *  recording takes no locks. When a ring is full the oldest zones are overwritten, a trace holds the
+ *  most recent zones of each thread. Only the first zone of a thread takes a lock to register its ring.
+ *  write_chrome_trace() can be called from any thread at any time and writes Chrome trace event JSON,
+ *  which opens in chrome://tracing and ui.perfetto.dev. Timestamps are std::chrono::steady_clock so they
+ *  line up with calibrated GPU timings from GpuProfiler.
+ */
+
+namespace utl
+{
+constexpr uint32_t cpu_profiler_ring_size = 1u << 14;        // Zones kept per thread, has to be a power of 2
+
+class CpuProfiler final
+{
+  public:
+	FORCE_INLINE CpuProfiler(const CpuProfiler &a_other)     = delete;        //! Copy constructor
+	FORCE_INLINE CpuProfiler(CpuProfiler &&a_other) noexcept = delete;        //! Move constructor
+	FORCE_INLINE CpuProfiler &operator=(const CpuProfiler &a_other) = delete;            //! Copy assignment operator
+	FORCE_INLINE CpuProfiler &operator=(CpuProfiler &&a_other) noexcept = delete;        //! Move assignment operator
+
+	static CpuProfiler &instance()
+	{
+		static CpuProfiler profiler;
+		return profiler;
+	}
+
+	// Nanoseconds of std::chrono::steady_clock
+	static int64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	bool enabled() const
+	{
+		return this->m_enabled.load(std::memory_order_relaxed);
+	}
+
+	void set_enabled(bool a_enabled)
+	{
+		this->m_enabled.store(a_enabled, std::memory_order_relaxed);
+	}
+
+	// Shows up as the track name in the trace, call from the thread being named
+	void set_thread_name(std::string a_name)
+	{
+		ThreadRing *ring = current_ring();
+
+		// Threads that never record a zone never get a ring, the name is applied if they do
+		if (!ring)
+		{
+			pending_thread_name() = std::move(a_name);
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+		ring->m_name = std::move(a_name);
+	}
+
+	void record(const char *a_name, int64_t a_begin, int64_t a_end)
+	{
+		ThreadRing &ring = this->thread_ring();
+		uint64_t    head = ring.m_head.load(std::memory_order_relaxed);
+		Zone       &zone = ring.m_zones[head & (cpu_profiler_ring_size - 1)];
+
+		zone.m_name.store(a_name, std::memory_order_relaxed);
+		zone.m_begin.store(a_begin, std::memory_order_relaxed);
+		zone.m_end.store(a_end, std::memory_order_relaxed);
+
+		ring.m_head.store(head + 1, std::memory_order_release);
+	}
+
+	// Returns false if a_path can't be written
+	bool write_chrome_trace(const std::string &a_path) const
+	{
+		FILE *file = std::fopen(a_path.c_str(), "w");
+		if (!file)
+			return false;
+
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+
+		std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+		bool first = true;
+		for (const auto &ring : this->m_rings)
+		{
+			std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", ring->m_id, escape(ring->m_name.c_str()).c_str());
+			first = false;
+
+			for (const auto &zone : snapshot(*ring))
+			{
+				std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				             escape(zone.m_name).c_str(), ring->m_id, static_cast<double>(zone.m_begin - this->m_epoch) / 1000.0, static_cast<double>(zone.m_end - zone.m_begin) / 1000.0);
+			}
+		}
+
+		std::fprintf(file, "\n]}\n");
+
+		return std::fclose(file) == 0;
+	}
+
+  private:
+	FORCE_INLINE CpuProfiler() = default;        //! Default constructor
+
+	// Relaxed atomics because write_chrome_trace() may read a zone while its thread overwrites it
+	struct Zone
+	{
+		std::atomic<const char *> m_name{nullptr};
+		std::atomic<int64_t>      m_begin{0};
+		std::atomic<int64_t>      m_end{0};
+	};
+
+	struct ZoneCopy
+	{
+		const char *m_name{nullptr};
+		int64_t     m_begin{0};
+		int64_t     m_end{0};
+	};
+
+	struct ThreadRing
+	{
+		Zone                  m_zones[cpu_profiler_ring_size];        // Written only by the owning thread
+		std::atomic<uint64_t> m_head{0};                              // Zones ever recorded, next one goes at m_head % size
+		uint32_t              m_id{0};                                // Trace thread id, in order of registration
+		std::string           m_name{};                               // Guarded by m_mutex
+	};
+
+	static ThreadRing *&current_ring()
+	{
+		thread_local ThreadRing *ring = nullptr;
+		return ring;
+	}
+
+	static std::string &pending_thread_name()
+	{
+		thread_local std::string name;
+		return name;
+	}
+
+	ThreadRing &thread_ring()
+	{
+		ThreadRing *&ring = current_ring();
+
+		if (!ring)
+			ring = this->register_thread();
+
+		return *ring;
+	}
+
+	ThreadRing *register_thread()
+	{
+		std::lock_guard<std::mutex> lock(this->m_mutex);
+
+		this->m_rings.emplace_back(std::make_unique<ThreadRing>());
+
+		ThreadRing *ring = this->m_rings.back().get();
+		ring->m_id       = static_cast<uint32_t>(this->m_rings.size());
+		ring->m_name     = pending_thread_name().empty() ? "thread " + std::to_string(ring->m_id) : pending_thread_name();
+
+		return ring;
+	}
+
+	// Copies the zones of a ring, dropping any its thread overwrote while they were being copied
+	static std::vector<ZoneCopy> snapshot(const ThreadRing &a_ring)
+	{
+		uint64_t head  = a_ring.m_head.load(std::memory_order_acquire);
+		uint64_t first = head > cpu_profiler_ring_size ? head - cpu_profiler_ring_size : 0;
+
+		std::vector<ZoneCopy> zones;
+		zones.reserve(head - first);
+
+		for (uint64_t i = first; i < head; ++i)
+		{
+			const Zone &zone = a_ring.m_zones[i & (cpu_profiler_ring_size - 1)];
+			zones.push_back({zone.m_name.load(std::memory_order_relaxed), zone.m_begin.load(std::memory_order_relaxed), zone.m_end.load(std::memory_order_relaxed)});
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		// The writer may be filling slot new_head before publishing it, which overwrites zone new_head - size too
+		uint64_t new_head = a_ring.m_head.load(std::memory_order_relaxed);
+		uint64_t valid    = new_head + 1 > cpu_profiler_ring_size ? new_head + 1 - cpu_profiler_ring_size : 0;
+
+		if (valid > first)
+			zones.erase(zones.begin(), zones.begin() + static_cast<std::ptrdiff_t>(std::min(valid, head) - first));
+
+		return zones;
+	}
+
+	static std::string escape(const char *a_text)
+	{
+		std::string output;
+
+		for (const char *character_pointer = a_text; character_pointer && *character_pointer; ++character_pointer)
+		{
+			char character = *character_pointer;
+
+			if (character == '"' || character == '\\')
+				output.push_back('\\');
+
+			if (static_cast<unsigned char>(character) >= 0x20)
+				output.push_back(character);
+		}
+
+		return output;
+	}
+
+	std::vector<std::unique_ptr<ThreadRing>> m_rings;                            // Rings outlive their threads so zones of finished threads still export
+	mutable std::mutex                       m_mutex;                            // Guards m_rings and thread names
+	std::atomic<bool>                        m_enabled{false};                   // Zones record nothing while false
+	int64_t                                  m_epoch{CpuProfiler::now()};        // Trace time 0
+};
+
+// Times its own lifetime, see CpuProfiler usage
+class CpuZone final
+{
+  public:
+	FORCE_INLINE CpuZone(const CpuZone &a_other)     = delete;        //! Copy constructor
+	FORCE_INLINE CpuZone(CpuZone &&a_other) noexcept = delete;        //! Move constructor
+	FORCE_INLINE CpuZone &operator=(const CpuZone &a_other) = delete;            //! Copy assignment operator
+	FORCE_INLINE CpuZone &operator=(CpuZone &&a_other) noexcept = delete;        //! Move assignment operator
+
+	FORCE_INLINE explicit CpuZone(const char *a_name) :
+	    m_name(a_name), m_active(CpuProfiler::instance().enabled())
+	{
+		if (this->m_active)
+			this->m_begin = CpuProfiler::now();
+	}
+
+	FORCE_INLINE ~CpuZone() noexcept
+	{
+		if (this->m_active)
+			CpuProfiler::instance().record(this->m_name, this->m_begin, CpuProfiler::now());
+	}
+
+  private:
+	const char *m_name{nullptr};        // Not owned
+	int64_t     m_begin{0};             // Nanoseconds from CpuProfiler::now()
+	bool        m_active{false};        // Profiler was enabled when the zone started
+};
+
+}        // namespace utl
@@ -0,0 +1,239 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "profiling/cpu_profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <foundation/rormacros.hpp>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*  JobSystem usage
+ *  Create once with the number of threads to use, the calling thread counts as one of them.
+ *  parallel_for(count, grain, function) splits [0, count) into chunks of grain items and calls
+ *  function(begin, end, thread_index) for each chunk, thread_index is in [0, thread_count) and can be
+ *  used to index per thread scratch memory. The caller helps executing chunks and returns when all are done.
+ *  Each thread has its own queue, chunks are dealt out round robin and idle threads steal from the
+ *  front of other queues while owners pop from the back, so uneven chunks still balance out.
+ *  Only one thread may call parallel_for at a time and jobs must not call parallel_for themselves.
+ */
+
+namespace utl
+{
+class JobSystem final
+{
+  public:
+	using RangeFunction = void (*)(void *a_context, uint32_t a_begin, uint32_t a_end, uint32_t a_thread_index);
+
+	FORCE_INLINE JobSystem(const JobSystem &a_other)     = delete;        //! Copy constructor
+	FORCE_INLINE JobSystem(JobSystem &&a_other) noexcept = delete;        //! Move constructor
+	FORCE_INLINE JobSystem &operator=(const JobSystem &a_other) = delete;            //! Copy assignment operator
+	FORCE_INLINE JobSystem &operator=(JobSystem &&a_other) noexcept = delete;        //! Move assignment operator
+
+	explicit JobSystem(uint32_t a_thread_count = std::max(1u, std::thread::hardware_concurrency())) :
+	    m_queues(std::max(1u, a_thread_count))
+	{
+		for (uint32_t i = 1; i < this->m_queues.size(); ++i)
+			this->m_workers.emplace_back(&JobSystem::worker, this, i);
+	}
+
+	~JobSystem() noexcept
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->m_sleep_mutex);
+			this->m_quit = true;
+		}
+		this->m_wake.notify_all();
+
+		for (auto &worker : this->m_workers)
+			worker.join();
+	}
+
+	uint32_t thread_count() const
+	{
+		return static_cast<uint32_t>(this->m_queues.size());
+	}
+
+	template <class _function>
+	void parallel_for(uint32_t a_count, uint32_t a_grain, _function &&a_function)
+	{
+		using function_type = std::remove_reference_t<_function>;
+
+		auto trampoline = [](void *a_context, uint32_t a_begin, uint32_t a_end, uint32_t a_thread_index) {
+			(*static_cast<function_type *>(a_context))(a_begin, a_end, a_thread_index);
+		};
+
+		this->dispatch(a_count, a_grain, trampoline, const_cast<void *>(static_cast<const void *>(&a_function)));
+	}
+
+  private:
+	struct Job
+	{
+		RangeFunction          m_function{nullptr};         // Type erased range function
+		void                  *m_context{nullptr};          // Callable the function forwards to
+		uint32_t               m_begin{0};                  // First item of the chunk
+		uint32_t               m_end{0};                    // One past the last item of the chunk
+		std::atomic<uint32_t> *m_remaining{nullptr};        // Chunks of this dispatch not finished yet
+	};
+
+	// Fixed size ring so pushing never allocates, a full queue runs the job inline instead
+	struct alignas(64) WorkQueue
+	{
+		static constexpr uint32_t capacity = 1024;
+
+		bool push(const Job &a_job)
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+			if (this->m_tail - this->m_head == capacity)
+				return false;
+
+			this->m_jobs[this->m_tail++ % capacity] = a_job;
+			return true;
+		}
+
+		bool pop(Job &a_job)
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+			if (this->m_tail == this->m_head)
+				return false;
+
+			a_job = this->m_jobs[--this->m_tail % capacity];
+			return true;
+		}
+
+		bool steal(Job &a_job)
+		{
+			std::lock_guard<std::mutex> lock(this->m_mutex);
+			if (this->m_tail == this->m_head)
+				return false;
+
+			a_job = this->m_jobs[this->m_head++ % capacity];
+			return true;
+		}
+
+		std::mutex m_mutex;                 // Guards the ring
+		Job        m_jobs[capacity];        // Ring storage
+		uint32_t   m_head{0};               // Front, where thieves take from
+		uint32_t   m_tail{0};               // Back, where the owner pushes and pops
+	};
+
+	void dispatch(uint32_t a_count, uint32_t a_grain, RangeFunction a_function, void *a_context)
+	{
+		if (a_count == 0)
+			return;
+
+		const uint32_t grain  = std::max(1u, a_grain);
+		const uint32_t chunks = (a_count + grain - 1) / grain;
+		const uint32_t queues = this->thread_count();
+
+		std::atomic<uint32_t> remaining{chunks};
+
+		for (uint32_t chunk = 0; chunk < chunks; ++chunk)
+		{
+			Job job{a_function, a_context, chunk * grain, std::min(a_count, (chunk + 1) * grain), &remaining};
+
+			this->m_pending.fetch_add(1, std::memory_order_acq_rel);
+			if (!this->m_queues[chunk % queues].push(job))
+			{
+				this->m_pending.fetch_sub(1, std::memory_order_acq_rel);
+				this->execute(job, 0);
+			}
+		}
+
+		// Taking the lock orders the pending increment before any worker goes back to sleep
+		{
+			std::lock_guard<std::mutex> lock(this->m_sleep_mutex);
+		}
+		this->m_wake.notify_all();
+
+		while (remaining.load(std::memory_order_acquire) != 0)
+		{
+			Job job;
+			if (this->find_job(0, job))
+				this->execute(job, 0);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	bool find_job(uint32_t a_thread_index, Job &a_job)
+	{
+		const uint32_t queues = this->thread_count();
+
+		bool found = this->m_queues[a_thread_index].pop(a_job);
+		for (uint32_t i = 1; !found && i < queues; ++i)
+			found = this->m_queues[(a_thread_index + i) % queues].steal(a_job);
+
+		if (found)
+			this->m_pending.fetch_sub(1, std::memory_order_acq_rel);
+
+		return found;
+	}
+
+	void execute(const Job &a_job, uint32_t a_thread_index)
+	{
+		a_job.m_function(a_job.m_context, a_job.m_begin, a_job.m_end, a_thread_index);
+		a_job.m_remaining->fetch_sub(1, std::memory_order_acq_rel);
+	}
+
+	void worker(uint32_t a_thread_index)
+	{
+		CpuProfiler::instance().set_thread_name("job worker " + std::to_string(a_thread_index));
+
+		while (true)
+		{
+			Job job;
+			if (this->find_job(a_thread_index, job))
+			{
+				this->execute(job, a_thread_index);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(this->m_sleep_mutex);
+			this->m_wake.wait(lock, [this]() { return this->m_quit || this->m_pending.load(std::memory_order_acquire) > 0; });
+
+			if (this->m_quit)
+				return;
+		}
+	}
+
+	std::vector<WorkQueue>   m_queues;               // One per thread, index 0 belongs to the caller of parallel_for
+	std::vector<std::thread> m_workers;              // Threads 1 to thread_count - 1
+	std::atomic<uint32_t>    m_pending{0};           // Jobs sitting in queues, workers sleep while this is 0
+	std::mutex               m_sleep_mutex;          // Guards sleeping and m_quit
+	std::condition_variable  m_wake;                 // Signalled when jobs are queued or on shutdown
+	bool                     m_quit{false};          // Set once on destruction
+};
+
+}        // namespace utl
@@ -0,0 +1,118 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#define CGLTF_IMPLEMENTATION
+#include "cgltf.h"
+
+#include "animation/animation_asset.hpp"
+#include "animation/astro_boy_import.hpp"
+#include "animation/compressed_clip.hpp"
+#include "animation/gltf_import.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Converts skeletons and clips into the mapped binary animation asset format
+// Usage: AnimationConverter <input.gltf|input.glb|astro_boy> <output.vean> [--tolerance 0.001] [--rate 30]
+// The special input name astro_boy converts the static tables compiled in from assets/astroboy
+
+static void print_usage()
+{
+	std::cout << "Usage: AnimationConverter <input.gltf|input.glb|astro_boy> <output.vean> [--tolerance 0.001] [--rate 30]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3)
+	{
+		print_usage();
+		return EXIT_FAILURE;
+	}
+
+	std::string input{argv[1]};
+	std::string output{argv[2]};
+	float32_t   tolerance   = 0.001f;
+	float32_t   sample_rate = 30.0f;
+
+	for (int i = 3; i + 1 < argc; i += 2)
+	{
+		std::string option{argv[i]};
+
+		if (option == "--tolerance")
+			tolerance = std::stof(argv[i + 1]);
+		else if (option == "--rate")
+			sample_rate = std::stof(argv[i + 1]);
+		else
+		{
+			print_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	ror::Skeleton                   skeleton;
+	std::vector<ror::AnimationClip> clips;
+
+	if (input == "astro_boy")
+	{
+		skeleton = ror::skeleton_from_astro_boy(astro_boy_tree, astro_boy_nodes_count);
+		clips.push_back(ror::clip_from_astro_boy(skeleton));
+	}
+	else if (!ror::skin_from_gltf(input, skeleton, clips, sample_rate))
+	{
+		return EXIT_FAILURE;
+	}
+
+	std::vector<ror::CompressedClip> compressed_clips;
+	size_t                           raw_size = 0;
+
+	for (auto &clip : clips)
+	{
+		compressed_clips.push_back(ror::compress_clip(skeleton, clip, tolerance));
+		raw_size += clip.m_keys.size() * sizeof(ror::Matrix4f);
+	}
+
+	if (!ror::write_animation_asset(output, skeleton, compressed_clips))
+		return EXIT_FAILURE;
+
+	size_t compressed_size = 0;
+	for (auto &clip : compressed_clips)
+		compressed_size += clip.size_in_bytes();
+
+	std::cout << "Converted " << input << " to " << output << ": " << skeleton.node_count() << " nodes, " << skeleton.joint_count() << " joints, "
+	          << compressed_clips.size() << " clips, " << raw_size << " bytes of matrix keys compressed to " << compressed_size << " bytes" << std::endl;
+
+	// Round trip through the loader so a broken asset never gets checked in
+	ror::AnimationAsset asset;
+	if (!asset.load(output) || asset.clip_count() != compressed_clips.size() || asset.skeleton().node_count() != skeleton.node_count())
+	{
+		std::cout << "Error! " << output << " doesn't load back correctly" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,259 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#include "animation/animation_clip.hpp"
+#include "animation/astro_boy_import.hpp"
+#include "animation/compressed_clip.hpp"
+#include "animation/matrix_kernels.hpp"
+#include "animation/skeleton.hpp"
+#include "skeletal_animation.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <new>
+#include <vector>
+
+// Times the legacy collada animation path against the current evaluator
+// Usage: AnimationMicroBench [joints_per_run]
+// Every benchmark runs until about joints_per_run joints have been processed and reports ns per joint and heap
+// allocations per call, counted by replacing global operator new. Runs on astro boy and on synthetic skeletons of
+// 64 to 1024 joints, every joint animated. The last column is how much faster than the whole legacy evaluation.
+// Legacy lerps matrices while the current path interpolates decomposed transforms, the difference is printed too.
+// New evaluators or kernel paths should be added here next to the code they replace.
+
+static std::atomic<uint64_t> allocation_count{0};
+
+void *operator new(size_t a_size)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+	if (void *memory = std::malloc(a_size ? a_size : 1))
+		return memory;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void *a_memory) noexcept
+{
+	std::free(a_memory);
+}
+
+void operator delete(void *a_memory, size_t) noexcept
+{
+	std::free(a_memory);
+}
+
+static volatile float32_t sink = 0.0f;        // Keeps results alive so calls aren't optimised away
+
+struct Measurement
+{
+	double m_nanoseconds_per_joint{0.0};
+	double m_allocations_per_call{0.0};
+};
+
+// Calls a_function until a_joints_per_run joints are processed, a_joints is how many one call processes
+template <typename _function>
+static Measurement measure(uint32_t a_joints, uint64_t a_joints_per_run, _function &&a_function)
+{
+	const uint64_t calls = std::max<uint64_t>(1, a_joints_per_run / a_joints);
+
+	a_function();        // Warm up caches and lazy statics
+
+	uint64_t allocations = allocation_count.load(std::memory_order_relaxed);
+	auto     start       = std::chrono::steady_clock::now();
+
+	for (uint64_t i = 0; i < calls; ++i)
+		a_function();
+
+	auto end = std::chrono::steady_clock::now();
+
+	Measurement result;
+	result.m_nanoseconds_per_joint = std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(calls * a_joints);
+	result.m_allocations_per_call  = static_cast<double>(allocation_count.load(std::memory_order_relaxed) - allocations) / static_cast<double>(calls);
+
+	return result;
+}
+
+static void report(const char *a_skeleton, uint32_t a_joints, const char *a_name, const Measurement &a_measurement, double a_baseline)
+{
+	std::printf("%s, %u, %s, %.2f, %.2f, %.2f\n", a_skeleton, a_joints, a_name, a_measurement.m_nanoseconds_per_joint, a_measurement.m_allocations_per_call,
+	            a_baseline / a_measurement.m_nanoseconds_per_joint);
+}
+
+// Collada matrices are row-major, rotation about z by a_angle then translation along y
+static ColladaMatrix collada_joint(float32_t a_angle, float32_t a_length)
+{
+	float32_t c = std::cos(a_angle);
+	float32_t s = std::sin(a_angle);
+
+	return ColladaMatrix{{c, -s, 0.0f, 0.0f,
+	                      s, c, 0.0f, a_length,
+	                      0.0f, 0.0f, 1.0f, 0.0f,
+	                      0.0f, 0.0f, 0.0f, 1.0f}};
+}
+
+// Chains of 8 joints, each chain hangs off the middle of a parent chain in a binary tree, so depth grows with size
+// like a real rig with fingers, tails and cloth chains. Tracks use astro boy key times so the legacy code can play them
+static void synthetic_skeleton(uint32_t a_joints, std::vector<AstroBoyTree> &a_tree, std::map<int, std::vector<ColladaMatrix>> &a_tracks)
+{
+	constexpr uint32_t chain_length = 8;
+
+	a_tree.assign(a_joints, AstroBoyTree{});
+	a_tracks.clear();
+
+	for (uint32_t i = 0; i < a_joints; ++i)
+	{
+		uint32_t chain = i / chain_length;
+		int32_t  parent{-1};
+
+		if (i % chain_length != 0)
+			parent = static_cast<int32_t>(i - 1);
+		else if (chain > 0)
+			parent = static_cast<int32_t>(((chain - 1) / 2) * chain_length + chain_length / 2);
+
+		AstroBoyTree &node = a_tree[i];
+		std::snprintf(node.m_name, sizeof(node.m_name), "joint%u", i);
+		node.m_index     = static_cast<int>(i);
+		node.m_parent_id = parent;
+		node.m_type      = 1;
+		node.m_transform = collada_joint(0.1f, 0.25f);
+		node.m_inverse   = collada_joint(0.0f, 0.0f);
+
+		std::vector<ColladaMatrix> &keys = a_tracks[static_cast<int>(i)];
+		for (uint32_t k = 0; k < astro_boy_animation_keyframes_count; ++k)
+			keys.push_back(collada_joint(0.1f + 0.3f * std::sin(static_cast<float32_t>(k + i) * 0.35f), 0.25f));
+	}
+}
+
+// Benchmarks everything on whatever is in a_tree and astro_boy_animation_keyframe_matrices
+static void run(const char *a_name, AstroBoyTree *a_tree, uint32_t a_nodes_count, uint64_t a_joints_per_run)
+{
+	const uint32_t keyframe   = astro_boy_animation_keyframes_count / 2;
+	const double   delta_time = 0.5 * (astro_boy_animation_keyframe_times[keyframe + 1] - astro_boy_animation_keyframe_times[keyframe]);
+
+	ror::Skeleton           skeleton   = ror::skeleton_from_astro_boy(a_tree, a_nodes_count);
+	ror::AnimationClip      clip       = ror::clip_from_astro_boy(skeleton);
+	ror::CompressedClip     compressed = ror::compress_clip(skeleton, clip);
+	ror::CompressedClipView view       = compressed;
+
+	ror::Pose pose;
+	pose.allocate(skeleton);
+
+	// Legacy reports node worlds times bind shape in original order
+	float32_t                  error   = 0.0f;
+	ror::Matrix4f              shape   = ror::get_ror_matrix4(astro_boy_skeleton_bind_shape_matrix);
+	std::vector<ror::Matrix4f> legacy  = ror::get_world_matrices_for_skinning(a_tree, static_cast<int>(a_nodes_count), keyframe, delta_time);
+	ror::evaluate_pose(skeleton, clip, keyframe, delta_time, pose);
+
+	for (uint32_t i = 0; i < a_nodes_count; ++i)
+	{
+		ror::Matrix4f current = pose.m_worlds[skeleton.m_sorted_index[i]] * shape;
+		for (uint32_t j = 0; j < 16; ++j)
+			error = std::max(error, std::fabs(legacy[i].m_values[j] - current.m_values[j]));
+	}
+
+	std::printf("%s, %u, legacy difference %g\n", a_name, a_nodes_count, static_cast<double>(error));
+
+	Measurement baseline = measure(a_nodes_count, a_joints_per_run, [&]() {
+		sink = sink + ror::get_world_matrices_for_skinning(a_tree, static_cast<int>(a_nodes_count), keyframe, delta_time).back().m_values[12];
+	});
+	report(a_name, a_nodes_count, "get_world_matrices_for_skinning", baseline, baseline.m_nanoseconds_per_joint);
+
+	report(a_name, a_nodes_count, "get_animated_transform", measure(a_nodes_count, a_joints_per_run, [&]() {
+		       for (uint32_t i = 0; i < a_nodes_count; ++i)
+			       sink = sink + ror::get_animated_transform(a_tree, static_cast<int>(i), keyframe, delta_time).m_values[12];
+	       }),
+	       baseline.m_nanoseconds_per_joint);
+
+	report(a_name, a_nodes_count, "get_ror_matrix4", measure(a_nodes_count, a_joints_per_run, [&]() {
+		       for (uint32_t i = 0; i < a_nodes_count; ++i)
+			       sink = sink + ror::get_ror_matrix4(a_tree[i].m_transform).m_values[12];
+	       }),
+	       baseline.m_nanoseconds_per_joint);
+
+	std::vector<ror::Matrix4f> from(a_nodes_count), to(a_nodes_count);
+	for (uint32_t i = 0; i < a_nodes_count; ++i)
+	{
+		from[i] = ror::get_ror_matrix4(a_tree[i].m_transform);
+		to[i]   = ror::get_ror_matrix4(a_tree[i].m_inverse);
+	}
+
+	report(a_name, a_nodes_count, "matrix4_interpolate", measure(a_nodes_count, a_joints_per_run, [&]() {
+		       for (uint32_t i = 0; i < a_nodes_count; ++i)
+			       sink = sink + ror::matrix4_interpolate(from[i], to[i], 0.5f).m_values[12];
+	       }),
+	       baseline.m_nanoseconds_per_joint);
+
+	report(a_name, a_nodes_count, "evaluate_pose", measure(a_nodes_count, a_joints_per_run, [&]() {
+		       ror::evaluate_pose(skeleton, clip, keyframe, delta_time, pose);
+		       sink = sink + pose.m_palette.back().m_values[12];
+	       }),
+	       baseline.m_nanoseconds_per_joint);
+
+	report(a_name, a_nodes_count, "evaluate_pose_compressed", measure(a_nodes_count, a_joints_per_run, [&]() {
+		       ror::evaluate_pose(skeleton, view, keyframe, delta_time, pose);
+		       sink = sink + pose.m_palette.back().m_values[12];
+	       }),
+	       baseline.m_nanoseconds_per_joint);
+
+	// Same locals every time, isolates the hierarchy multiply
+	report(a_name, a_nodes_count, "update_worlds", measure(a_nodes_count, a_joints_per_run, [&]() {
+		       ror::update_worlds(skeleton, pose);
+		       sink = sink + pose.m_worlds.back().m_values[12];
+	       }),
+	       baseline.m_nanoseconds_per_joint);
+}
+
+int main(int argc, char *argv[])
+{
+	uint64_t joints_per_run = argc > 1 ? std::stoull(argv[1]) : 4000000u;
+
+	std::printf("Matrix kernels: %s\n", ror::matrix_kernel_name(ror::matrix_kernel_best_path()));
+	std::printf("skeleton, joints, benchmark, ns/joint, allocations/call, speedup over legacy\n");
+
+	run("astro_boy", astro_boy_tree, astro_boy_nodes_count, joints_per_run);
+
+	// Legacy code reads tracks from the global astro boy map, synthetic tracks are swapped in and out
+	std::map<int, std::vector<ColladaMatrix>> astro_boy_tracks;
+	std::swap(astro_boy_tracks, astro_boy_animation_keyframe_matrices);
+
+	for (uint32_t joints = 64; joints <= 1024; joints *= 2)
+	{
+		std::vector<AstroBoyTree> tree;
+		synthetic_skeleton(joints, tree, astro_boy_animation_keyframe_matrices);
+		run("synthetic", tree.data(), joints, joints_per_run);
+	}
+
+	std::swap(astro_boy_tracks, astro_boy_animation_keyframe_matrices);
+
+	return EXIT_SUCCESS;
+}
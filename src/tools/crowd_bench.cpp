@@ -0,0 +1,195 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#include "animation/animation_asset.hpp"
+#include "animation/animation_system.hpp"
+#include "animation/skinning_kernels.hpp"
+#include "assets/astroboy/astro_boy_geometry.hpp"
+#include "threading/job_system.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures how crowd animation update scales with threads
+// Usage: CrowdBench [asset.vean] [instance_count] [frames]
+// Prints characters per millisecond for every thread count from 1 to hardware concurrency, then compares
+// full evaluation against the default LOD policy for a crowd spread around the camera.
+// Last the astro boy mesh is skinned on the CPU with every kernel path, each checked against the scalar reference
+
+int main(int argc, char *argv[])
+{
+	std::string asset_path     = argc > 1 ? argv[1] : "assets/astroboy/astro_boy.vean";
+	uint32_t    instance_count = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 1024u;
+	uint32_t    frames         = argc > 3 ? static_cast<uint32_t>(std::stoul(argv[3])) : 200u;
+
+	ror::AnimationAsset asset;
+	if (!asset.load(asset_path) || asset.clip_count() == 0)
+	{
+		std::cout << "Error! Can't load " << asset_path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<ror::CompressedClipView> clips;
+	for (uint32_t i = 0; i < asset.clip_count(); ++i)
+		clips.push_back(asset.clip(i));
+
+	const uint32_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+	const float    frame_delta = 1.0f / 60.0f;
+
+	std::cout << "Animating " << instance_count << " instances of " << asset.skeleton().joint_count() << " joints for " << frames << " frames" << std::endl;
+	std::cout << "threads, characters/ms, speedup" << std::endl;
+
+	// Thread scaling is measured on full evaluations, sharing would hide most of the work
+	ror::AnimationLodPolicy full_policy;
+	full_policy.m_share_quantum = 0.0f;
+
+	double single_thread_rate = 0.0;
+
+	for (uint32_t threads = 1; threads <= max_threads; ++threads)
+	{
+		utl::JobSystem       job_system{threads};
+		ror::AnimationSystem system{asset.skeleton(), clips, job_system};
+		system.set_lod_policy(full_policy);
+
+		// Spread start times so instances don't all sample the same keys
+		for (uint32_t i = 0; i < instance_count; ++i)
+			system.add_instance(i % asset.clip_count(), static_cast<float>(i) * 0.013f);
+
+		for (uint32_t i = 0; i < 10; ++i)
+			system.update(frame_delta);
+
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < frames; ++i)
+			system.update(frame_delta);
+		auto end = std::chrono::steady_clock::now();
+
+		double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+		double rate         = static_cast<double>(instance_count) * frames / milliseconds;
+
+		if (threads == 1)
+			single_thread_rate = rate;
+
+		std::cout << threads << ", " << rate << ", " << rate / single_thread_rate << std::endl;
+	}
+
+	// Same crowd scattered on a disc around a camera with a 60 degree vertical field of view looking down +x.
+	// Characters are 2 units tall, anything outside the horizontal field of view is invisible
+	const float tan_half_fov = std::tan(0.5236f);
+	const float crowd_radius = 150.0f;
+
+	std::cout << "lod, characters/ms, evaluations/frame, speedup" << std::endl;
+
+	double full_rate = 0.0;
+
+	for (bool use_lod : {false, true})
+	{
+		utl::JobSystem       job_system{max_threads};
+		ror::AnimationSystem system{asset.skeleton(), clips, job_system};
+
+		if (!use_lod)
+			system.set_lod_policy(full_policy);
+
+		for (uint32_t i = 0; i < instance_count; ++i)
+		{
+			system.add_instance(i % asset.clip_count(), static_cast<float>(i) * 0.013f);
+
+			// Golden angle spiral gives an even spread without a random generator
+			float distance = 2.0f + crowd_radius * std::sqrt((static_cast<float>(i) + 0.5f) / static_cast<float>(instance_count));
+			float angle    = std::fmod(static_cast<float>(i) * 2.39996f, 6.28319f) - 3.14159f;
+			bool  visible  = std::fabs(angle) < 0.7854f;
+
+			if (use_lod)
+				system.set_lod(i, ror::screen_size_from_sphere(1.0f, distance, tan_half_fov), visible);
+		}
+
+		uint64_t evaluations = 0;
+		for (uint32_t i = 0; i < 10; ++i)
+			system.update(frame_delta);
+
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < frames; ++i)
+		{
+			system.update(frame_delta);
+			evaluations += system.evaluation_count();
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+		double rate         = static_cast<double>(instance_count) * frames / milliseconds;
+
+		if (!use_lod)
+			full_rate = rate;
+
+		std::cout << (use_lod ? "on" : "off") << ", " << rate << ", " << static_cast<double>(evaluations) / frames << ", " << rate / full_rate << std::endl;
+	}
+
+	if (asset.skeleton().joint_count() < 44)
+		return EXIT_SUCCESS;        // Mesh joint ids are for the astro boy skeleton
+
+	std::cout << "skinning, vertices/ms, max error" << std::endl;
+
+	utl::JobSystem       job_system{max_threads};
+	ror::AnimationSystem system{asset.skeleton(), clips, job_system};
+	system.add_instance(0, 0.5f);
+	system.update(frame_delta);
+
+	ror::SkinningStreams   streams{astro_boy_positions, astro_boy_normals, astro_boy_weights, astro_boy_joints, astro_boy_vertex_count};
+	std::vector<float32_t> reference(astro_boy_vertex_count * 6), skinned(astro_boy_vertex_count * 6);
+
+	ror::skin_vertices_scalar(streams, system.palette(0), 0, astro_boy_vertex_count, reference.data());
+
+	std::vector<ror::MatrixKernelPath> paths{ror::MatrixKernelPath::scalar};
+	if (ror::matrix_kernel_best_path() == ror::MatrixKernelPath::avx2)
+		paths.push_back(ror::MatrixKernelPath::sse);
+	if (ror::matrix_kernel_best_path() != ror::MatrixKernelPath::scalar)
+		paths.push_back(ror::matrix_kernel_best_path());
+
+	for (auto path : paths)
+	{
+		ror::SkinningKernelFunction kernel = ror::skinning_kernel(path);
+
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < frames; ++i)
+			job_system.parallel_for(astro_boy_vertex_count, ror::skinning_grain, [&](uint32_t a_begin, uint32_t a_end, uint32_t) {
+				kernel(streams, system.palette(0), a_begin, a_end, skinned.data());
+			});
+		auto end = std::chrono::steady_clock::now();
+
+		float error = 0.0f;
+		for (size_t i = 0; i < skinned.size(); ++i)
+			error = std::max(error, std::fabs(skinned[i] - reference[i]));
+
+		double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+		std::cout << ror::matrix_kernel_name(path) << ", " << static_cast<double>(astro_boy_vertex_count) * frames / milliseconds << ", " << error << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
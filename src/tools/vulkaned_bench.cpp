@@ -0,0 +1,274 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#include "vulkan/vulkan_rhi.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#	include <sys/resource.h>
+#	include <sys/wait.h>
+#	include <unistd.h>
+#endif
+
+// Runs scripted scenes headless and reports frame times as JSON so builds can be compared
+// Usage: vulkaned_bench [frames] [output.json]
+// Every scenario creates its own context, startup is the time to construct it, the first frames in flight
+// are left out of the frame times. GPU time is skinning plus graphics from timestamp queries, 0 if unsupported.
+// Where fork is available every scenario runs in its own process so peak host memory is its own.
+// JSON goes to vulkaned_bench.json by default so it doesn't mix with the log on stdout.
+// glTF scenes aren't drawn yet, add a scenario for them once they are or it only measures the astro boy again.
+
+struct Scenario
+{
+	std::string        m_name;
+	vkd::SceneSettings m_settings;
+};
+
+struct Statistics
+{
+	double m_mean{0.0};
+	double m_p50{0.0};
+	double m_p95{0.0};
+	double m_p99{0.0};
+};
+
+// Nearest rank percentiles, samples are sorted in place
+static Statistics statistics(std::vector<double> &a_samples)
+{
+	Statistics result;
+
+	if (a_samples.empty())
+		return result;
+
+	std::sort(a_samples.begin(), a_samples.end());
+
+	auto percentile = [&a_samples](double a_percent) {
+		size_t rank = static_cast<size_t>(std::ceil(a_percent / 100.0 * static_cast<double>(a_samples.size())));
+		return a_samples[std::min(std::max(rank, size_t{1}), a_samples.size()) - 1];
+	};
+
+	double sum = 0.0;
+	for (double sample : a_samples)
+		sum += sample;
+
+	result.m_mean = sum / static_cast<double>(a_samples.size());
+	result.m_p50  = percentile(50.0);
+	result.m_p95  = percentile(95.0);
+	result.m_p99  = percentile(99.0);
+
+	return result;
+}
+
+// High water mark of the calling process, only per scenario when each one runs in its own process
+static uint64_t peak_host_memory()
+{
+#if defined(__linux__) || defined(__APPLE__)
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+#	if defined(__APPLE__)
+	return static_cast<uint64_t>(usage.ru_maxrss);
+#	else
+	return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#	endif
+#else
+	return 0;
+#endif
+}
+
+static void write_statistics(std::ostream &a_out, const char *a_name, const Statistics &a_statistics)
+{
+	a_out << "      \"" << a_name << "\": {\"mean\": " << a_statistics.m_mean << ", \"p50\": " << a_statistics.m_p50
+	      << ", \"p95\": " << a_statistics.m_p95 << ", \"p99\": " << a_statistics.m_p99 << "},\n";
+}
+
+// Renders a_scenario and writes its JSON object to a_out, returns false if it threw
+static bool run_scenario(const Scenario &a_scenario, uint32_t a_frames, std::ostream &a_out)
+{
+	const uint32_t warmup_frames = cfg::get_number_of_buffers() * 2;        // Gets GPU time and caches going before measuring
+
+	try
+	{
+		std::vector<double> cpu_times;
+		std::vector<double> gpu_times;
+		cpu_times.reserve(a_frames);
+		gpu_times.reserve(a_frames);
+
+		auto          startup_begin = std::chrono::steady_clock::now();
+		vkd::Context *context       = new vkd::Context(nullptr, a_scenario.m_settings);
+		auto          startup_end   = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < warmup_frames; ++i)
+			context->draw_frame(true);
+
+		for (uint32_t i = 0; i < a_frames; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			context->draw_frame(true);
+			auto end = std::chrono::steady_clock::now();
+
+			cpu_times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+
+			// Belongs to the frame that last used this image, a few frames behind but the same distribution
+			if (context->gpu_frame_time() > 0.0)
+				gpu_times.push_back(context->gpu_frame_time());
+		}
+
+		context->wait_idle();
+
+		VkDeviceSize device_memory = context->device_memory_peak();
+		delete context;
+
+		a_out << std::fixed << std::setprecision(3);
+		a_out << "    {\n";
+		a_out << "      \"name\": \"" << a_scenario.m_name << "\",\n";
+		a_out << "      \"crowd_size\": " << a_scenario.m_settings.m_crowd_size << ",\n";
+		a_out << "      \"startup_ms\": " << std::chrono::duration<double, std::milli>(startup_end - startup_begin).count() << ",\n";
+		write_statistics(a_out, "cpu_frame_ms", statistics(cpu_times));
+		write_statistics(a_out, "gpu_frame_ms", statistics(gpu_times));
+		a_out << "      \"peak_device_memory_bytes\": " << device_memory << ",\n";
+		a_out << "      \"peak_host_memory_bytes\": " << peak_host_memory() << "\n";
+		a_out << "    }";
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << a_scenario.m_name << ": " << e.what() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Runs a_scenario in a child process and collects its JSON through a pipe, the parent never creates a context
+// so the child's peak memory doesn't include earlier scenarios
+static bool run_isolated(const Scenario &a_scenario, uint32_t a_frames, std::string &a_json)
+{
+#if defined(__linux__) || defined(__APPLE__)
+	int pipe_fds[2];
+	if (pipe(pipe_fds) != 0)
+		return false;
+
+	// Buffered output would otherwise be written by both processes
+	std::cout.flush();
+	std::fflush(nullptr);
+
+	pid_t child = fork();
+	if (child < 0)
+	{
+		close(pipe_fds[0]);
+		close(pipe_fds[1]);
+		return false;
+	}
+
+	if (child == 0)
+	{
+		close(pipe_fds[0]);
+
+		std::ostringstream json;
+		bool               result = run_scenario(a_scenario, a_frames, json);
+		std::string        text   = json.str();
+
+		for (size_t written = 0; written < text.size();)
+		{
+			ssize_t count = write(pipe_fds[1], text.data() + written, text.size() - written);
+			if (count <= 0)
+				break;
+			written += static_cast<size_t>(count);
+		}
+
+		close(pipe_fds[1]);
+		std::cout.flush();
+		std::fflush(nullptr);
+		_exit(result ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	close(pipe_fds[1]);
+
+	char    buffer[4096];
+	ssize_t count;
+	while ((count = read(pipe_fds[0], buffer, sizeof(buffer))) > 0)
+		a_json.append(buffer, static_cast<size_t>(count));
+
+	close(pipe_fds[0]);
+
+	int status = 0;
+	waitpid(child, &status, 0);
+
+	return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+#else
+	std::ostringstream json;
+	bool               result = run_scenario(a_scenario, a_frames, json);
+	a_json                    = json.str();
+
+	return result;
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t    frames      = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 500u;
+	std::string output_path = argc > 2 ? argv[2] : "vulkaned_bench.json";
+
+	std::vector<Scenario> scenarios{
+	    {"astro_boy", {1, ""}},
+	    {"astro_boy_crowd_1k", {1000, ""}}};
+
+	std::ofstream out{output_path};
+	if (!out)
+	{
+		std::cerr << "Can't open " << output_path << " for writing" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	out << "{\n  \"frames\": " << frames << ",\n  \"scenarios\": [\n";
+
+	for (size_t s = 0; s < scenarios.size(); ++s)
+	{
+		std::string json;
+		if (!run_isolated(scenarios[s], frames, json))
+		{
+			std::cerr << "Scenario " << scenarios[s].m_name << " failed" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		out << json << (s + 1 < scenarios.size() ? "," : "") << "\n";
+	}
+
+	out << "  ]\n}\n";
+
+	std::cout << "Benchmark results written to " << output_path << std::endl;
+
+	return EXIT_SUCCESS;
+}
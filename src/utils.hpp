@@ -202,6 +202,21 @@ inline VkFormat basis_to_vk_format(basist::transcoder_texture_format a_fmt)
 	return VK_FORMAT_B8G8R8A8_SRGB;
 }
 
+// Texel rows per row of blocks, 1 for uncompressed formats, covers what basis_to_vk_format() returns
+inline uint32_t format_block_height(VkFormat a_format)
+{
+	switch (a_format)
+	{
+		case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+			return 4;
+		default:
+			return 1;
+	}
+}
+
 inline TextureImage read_texture_from_file(const char *a_file_name)
 {
 	std::filesystem::path file_name{a_file_name};
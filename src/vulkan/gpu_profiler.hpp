@@ -0,0 +1,314 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "common.hpp"
+#include "config.hpp"
+#include "profiling/rorlog.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*  GpuProfiler usage
+ *  Brackets GPU work with timestamp queries. add_scope() names a scope once and returns its id, at most 64 scopes.
+ *  Every frame in flight owns a slot of queries. Command buffers recorded for a slot call reset() for the scopes
+ *  they write outside of render passes, then begin() and end() around the work which can be inside a render pass.
+ *  Call submitted() after the slot is submitted and resolve() once its fence has signalled, that reads the results
+ *  without waiting, scopes not written or not available yet are skipped so it never stalls.
+ *  Ticks become milliseconds with timestampPeriod. With VK_EXT_calibrated_timestamps and a CLOCK_MONOTONIC host
+ *  domain each resolve also maps GPU ticks onto std::chrono::steady_clock, so scopes line up with CPU profiling.
+ *  immediate_slot() is an extra slot for single use submits like uploads that are waited on anyway.
+ */
+
+namespace vkd
+{
+constexpr uint32_t gpu_profiler_max_scopes = 64;
+
+struct GpuScopeTiming
+{
+	uint32_t m_scope{0};                   // Id from add_scope()
+	double   m_milliseconds{0.0};          // End minus begin
+	int64_t  m_cpu_begin{0};               // Begin in steady_clock nanoseconds, 0 without calibrated timestamps
+};
+
+class GpuProfiler final
+{
+  public:
+	FORCE_INLINE              GpuProfiler()                               = default;        //! Default constructor
+	FORCE_INLINE              GpuProfiler(const GpuProfiler &a_other)     = delete;         //! Copy constructor
+	FORCE_INLINE              GpuProfiler(GpuProfiler &&a_other) noexcept = delete;         //! Move constructor
+	FORCE_INLINE GpuProfiler &operator=(const GpuProfiler &a_other)       = delete;         //! Copy assignment operator
+	FORCE_INLINE GpuProfiler &operator=(GpuProfiler &&a_other) noexcept   = delete;         //! Move assignment operator
+	FORCE_INLINE ~GpuProfiler() noexcept                                  = default;        //! Destructor, call destroy() before the device goes
+
+	// a_valid_bits is timestampValidBits of the queues written from, 0 disables profiling
+	void create(VkInstance a_instance, VkPhysicalDevice a_physical_device, VkDevice a_device, uint32_t a_frames, uint32_t a_valid_bits, bool a_calibrated)
+	{
+		if (a_valid_bits == 0)
+		{
+			ror::log_critical("Timestamp queries not supported, GPU profiling disabled");
+			return;
+		}
+
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(a_physical_device, &properties);
+
+		this->m_device    = a_device;
+		this->m_slots     = a_frames + 1;
+		this->m_period    = static_cast<double>(properties.limits.timestampPeriod);
+		this->m_tick_mask = a_valid_bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << a_valid_bits) - 1;
+		this->m_written.assign(this->m_slots, 0);
+		this->m_pending.assign(this->m_slots, false);
+		this->m_timings.resize(this->m_slots);
+
+		VkQueryPoolCreateInfo query_pool_info{};
+		query_pool_info.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		query_pool_info.pNext      = nullptr;
+		query_pool_info.flags      = 0;
+		query_pool_info.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+		query_pool_info.queryCount = this->m_slots * gpu_profiler_max_scopes * 2;
+
+		VkResult result = vkCreateQueryPool(a_device, &query_pool_info, cfg::VkAllocator, &this->m_query_pool);
+		assert(result == VK_SUCCESS && "Failed to create timestamp query pool!");
+
+		if (a_calibrated)
+			this->create_calibration(a_instance, a_physical_device);
+	}
+
+	void destroy()
+	{
+		if (this->m_query_pool)
+			vkDestroyQueryPool(this->m_device, this->m_query_pool, cfg::VkAllocator);
+
+		this->m_query_pool = nullptr;
+	}
+
+	bool enabled() const
+	{
+		return this->m_query_pool != nullptr;
+	}
+
+	bool calibrated() const
+	{
+		return this->m_get_calibrated_timestamps != nullptr;
+	}
+
+	uint32_t immediate_slot() const
+	{
+		return this->m_slots - 1;
+	}
+
+	uint32_t add_scope(std::string a_name)
+	{
+		assert(this->m_names.size() < gpu_profiler_max_scopes && "Too many GPU profiler scopes");
+
+		this->m_names.emplace_back(std::move(a_name));
+		this->m_milliseconds.push_back(0.0);
+
+		return static_cast<uint32_t>(this->m_names.size() - 1);
+	}
+
+	const std::string &scope_name(uint32_t a_scope) const
+	{
+		return this->m_names[a_scope];
+	}
+
+	// Has to be outside of a render pass, before begin() of the same scopes
+	void reset(VkCommandBuffer a_command_buffer, uint32_t a_slot, uint32_t a_first_scope, uint32_t a_count)
+	{
+		if (!this->m_query_pool)
+			return;
+
+		vkCmdResetQueryPool(a_command_buffer, this->m_query_pool, this->query(a_slot, a_first_scope), a_count * 2);
+	}
+
+	void begin(VkCommandBuffer a_command_buffer, uint32_t a_slot, uint32_t a_scope)
+	{
+		if (!this->m_query_pool)
+			return;
+
+		this->m_written[a_slot] |= uint64_t{1} << a_scope;
+		vkCmdWriteTimestamp(a_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, this->m_query_pool, this->query(a_slot, a_scope));
+	}
+
+	void end(VkCommandBuffer a_command_buffer, uint32_t a_slot, uint32_t a_scope)
+	{
+		if (!this->m_query_pool)
+			return;
+
+		vkCmdWriteTimestamp(a_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, this->m_query_pool, this->query(a_slot, a_scope) + 1);
+	}
+
+	void submitted(uint32_t a_slot)
+	{
+		if (this->m_query_pool)
+			this->m_pending[a_slot] = true;
+	}
+
+	// Call once the last submit of a_slot has finished, returns false if nothing was resolved
+	bool resolve(uint32_t a_slot)
+	{
+		if (!this->m_query_pool || !this->m_pending[a_slot])
+			return false;
+
+		std::vector<GpuScopeTiming> &timings = this->m_timings[a_slot];
+
+		this->m_pending[a_slot] = false;
+		timings.clear();
+
+		uint64_t gpu_reference{0};
+		int64_t  cpu_reference{0};
+		bool     calibrated = this->calibrate(gpu_reference, cpu_reference);
+
+		for (uint32_t scope = 0; scope < this->m_names.size(); ++scope)
+		{
+			if (!(this->m_written[a_slot] & (uint64_t{1} << scope)))
+				continue;
+
+			uint64_t results[4];        // Begin, available, end, available
+			VkResult result = vkGetQueryPoolResults(this->m_device, this->m_query_pool, this->query(a_slot, scope), 2, sizeof(results), results,
+			                                        sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+			if ((result != VK_SUCCESS && result != VK_NOT_READY) || !results[1] || !results[3])
+				continue;
+
+			GpuScopeTiming timing;
+			timing.m_scope        = scope;
+			timing.m_milliseconds = static_cast<double>((results[2] - results[0]) & this->m_tick_mask) * this->m_period * 1e-6;
+
+			if (calibrated)
+				timing.m_cpu_begin = cpu_reference - static_cast<int64_t>(static_cast<double>((gpu_reference - results[0]) & this->m_tick_mask) * this->m_period);
+
+			this->m_milliseconds[scope] = timing.m_milliseconds;
+			timings.push_back(timing);
+		}
+
+		if (cfg::get_gpu_profiler_log() && !timings.empty())
+			this->log(timings);
+
+		return !timings.empty();
+	}
+
+	// Scopes of the last resolve() of a_slot in scope order
+	const std::vector<GpuScopeTiming> &timings(uint32_t a_slot) const
+	{
+		return this->m_timings[a_slot];
+	}
+
+	// Last resolved time of a_scope, stays until the scope resolves again
+	double milliseconds(uint32_t a_scope) const
+	{
+		return this->m_milliseconds[a_scope];
+	}
+
+  private:
+	uint32_t query(uint32_t a_slot, uint32_t a_scope) const
+	{
+		assert(a_slot < this->m_slots && a_scope < this->m_names.size() && "GPU profiler slot or scope out of range");
+		return (a_slot * gpu_profiler_max_scopes + a_scope) * 2;
+	}
+
+	// steady_clock is CLOCK_MONOTONIC on the platforms that expose it as a time domain, others stay uncalibrated
+	void create_calibration(VkInstance a_instance, VkPhysicalDevice a_physical_device)
+	{
+#if defined(__linux__) || defined(__ANDROID__)
+		auto get_time_domains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(vkGetInstanceProcAddr(a_instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+		auto get_timestamps   = reinterpret_cast<PFN_vkGetCalibratedTimestampsEXT>(vkGetDeviceProcAddr(this->m_device, "vkGetCalibratedTimestampsEXT"));
+
+		if (!get_time_domains || !get_timestamps)
+			return;
+
+		uint32_t count{0};
+		get_time_domains(a_physical_device, &count, nullptr);
+		std::vector<VkTimeDomainEXT> domains(count);
+		get_time_domains(a_physical_device, &count, domains.data());
+
+		bool device    = std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end();
+		bool monotonic = std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT) != domains.end();
+
+		if (device && monotonic)
+			this->m_get_calibrated_timestamps = get_timestamps;
+#else
+		(void) a_instance;
+		(void) a_physical_device;
+#endif
+	}
+
+	bool calibrate(uint64_t &a_gpu, int64_t &a_cpu) const
+	{
+		if (!this->m_get_calibrated_timestamps)
+			return false;
+
+		VkCalibratedTimestampInfoEXT infos[2]{};
+		infos[0].sType      = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+		infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+		infos[1].sType      = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+		infos[1].timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+
+		uint64_t timestamps[2];
+		uint64_t deviation{0};
+
+		if (this->m_get_calibrated_timestamps(this->m_device, 2, infos, timestamps, &deviation) != VK_SUCCESS)
+			return false;
+
+		a_gpu = timestamps[0];
+		a_cpu = static_cast<int64_t>(timestamps[1]);
+
+		return true;
+	}
+
+	void log(const std::vector<GpuScopeTiming> &a_timings) const
+	{
+		std::string line;
+		char        entry[128];
+
+		for (const auto &timing : a_timings)
+		{
+			std::snprintf(entry, sizeof(entry), "%s%s %.3f ms", line.empty() ? "" : ", ", this->m_names[timing.m_scope].c_str(), timing.m_milliseconds);
+			line.append(entry);
+		}
+
+		ror::log_info("GPU: {}", line);
+	}
+
+	VkDevice                                 m_device{nullptr};
+	VkQueryPool                              m_query_pool{nullptr};                       // gpu_profiler_max_scopes begin and end pairs per slot
+	uint32_t                                 m_slots{0};                                  // Frames in flight plus the immediate slot
+	double                                   m_period{1.0};                               // Nanoseconds per tick
+	uint64_t                                 m_tick_mask{~uint64_t{0}};                   // Valid timestamp bits, differences wrap within these
+	std::vector<uint64_t>                    m_written{};                                 // Scopes begun per slot, only these are resolved
+	std::vector<bool>                        m_pending{};                                 // Slot was submitted since its last resolve
+	std::vector<std::string>                 m_names{};                                   // Scope names by id
+	std::vector<double>                      m_milliseconds{};                            // Last resolved time by scope id
+	std::vector<std::vector<GpuScopeTiming>> m_timings{};                                 // Scopes of the last resolve per slot
+	PFN_vkGetCalibratedTimestampsEXT         m_get_calibrated_timestamps{nullptr};        // Set if device and CLOCK_MONOTONIC domains are calibrateable
+};
+
+}        // namespace vkd
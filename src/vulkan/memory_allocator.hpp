@@ -0,0 +1,402 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "common.hpp"
+#include "config.hpp"
+#include "memory/tlsf_allocator.hpp"
+#include "profiling/rorlog.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/*  MemoryAllocator usage
+ *  Sub-allocates buffers and images from big VkDeviceMemory blocks instead of one vkAllocateMemory per
+ *  resource, drivers cap allocation counts (maxMemoryAllocationCount, often 4096) and each one is slow.
+ *  Blocks are allocated per memory type on demand, cfg::get_memory_block_size() each or an eighth of
+ *  small heaps, and carved up by a TlsfAllocator. Buffers and optimal images never share a block when
+ *  bufferImageGranularity is above 1, so they can't end up on the same granularity page.
+ *  Resources the driver wants dedicated, render targets asked for as dedicated and anything bigger than
+ *  half a block get their own VkMemoryDedicatedAllocateInfo allocation instead.
+ *  Host visible blocks are mapped once when created, MemoryAllocation::mapped() points at the allocation
+ *  so callers never vkMapMemory memory other allocations live in.
+ *  Not thread safe, allocate and free from the thread that owns the device.
+ */
+
+namespace vkd
+{
+enum class MemoryUsage : uint32_t
+{
+	linear,        // Buffers, can't share a granularity page with optimal images
+	optimal        // Optimally tiled images
+};
+
+struct MemoryAllocation
+{
+	static constexpr uint32_t dedicated = ~0u;
+
+	template <class _type>
+	_type *mapped() const
+	{
+		assert(this->m_mapped && "Allocation isn't host visible");
+		return static_cast<_type *>(this->m_mapped);
+	}
+
+	VkDeviceMemory m_memory{VK_NULL_HANDLE};                           // Shared with other allocations unless m_block is dedicated
+	VkDeviceSize   m_offset{0};                                        // Bind at this offset
+	VkDeviceSize   m_size{0};
+	void          *m_mapped{nullptr};                                  // Host pointer at m_offset, nullptr if not host visible
+	uint32_t       m_block{dedicated};                                 // Index of the block or dedicated
+	uint32_t       m_handle{utl::TlsfAllocator::invalid_handle};        // Frees the range in the block
+};
+
+struct MemoryStatistics
+{
+	uint32_t     m_block_count{0};                  // Live blocks
+	uint32_t     m_dedicated_count{0};              // Live dedicated allocations
+	uint32_t     m_allocation_count{0};             // Live allocations in blocks and dedicated
+	VkDeviceSize m_allocated_bytes{0};              // Device memory held in blocks and dedicated allocations
+	VkDeviceSize m_used_bytes{0};                   // Bytes of that given out to resources
+	VkDeviceSize m_peak_allocated_bytes{0};         // Most m_allocated_bytes since create()
+};
+
+class MemoryAllocator final
+{
+  public:
+	FORCE_INLINE                  MemoryAllocator()                                   = default;        //! Default constructor
+	FORCE_INLINE                  MemoryAllocator(const MemoryAllocator &a_other)     = delete;         //! Copy constructor
+	FORCE_INLINE                  MemoryAllocator(MemoryAllocator &&a_other) noexcept = delete;         //! Move constructor
+	FORCE_INLINE MemoryAllocator &operator=(const MemoryAllocator &a_other)           = delete;         //! Copy assignment operator
+	FORCE_INLINE MemoryAllocator &operator=(MemoryAllocator &&a_other) noexcept       = delete;         //! Move assignment operator
+	FORCE_INLINE ~MemoryAllocator() noexcept                                          = default;        //! Destructor, call destroy() before the device goes
+
+	void create(VkPhysicalDevice a_physical_device, VkDevice a_device)
+	{
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(a_physical_device, &properties);
+		vkGetPhysicalDeviceMemoryProperties(a_physical_device, &this->m_memory_properties);
+
+		this->m_device                  = a_device;
+		this->m_granularity             = properties.limits.bufferImageGranularity;
+		this->m_max_device_allocations  = properties.limits.maxMemoryAllocationCount;
+		this->m_device_allocation_count = 0;
+	}
+
+	void destroy()
+	{
+		if (this->m_statistics.m_allocation_count > 0)
+			ror::log_critical("{} device memory allocations still alive at shutdown", this->m_statistics.m_allocation_count);
+
+		for (auto &block : this->m_blocks)
+			if (block.m_memory)
+				this->free_device_memory(block.m_memory, block.m_tlsf.size());
+
+		this->m_blocks.clear();
+		this->m_statistics.m_block_count = 0;
+	}
+
+	MemoryAllocation allocate_buffer(VkBuffer a_buffer, VkMemoryPropertyFlags a_properties)
+	{
+		VkBufferMemoryRequirementsInfo2 info{};
+		info.sType  = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+		info.buffer = a_buffer;
+
+		VkMemoryDedicatedRequirements dedicated_requirements{};
+		dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+		VkMemoryRequirements2 requirements{};
+		requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+		requirements.pNext = &dedicated_requirements;
+
+		vkGetBufferMemoryRequirements2(this->m_device, &info, &requirements);
+
+		VkMemoryDedicatedAllocateInfo dedicated_info{};
+		dedicated_info.sType  = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+		dedicated_info.buffer = a_buffer;
+
+		bool dedicated = dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation;
+
+		return this->allocate(requirements.memoryRequirements, a_properties, MemoryUsage::linear, dedicated, dedicated_info);
+	}
+
+	// a_dedicated asks for an allocation of its own, i.e. for render targets that are large and recreated on resize
+	MemoryAllocation allocate_image(VkImage a_image, VkMemoryPropertyFlags a_properties, bool a_dedicated = false)
+	{
+		VkImageMemoryRequirementsInfo2 info{};
+		info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+		info.image = a_image;
+
+		VkMemoryDedicatedRequirements dedicated_requirements{};
+		dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+		VkMemoryRequirements2 requirements{};
+		requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+		requirements.pNext = &dedicated_requirements;
+
+		vkGetImageMemoryRequirements2(this->m_device, &info, &requirements);
+
+		VkMemoryDedicatedAllocateInfo dedicated_info{};
+		dedicated_info.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+		dedicated_info.image = a_image;
+
+		bool dedicated = a_dedicated || dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation;
+
+		// All images in this renderer are optimally tiled
+		return this->allocate(requirements.memoryRequirements, a_properties, MemoryUsage::optimal, dedicated, dedicated_info);
+	}
+
+	// Resets a_allocation, freeing an empty allocation does nothing
+	void free(MemoryAllocation &a_allocation)
+	{
+		if (!a_allocation.m_memory)
+			return;
+
+		this->m_statistics.m_allocation_count--;
+		this->m_statistics.m_used_bytes -= a_allocation.m_size;
+
+		if (a_allocation.m_block == MemoryAllocation::dedicated)
+		{
+			this->m_statistics.m_dedicated_count--;
+			this->free_device_memory(a_allocation.m_memory, a_allocation.m_size);
+		}
+		else
+		{
+			Block &block = this->m_blocks[a_allocation.m_block];
+			block.m_tlsf.free(a_allocation.m_handle);
+
+			// Keep one empty block per pool around so short lived resources like staging buffers don't churn blocks
+			if (block.m_tlsf.empty() && this->pool_block_count(block.m_type, block.m_usage) > 1)
+			{
+				this->free_device_memory(block.m_memory, block.m_tlsf.size());
+				this->m_statistics.m_block_count--;
+				block = Block{};
+			}
+		}
+
+		a_allocation = MemoryAllocation{};
+	}
+
+	const MemoryStatistics &statistics() const
+	{
+		return this->m_statistics;
+	}
+
+	void log_statistics() const
+	{
+		const MemoryStatistics &statistics = this->m_statistics;
+
+		ror::log_info("Device memory: {} allocations in {} blocks and {} dedicated, {} of {} bytes used, peak {} bytes",
+		              statistics.m_allocation_count, statistics.m_block_count, statistics.m_dedicated_count,
+		              statistics.m_used_bytes, statistics.m_allocated_bytes, statistics.m_peak_allocated_bytes);
+	}
+
+  private:
+	struct Block
+	{
+		VkDeviceMemory     m_memory{VK_NULL_HANDLE};           // VK_NULL_HANDLE if the slot is unused
+		std::byte         *m_mapped{nullptr};                  // Whole block mapped, nullptr if not host visible
+		uint32_t           m_type{0};                          // Memory type index
+		MemoryUsage        m_usage{MemoryUsage::linear};        // Resources in this block
+		utl::TlsfAllocator m_tlsf{};                           // Ranges of the block in use
+	};
+
+	MemoryAllocation allocate(const VkMemoryRequirements &a_requirements, VkMemoryPropertyFlags a_properties, MemoryUsage a_usage, bool a_dedicated, const VkMemoryDedicatedAllocateInfo &a_dedicated_info)
+	{
+		uint32_t     type       = this->find_memory_type(a_requirements.memoryTypeBits, a_properties);
+		VkDeviceSize block_size = this->block_size(type);
+
+		// Granularity only matters between linear and optimal resources, with 1 they can share blocks
+		if (this->m_granularity <= 1)
+			a_usage = MemoryUsage::linear;
+
+		MemoryAllocation allocation{};
+
+		if (a_dedicated || a_requirements.size > block_size / 2)
+		{
+			allocation.m_memory = this->allocate_device_memory(type, a_requirements.size, &a_dedicated_info);
+			allocation.m_size   = a_requirements.size;
+			allocation.m_mapped = this->map(type, allocation.m_memory);
+
+			this->m_statistics.m_dedicated_count++;
+		}
+		else
+		{
+			allocation.m_size = a_requirements.size;
+			this->allocate_from_blocks(type, a_usage, block_size, a_requirements.alignment, allocation);
+		}
+
+		this->m_statistics.m_allocation_count++;
+		this->m_statistics.m_used_bytes += allocation.m_size;
+
+		return allocation;
+	}
+
+	void allocate_from_blocks(uint32_t a_type, MemoryUsage a_usage, VkDeviceSize a_block_size, VkDeviceSize a_alignment, MemoryAllocation &a_allocation)
+	{
+		uint32_t     block_index = MemoryAllocation::dedicated;
+		VkDeviceSize offset{0};
+		uint32_t     handle{utl::TlsfAllocator::invalid_handle};
+
+		for (uint32_t i = 0; i < this->m_blocks.size(); ++i)
+		{
+			Block &block = this->m_blocks[i];
+			if (block.m_memory && block.m_type == a_type && block.m_usage == a_usage && block.m_tlsf.allocate(a_allocation.m_size, a_alignment, offset, handle))
+			{
+				block_index = i;
+				break;
+			}
+		}
+
+		if (block_index == MemoryAllocation::dedicated)
+		{
+			block_index  = this->create_block(a_type, a_usage, a_block_size);
+			Block &block = this->m_blocks[block_index];
+
+			bool result = block.m_tlsf.allocate(a_allocation.m_size, a_alignment, offset, handle);
+			assert(result && "Fresh memory block can't fit an allocation of less than half its size");
+			(void) result;
+		}
+
+		const Block &block = this->m_blocks[block_index];
+
+		a_allocation.m_memory = block.m_memory;
+		a_allocation.m_offset = offset;
+		a_allocation.m_mapped = block.m_mapped ? block.m_mapped + offset : nullptr;
+		a_allocation.m_block  = block_index;
+		a_allocation.m_handle = handle;
+	}
+
+	uint32_t create_block(uint32_t a_type, MemoryUsage a_usage, VkDeviceSize a_size)
+	{
+		Block block{};
+		block.m_memory = this->allocate_device_memory(a_type, a_size, nullptr);
+		block.m_mapped = static_cast<std::byte *>(this->map(a_type, block.m_memory));
+		block.m_type   = a_type;
+		block.m_usage  = a_usage;
+		block.m_tlsf   = utl::TlsfAllocator{a_size};
+
+		this->m_statistics.m_block_count++;
+
+		// Reuse a slot of a freed block so indices in live allocations stay valid
+		auto slot = std::find_if(this->m_blocks.begin(), this->m_blocks.end(), [](const Block &a_block) { return !a_block.m_memory; });
+		if (slot != this->m_blocks.end())
+		{
+			*slot = std::move(block);
+			return static_cast<uint32_t>(slot - this->m_blocks.begin());
+		}
+
+		this->m_blocks.emplace_back(std::move(block));
+
+		return static_cast<uint32_t>(this->m_blocks.size() - 1);
+	}
+
+	uint32_t pool_block_count(uint32_t a_type, MemoryUsage a_usage) const
+	{
+		return static_cast<uint32_t>(std::count_if(this->m_blocks.begin(), this->m_blocks.end(), [a_type, a_usage](const Block &a_block) {
+			return a_block.m_memory && a_block.m_type == a_type && a_block.m_usage == a_usage;
+		}));
+	}
+
+	VkDeviceMemory allocate_device_memory(uint32_t a_type, VkDeviceSize a_size, const VkMemoryDedicatedAllocateInfo *a_dedicated_info)
+	{
+		if (this->m_device_allocation_count >= this->m_max_device_allocations)
+			ror::log_critical("Device memory allocation count is at maxMemoryAllocationCount {}", this->m_max_device_allocations);
+
+		VkMemoryAllocateInfo allocation_info{};
+		allocation_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocation_info.pNext           = a_dedicated_info;
+		allocation_info.allocationSize  = a_size;
+		allocation_info.memoryTypeIndex = a_type;
+
+		VkDeviceMemory memory{VK_NULL_HANDLE};
+		VkResult       result = vkAllocateMemory(this->m_device, &allocation_info, cfg::VkAllocator, &memory);
+
+		if (result != VK_SUCCESS)
+			throw std::runtime_error("Failed to allocate vulkan device memory!");
+
+		this->m_device_allocation_count++;
+		this->m_statistics.m_allocated_bytes += a_size;
+		this->m_statistics.m_peak_allocated_bytes = std::max(this->m_statistics.m_peak_allocated_bytes, this->m_statistics.m_allocated_bytes);
+
+		return memory;
+	}
+
+	void free_device_memory(VkDeviceMemory a_memory, VkDeviceSize a_size)
+	{
+		vkFreeMemory(this->m_device, a_memory, cfg::VkAllocator);
+
+		this->m_device_allocation_count--;
+		this->m_statistics.m_allocated_bytes -= a_size;
+	}
+
+	void *map(uint32_t a_type, VkDeviceMemory a_memory)
+	{
+		if (!(this->m_memory_properties.memoryTypes[a_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+			return nullptr;
+
+		void    *mapped{nullptr};
+		VkResult result = vkMapMemory(this->m_device, a_memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+		assert(result == VK_SUCCESS && "Failed to map device memory!");
+		(void) result;
+
+		return mapped;
+	}
+
+	uint32_t find_memory_type(uint32_t a_type_filter, VkMemoryPropertyFlags a_properties) const
+	{
+		for (uint32_t i = 0; i < this->m_memory_properties.memoryTypeCount; i++)
+		{
+			if (a_type_filter & (1 << i) && ((this->m_memory_properties.memoryTypes[i].propertyFlags & a_properties) == a_properties))
+			{
+				return i;
+			}
+		}
+
+		throw std::runtime_error("Failed to find suitable memory type!");
+	}
+
+	// Small heaps, like the 256MB device local host visible one, would run out after a few blocks
+	VkDeviceSize block_size(uint32_t a_type) const
+	{
+		VkDeviceSize heap_size = this->m_memory_properties.memoryHeaps[this->m_memory_properties.memoryTypes[a_type].heapIndex].size;
+
+		return heap_size <= cfg::get_memory_small_heap_size() ? heap_size / 8 : cfg::get_memory_block_size();
+	}
+
+	VkDevice                         m_device{nullptr};
+	VkPhysicalDeviceMemoryProperties m_memory_properties{};
+	VkDeviceSize                     m_granularity{1};                     // bufferImageGranularity
+	uint32_t                         m_max_device_allocations{4096};       // maxMemoryAllocationCount
+	uint32_t                         m_device_allocation_count{0};         // vkAllocateMemory calls alive
+	std::vector<Block>               m_blocks{};                           // Indexed by MemoryAllocation::m_block, freed blocks leave empty slots
+	MemoryStatistics                 m_statistics{};
+};
+
+}        // namespace vkd
@@ -0,0 +1,181 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "common.hpp"
+#include "config.hpp"
+#include "vulkan/memory_allocator.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+/*  StagingPool usage
+ *  One persistently mapped host coherent buffer used as a ring for upload sources, so uploading doesn't create,
+ *  allocate and destroy a staging buffer every time. allocate() returns a region to memcpy into and copy from,
+ *  free() gives the oldest region back once the transfer reading it has retired, i.e. from TransferManager::release().
+ *  Regions are freed in the order they were allocated, which is the order batches retire in.
+ *  allocate() returns false if the ring is too full, flush and wait for uploads to retire then try again. Uploads
+ *  bigger than cfg::get_staging_chunk_size() should be split, so any size streams through a bounded footprint.
+ *  Not thread safe, same as MemoryAllocator.
+ */
+
+namespace vkd
+{
+struct StagingRegion
+{
+	VkBuffer     m_buffer{nullptr};        // Copy source, the pool's buffer
+	VkDeviceSize m_offset{0};              // Start of the region in m_buffer
+	VkDeviceSize m_size{0};
+	uint8_t     *m_data{nullptr};          // Host pointer to m_offset
+};
+
+class StagingPool final
+{
+  public:
+	FORCE_INLINE              StagingPool()                               = default;        //! Default constructor
+	FORCE_INLINE              StagingPool(const StagingPool &a_other)     = delete;         //! Copy constructor
+	FORCE_INLINE              StagingPool(StagingPool &&a_other) noexcept = delete;         //! Move constructor
+	FORCE_INLINE StagingPool &operator=(const StagingPool &a_other)       = delete;         //! Copy assignment operator
+	FORCE_INLINE StagingPool &operator=(StagingPool &&a_other) noexcept   = delete;         //! Move assignment operator
+	FORCE_INLINE ~StagingPool() noexcept                                  = default;        //! Destructor, call destroy() before the device goes
+
+	// Only the transfer queue reads the pool so the buffer is exclusive to its family
+	void create(VkDevice a_device, MemoryAllocator &a_allocator)
+	{
+		this->m_device = a_device;
+		this->m_size   = cfg::get_staging_pool_size();
+
+		VkBufferCreateInfo buffer_info{};
+		buffer_info.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_info.size        = this->m_size;
+		buffer_info.usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkResult result = vkCreateBuffer(a_device, &buffer_info, cfg::VkAllocator, &this->m_buffer);
+		assert(result == VK_SUCCESS && "Failed to create staging pool buffer!");
+
+		this->m_memory = a_allocator.allocate_buffer(this->m_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		result = vkBindBufferMemory(a_device, this->m_buffer, this->m_memory.m_memory, this->m_memory.m_offset);
+		assert(result == VK_SUCCESS && "Failed to bind staging pool memory!");
+	}
+
+	// Everything allocated must have been freed, or at least be done with on the GPU
+	void destroy(MemoryAllocator &a_allocator)
+	{
+		if (this->m_buffer)
+			vkDestroyBuffer(this->m_device, this->m_buffer, cfg::VkAllocator);
+
+		a_allocator.free(this->m_memory);
+		this->m_buffer = nullptr;
+		this->m_regions.clear();
+	}
+
+	// a_alignment has to be a power of two, false if there isn't room until older regions are freed
+	bool allocate(VkDeviceSize a_size, VkDeviceSize a_alignment, StagingRegion &a_region)
+	{
+		assert(a_size > 0 && a_size <= this->m_size && "Upload bigger than the staging pool, split it into chunks");
+
+		VkDeviceSize offset = 0;
+
+		if (!this->m_regions.empty())
+		{
+			const VkDeviceSize tail    = this->m_regions.front().first;
+			const VkDeviceSize head    = this->m_regions.back().second;
+			const bool         wrapped = this->m_regions.back().first < tail;        // Newest region is before the oldest
+
+			offset = (head + a_alignment - 1) & ~(a_alignment - 1);
+
+			if (wrapped)
+			{
+				if (offset + a_size > tail)
+					return false;
+			}
+			else if (offset + a_size > this->m_size)
+			{
+				// End of the buffer is skipped until the ring comes round again
+				if (a_size > tail)
+					return false;
+
+				offset = 0;
+			}
+		}
+
+		this->m_regions.emplace_back(offset, offset + a_size);
+		this->m_peak = std::max(this->m_peak, this->used());
+
+		a_region.m_buffer = this->m_buffer;
+		a_region.m_offset = offset;
+		a_region.m_size   = a_size;
+		a_region.m_data   = this->m_memory.mapped<uint8_t>() + offset;
+
+		return true;
+	}
+
+	// Gives the oldest region back, a_region is only used to check regions go back in order
+	void free(const StagingRegion &a_region)
+	{
+		assert(!this->m_regions.empty() && this->m_regions.front().first == a_region.m_offset && "Staging regions have to be freed oldest first");
+		(void) a_region;
+
+		this->m_regions.pop_front();
+	}
+
+	// Bytes between the oldest and newest region still in use, including any skipped end of the buffer
+	VkDeviceSize used() const
+	{
+		if (this->m_regions.empty())
+			return 0;
+
+		const VkDeviceSize tail = this->m_regions.front().first;
+		const VkDeviceSize head = this->m_regions.back().second;
+
+		return head > tail ? head - tail : this->m_size - tail + head;
+	}
+
+	VkDeviceSize size() const
+	{
+		return this->m_size;
+	}
+
+	VkDeviceSize peak() const
+	{
+		return this->m_peak;
+	}
+
+  private:
+	VkDevice                                          m_device{nullptr};
+	VkBuffer                                          m_buffer{nullptr};        // Mapped for the lifetime of the pool
+	MemoryAllocation                                  m_memory{};
+	VkDeviceSize                                      m_size{0};
+	VkDeviceSize                                      m_peak{0};                // Most of the ring ever in use
+	std::deque<std::pair<VkDeviceSize, VkDeviceSize>> m_regions{};              // Begin and end of regions in use, oldest first
+};
+
+}        // namespace vkd
@@ -0,0 +1,297 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "common.hpp"
+#include "config.hpp"
+#include "profiling/rorlog.hpp"
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/*  TransferManager usage
+ *  Batches uploads on the transfer queue instead of submitting and waiting idle for every copy. commands() returns
+ *  the command buffer of the open batch, starting one if there isn't, record copies and barriers into it and hand
+ *  staging resources to release(), they are released once the batch has finished on the GPU.
+ *  flush() submits the batch and signals the timeline semaphore() with the value it returns. Submits reading uploaded
+ *  resources wait on pending() if it isn't 0, that is only until retire() has seen the uploads finish, so uploads
+ *  never make the CPU wait and the GPU only waits in the first frames that use them.
+ *  retire() never blocks, it frees finished batches and runs their releases, call it once a frame.
+ *  Without timeline semaphores, core from 1.2 or VK_KHR_timeline_semaphore before, flush() waits on a fence
+ *  instead and nothing is ever pending.
+ *  Resources written here and read on another queue family need VK_SHARING_MODE_CONCURRENT, there is no ownership transfer.
+ */
+
+namespace vkd
+{
+class TransferManager final
+{
+  public:
+	FORCE_INLINE                  TransferManager()                                   = default;        //! Default constructor
+	FORCE_INLINE                  TransferManager(const TransferManager &a_other)     = delete;         //! Copy constructor
+	FORCE_INLINE                  TransferManager(TransferManager &&a_other) noexcept = delete;         //! Move constructor
+	FORCE_INLINE TransferManager &operator=(const TransferManager &a_other)           = delete;         //! Copy assignment operator
+	FORCE_INLINE TransferManager &operator=(TransferManager &&a_other) noexcept       = delete;         //! Move assignment operator
+	FORCE_INLINE ~TransferManager() noexcept                                          = default;        //! Destructor, call destroy() before the device goes
+
+	// a_command_pool must be from the family of a_queue and allow resetting or freeing command buffers
+	void create(VkDevice a_device, VkQueue a_queue, VkCommandPool a_command_pool, bool a_timeline)
+	{
+		this->m_device       = a_device;
+		this->m_queue        = a_queue;
+		this->m_command_pool = a_command_pool;
+
+		if (a_timeline)
+		{
+			this->m_get_counter_value = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(a_device, "vkGetSemaphoreCounterValueKHR"));
+			this->m_wait_semaphores   = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(a_device, "vkWaitSemaphoresKHR"));
+
+			// 1.2 devices may only have the core names when the extension isn't listed
+			if (!this->m_get_counter_value || !this->m_wait_semaphores)
+			{
+				this->m_get_counter_value = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(a_device, "vkGetSemaphoreCounterValue"));
+				this->m_wait_semaphores   = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(a_device, "vkWaitSemaphores"));
+			}
+		}
+
+		if (this->m_get_counter_value && this->m_wait_semaphores)
+		{
+			VkSemaphoreTypeCreateInfoKHR semaphore_type_info{};
+			semaphore_type_info.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+			semaphore_type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+			semaphore_type_info.initialValue  = 0;
+
+			VkSemaphoreCreateInfo semaphore_info{};
+			semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			semaphore_info.pNext = &semaphore_type_info;
+
+			VkResult result = vkCreateSemaphore(a_device, &semaphore_info, cfg::VkAllocator, &this->m_semaphore);
+			assert(result == VK_SUCCESS && "Failed to create upload timeline semaphore!");
+		}
+		else
+		{
+			ror::log_critical("Timeline semaphores not supported, uploads will wait on a fence");
+
+			VkFenceCreateInfo fence_info{};
+			fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+			VkResult result = vkCreateFence(a_device, &fence_info, cfg::VkAllocator, &this->m_fence);
+			assert(result == VK_SUCCESS && "Failed to create upload fence!");
+		}
+	}
+
+	// Waits for everything flushed, a batch still being recorded is dropped
+	void destroy()
+	{
+		// Flushed batches are older than the open one, their releases must run first
+		this->wait(this->m_flushed);
+		this->retire();
+
+		if (this->m_recording)
+		{
+			vkEndCommandBuffer(this->m_recording);
+			vkFreeCommandBuffers(this->m_device, this->m_command_pool, 1, &this->m_recording);
+			this->run_releases(this->m_recording_releases);
+			this->m_recording = nullptr;
+		}
+
+		if (this->m_semaphore)
+			vkDestroySemaphore(this->m_device, this->m_semaphore, cfg::VkAllocator);
+
+		if (this->m_fence)
+			vkDestroyFence(this->m_device, this->m_fence, cfg::VkAllocator);
+
+		this->m_semaphore = nullptr;
+		this->m_fence     = nullptr;
+	}
+
+	// Command buffer of the open batch, copies and barriers recorded here go out with the next flush()
+	VkCommandBuffer commands()
+	{
+		if (this->m_recording)
+			return this->m_recording;
+
+		VkCommandBufferAllocateInfo command_buffer_allocate_info{};
+		command_buffer_allocate_info.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		command_buffer_allocate_info.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		command_buffer_allocate_info.commandPool        = this->m_command_pool;
+		command_buffer_allocate_info.commandBufferCount = 1;
+
+		VkResult result = vkAllocateCommandBuffers(this->m_device, &command_buffer_allocate_info, &this->m_recording);
+		assert(result == VK_SUCCESS && "Failed to allocate upload command buffer!");
+
+		VkCommandBufferBeginInfo command_buffer_begin_info{};
+		command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		result = vkBeginCommandBuffer(this->m_recording, &command_buffer_begin_info);
+		assert(result == VK_SUCCESS && "Failed to begin upload command buffer!");
+
+		return this->m_recording;
+	}
+
+	bool recording() const
+	{
+		return this->m_recording != nullptr;
+	}
+
+	// Runs a_release once everything recorded so far has finished on the GPU, i.e. destroying a staging buffer
+	void release(std::function<void()> a_release)
+	{
+		assert(this->m_recording && "Nothing recorded that could still be using it");
+		this->m_recording_releases.emplace_back(std::move(a_release));
+	}
+
+	// Submits the open batch, returns the value the timeline semaphore reaches once it's done, 0 if nothing was recorded
+	uint64_t flush()
+	{
+		if (!this->m_recording)
+			return 0;
+
+		vkEndCommandBuffer(this->m_recording);
+
+		const uint64_t value = this->m_flushed + 1;
+
+		VkTimelineSemaphoreSubmitInfoKHR timeline_info{};
+		timeline_info.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		timeline_info.signalSemaphoreValueCount = 1;
+		timeline_info.pSignalSemaphoreValues    = &value;
+
+		VkSubmitInfo submit_info{};
+		submit_info.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.pNext                = this->m_semaphore ? &timeline_info : nullptr;
+		submit_info.commandBufferCount   = 1;
+		submit_info.pCommandBuffers      = &this->m_recording;
+		submit_info.signalSemaphoreCount = this->m_semaphore ? 1 : 0;
+		submit_info.pSignalSemaphores    = &this->m_semaphore;
+
+		if (vkQueueSubmit(this->m_queue, 1, &submit_info, this->m_fence) != VK_SUCCESS)
+			throw std::runtime_error("Failed to submit upload command buffer!");
+
+		this->m_batches.push_back({this->m_recording, value, std::move(this->m_recording_releases)});
+		this->m_recording_releases = {};
+		this->m_recording          = nullptr;
+		this->m_flushed            = value;
+
+		// Nothing can wait on a fence from another queue, so without timelines the batch has to finish here
+		if (this->m_fence)
+		{
+			vkWaitForFences(this->m_device, 1, &this->m_fence, VK_TRUE, UINT64_MAX);
+			vkResetFences(this->m_device, 1, &this->m_fence);
+			this->m_completed = value;
+		}
+
+		return value;
+	}
+
+	// Frees batches that have finished, never waits
+	void retire()
+	{
+		if (this->m_semaphore && !this->m_batches.empty())
+			this->m_get_counter_value(this->m_device, this->m_semaphore, &this->m_completed);
+
+		while (!this->m_batches.empty() && this->m_batches.front().m_value <= this->m_completed)
+		{
+			Batch &batch = this->m_batches.front();
+
+			vkFreeCommandBuffers(this->m_device, this->m_command_pool, 1, &batch.m_commands);
+			this->run_releases(batch.m_releases);
+
+			this->m_batches.pop_front();
+		}
+	}
+
+	bool completed(uint64_t a_value) const
+	{
+		return a_value <= this->m_completed;
+	}
+
+	// Blocks until a_value is reached, only for shutdown or when the CPU really needs the result
+	void wait(uint64_t a_value)
+	{
+		if (!this->m_semaphore || a_value <= this->m_completed)
+			return;
+
+		VkSemaphoreWaitInfoKHR wait_info{};
+		wait_info.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		wait_info.semaphoreCount = 1;
+		wait_info.pSemaphores    = &this->m_semaphore;
+		wait_info.pValues        = &a_value;
+
+		this->m_wait_semaphores(this->m_device, &wait_info, UINT64_MAX);
+		this->m_completed = a_value;
+	}
+
+	// Value submits reading uploads have to wait on, 0 once everything flushed is known to be done
+	uint64_t pending() const
+	{
+		if (!this->m_semaphore || this->m_flushed <= this->m_completed)
+			return 0;
+
+		return this->m_flushed;
+	}
+
+	VkSemaphore semaphore() const
+	{
+		return this->m_semaphore;
+	}
+
+  private:
+	struct Batch
+	{
+		VkCommandBuffer                    m_commands{nullptr};
+		uint64_t                           m_value{0};          // Timeline value signalled when done
+		std::vector<std::function<void()>> m_releases{};        // Run once m_value is reached
+	};
+
+	static void run_releases(std::vector<std::function<void()>> &a_releases)
+	{
+		for (auto &release : a_releases)
+			release();
+
+		a_releases.clear();
+	}
+
+	VkDevice                           m_device{nullptr};
+	VkQueue                            m_queue{nullptr};
+	VkCommandPool                      m_command_pool{nullptr};
+	VkSemaphore                        m_semaphore{nullptr};          // Timeline, reaches a batch's value once it's done
+	VkFence                            m_fence{nullptr};              // Only without timeline semaphores
+	VkCommandBuffer                    m_recording{nullptr};          // Open batch, nullptr until something is recorded
+	std::vector<std::function<void()>> m_recording_releases{};        // Releases of the open batch
+	std::deque<Batch>                  m_batches{};                   // Flushed and not retired yet, in submit order
+	uint64_t                           m_flushed{0};                  // Value of the last flushed batch
+	uint64_t                           m_completed{0};                // Last value seen reached
+	PFN_vkGetSemaphoreCounterValueKHR  m_get_counter_value{nullptr};
+	PFN_vkWaitSemaphoresKHR            m_wait_semaphores{nullptr};
+};
+
+}        // namespace vkd
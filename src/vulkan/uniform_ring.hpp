@@ -0,0 +1,154 @@
+// VulkanEd Source Code
+// Wasim Abbas
+// http://www.waZim.com
+// Copyright (c) 2021
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the 'Software'),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED 'AS IS', WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+// CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+// TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+// OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// Version: 1.0.0
+
+
+#pragma once
+
+#include "common.hpp"
+#include "config.hpp"
+#include "vulkan/memory_allocator.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+
+/*  UniformRing usage
+ *  One host coherent uniform buffer, mapped once, split into a region per frame in flight. begin_frame() resets
+ *  the bump pointer of a region once its fence has signalled, allocate() hands out minUniformBufferOffsetAlignment
+ *  aligned blocks from it with a host pointer to write into and the offset to pass as a dynamic UBO offset.
+ *  Bind the ring with VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, buffer() and the block size as range.
+ *  Nothing is mapped, unmapped or allocated per frame, a frame writing more than cfg::get_uniform_ring_frame_size()
+ *  throws. Allocations come out in the same order every frame so offsets baked into pre-recorded command
+ *  buffers stay valid as long as the same blocks are allocated each frame.
+ */
+
+namespace vkd
+{
+class UniformRing final
+{
+  public:
+	FORCE_INLINE              UniformRing()                               = default;        //! Default constructor
+	FORCE_INLINE              UniformRing(const UniformRing &a_other)     = delete;         //! Copy constructor
+	FORCE_INLINE              UniformRing(UniformRing &&a_other) noexcept = delete;         //! Move constructor
+	FORCE_INLINE UniformRing &operator=(const UniformRing &a_other)       = delete;         //! Copy assignment operator
+	FORCE_INLINE UniformRing &operator=(UniformRing &&a_other) noexcept   = delete;         //! Move assignment operator
+	FORCE_INLINE ~UniformRing() noexcept                                  = default;        //! Destructor, call destroy() before the device goes
+
+	void create(VkPhysicalDevice a_physical_device, VkDevice a_device, MemoryAllocator &a_allocator, uint32_t a_frames)
+	{
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(a_physical_device, &properties);
+
+		this->m_device     = a_device;
+		this->m_alignment  = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+		this->m_frame_size = align_up(cfg::get_uniform_ring_frame_size(), this->m_alignment);
+		this->m_frames     = a_frames;
+		this->m_head       = 0;
+		this->m_end        = this->m_frame_size;
+
+		VkBufferCreateInfo buffer_info{};
+		buffer_info.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_info.size        = this->m_frame_size * a_frames;
+		buffer_info.usage       = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+		buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkResult result = vkCreateBuffer(a_device, &buffer_info, cfg::VkAllocator, &this->m_buffer);
+		assert(result == VK_SUCCESS && "Failed to create uniform ring buffer!");
+
+		this->m_memory = a_allocator.allocate_buffer(this->m_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		result = vkBindBufferMemory(a_device, this->m_buffer, this->m_memory.m_memory, this->m_memory.m_offset);
+		assert(result == VK_SUCCESS && "Failed to bind uniform ring memory!");
+	}
+
+	void destroy(MemoryAllocator &a_allocator)
+	{
+		if (this->m_buffer)
+			vkDestroyBuffer(this->m_device, this->m_buffer, cfg::VkAllocator);
+
+		a_allocator.free(this->m_memory);
+		this->m_buffer = nullptr;
+	}
+
+	// Region a_frame was last used by has finished on the GPU, everything in it can be overwritten
+	void begin_frame(uint32_t a_frame)
+	{
+		assert(a_frame < this->m_frames && "Frame out of range");
+
+		this->m_head = a_frame * this->m_frame_size;
+		this->m_end  = this->m_head + this->m_frame_size;
+	}
+
+	// Host pointer to a_size bytes for this frame, a_dynamic_offset is where they are in buffer()
+	void *allocate(VkDeviceSize a_size, uint32_t &a_dynamic_offset)
+	{
+		if (this->m_head + a_size > this->m_end)
+			throw std::runtime_error("Uniform ring frame is full, raise cfg::get_uniform_ring_frame_size()");
+
+		a_dynamic_offset = static_cast<uint32_t>(this->m_head);
+		this->m_head     = align_up(this->m_head + a_size, this->m_alignment);
+
+		return this->m_memory.mapped<uint8_t>() + a_dynamic_offset;
+	}
+
+	template <class _type>
+	_type *allocate(uint32_t &a_dynamic_offset)
+	{
+		return static_cast<_type *>(this->allocate(sizeof(_type), a_dynamic_offset));
+	}
+
+	VkBuffer buffer() const
+	{
+		return this->m_buffer;
+	}
+
+	VkDeviceSize alignment() const
+	{
+		return this->m_alignment;
+	}
+
+	// Bytes used in the current frame so far
+	VkDeviceSize used() const
+	{
+		return this->m_head - (this->m_end - this->m_frame_size);
+	}
+
+  private:
+	static VkDeviceSize align_up(VkDeviceSize a_value, VkDeviceSize a_alignment)
+	{
+		return (a_value + a_alignment - 1) / a_alignment * a_alignment;
+	}
+
+	VkDevice         m_device{nullptr};
+	VkBuffer         m_buffer{nullptr};        // m_frames regions of m_frame_size back to back
+	MemoryAllocation m_memory{};               // Host coherent, mapped for the lifetime of the ring
+	VkDeviceSize     m_alignment{1};           // minUniformBufferOffsetAlignment, every block starts on it
+	VkDeviceSize     m_frame_size{0};          // Bytes per frame region, multiple of m_alignment
+	VkDeviceSize     m_head{0};                // Next free byte in the current region
+	VkDeviceSize     m_end{0};                 // End of the current region
+	uint32_t         m_frames{0};              // Frames in flight sharing the ring
+};
+
+}        // namespace vkd
@@ -55,11 +55,26 @@
 #include "camera.hpp"
 #include <CImg/CImg.h>
 
-#include "skeletal_animation.hpp"
+#include "animation/animation_asset.hpp"
+#include "animation/animation_system.hpp"
+#include "animation/compressed_clip.hpp"
+#include "animation/skeleton.hpp"
+#include "animation/gpu_animation.hpp"
+#include "animation/skinning_kernels.hpp"
+#include "animation/skinning_palette.hpp"
+#include "animation/vertex_animation_texture.hpp"
+#include "profiling/cpu_profiler.hpp"
+#include "threading/job_system.hpp"
+#include "vulkan/gpu_profiler.hpp"
+#include "vulkan/memory_allocator.hpp"
+#include "vulkan/staging_pool.hpp"
+#include "vulkan/transfer_manager.hpp"
+#include "vulkan/uniform_ring.hpp"
 #include "vulkan_astro_boy.hpp"
 
 #define VULKANED_USE_GLFW 1
 
+#include <algorithm>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -81,10 +96,42 @@ typedef struct
 {
 	alignas(16) ror::Matrix4f model;
 	alignas(16) ror::Matrix4f view_projection;
-	alignas(16) ror::Matrix4f joints_matrices[44];
+	alignas(16) float32_t     time;        // Seconds of animation played, drives vertex animation texture playback
 
 } Uniforms;
 
+// Per character entry of the instances storage buffer, std430 layout of Instance in skinning.comp and skinned.vert
+typedef struct
+{
+	alignas(16) ror::Matrix4f model;                 // Placement of the character, applied before Uniforms::model
+	uint32_t                  palette_offset;        // In vec4s into the palettes storage buffer
+	uint32_t                  padding[3];
+
+} SkinnedInstance;
+
+// Push constants of skinning.comp, offsets are in floats into the attributes vertex buffer
+typedef struct
+{
+	uint32_t vertex_count;
+	uint32_t normals_offset;
+	uint32_t weights_offset;
+	uint32_t joint_ids_offset;
+} SkinningLayout;
+
+// Push constants of vat.vert, copied from the baked ror::VertexAnimationTexture
+typedef struct
+{
+	uint32_t  vertex_count;
+	uint32_t  width;
+	uint32_t  frame_count;
+	float32_t frames_per_second;
+} VatLayout;
+
+constexpr uint32_t           skinning_group_size     = 64;                                    // local_size_x of skinning.comp, instances are dispatched along y
+constexpr ror::PaletteFormat skinning_palette_format = ror::PaletteFormat::affine3x4;        // Passed to skinning.comp as a specialization constant
+
+static_assert(!(cfg::get_cpu_skinning() && cfg::get_gpu_animation()), "CPU skinning needs the palettes of the CPU animation system");
+
 FORCE_INLINE auto get_surface_format()
 {
 	return VK_FORMAT_B8G8R8A8_SRGB;
@@ -460,7 +507,9 @@ inline auto get_queue_indices(VkPhysicalDevice a_physical_device, VkSurfaceKHR a
 	if (!found_indices[compute_index].first)
 	{
 		found_indices[compute_index].first = get_dedicated_queue_family(queue_families, VK_QUEUE_COMPUTE_BIT, static_cast<uint32_t>(~VK_QUEUE_GRAPHICS_BIT), found_indices[compute_index].second);
-		assert(found_indices[compute_index].first && "No compute queue found can't continue!");
+		// Software implementations like lavapipe only have one family, skinning goes on the graphics queue then
+		if (!found_indices[compute_index].first)
+			found_indices[compute_index].second = found_indices[graphics_index].second;
 	}
 
 	// Look for a queue that has transfer but no compute or graphics
@@ -513,17 +562,28 @@ inline auto get_queue_indices(VkPhysicalDevice a_physical_device, VkSurfaceKHR a
 		priority_index++;
 	}
 
+	// Families that weren't found share the graphics queue, same family and queue index
+	if (!found_indices[compute_index].first)
+		a_queue_data.m_indicies[compute_index] = a_queue_data.m_indicies[graphics_index];
+
+	if (!found_indices[transfer_index].first)
+		a_queue_data.m_indicies[transfer_index] = a_queue_data.m_indicies[graphics_index];
+
+	// Nothing to present to when running headless
+	if (a_surface != VK_NULL_HANDLE)
 	{
-		VkBool32 present_support = false;
-		auto     result          = vkGetPhysicalDeviceSurfaceSupportKHR(a_physical_device, a_queue_data.m_indicies[graphics_index].first, a_surface, &present_support);
-		assert(result == VK_SUCCESS);
-		assert(present_support && "Graphics queue chosen doesn't support presentation!");
-	}
-	{
-		VkBool32 present_support = false;
-		auto     result          = vkGetPhysicalDeviceSurfaceSupportKHR(a_physical_device, a_queue_data.m_indicies[compute_index].first, a_surface, &present_support);
-		assert(result == VK_SUCCESS);
-		assert(present_support && "Compute queue chosen doesn't support presentation!");
+		{
+			VkBool32 present_support = false;
+			auto     result          = vkGetPhysicalDeviceSurfaceSupportKHR(a_physical_device, a_queue_data.m_indicies[graphics_index].first, a_surface, &present_support);
+			assert(result == VK_SUCCESS);
+			assert(present_support && "Graphics queue chosen doesn't support presentation!");
+		}
+		{
+			VkBool32 present_support = false;
+			auto     result          = vkGetPhysicalDeviceSurfaceSupportKHR(a_physical_device, a_queue_data.m_indicies[compute_index].first, a_surface, &present_support);
+			assert(result == VK_SUCCESS);
+			assert(present_support && "Compute queue chosen doesn't support presentation!");
+		}
 	}
 
 	for (const auto &queue_family : consolidated_families)
@@ -679,6 +739,13 @@ class Instance : public VulkanObject<VkInstance>
 void Instance::temp()
 {}
 
+// What gets loaded and drawn, defaults are the interactive scene, benchmarks replace them per scenario
+struct SceneSettings
+{
+	uint32_t    m_crowd_size{cfg::get_crowd_size()};                                                       // Skinned astro boys drawn with one instanced draw
+	std::string m_scene{"/personal/vulkaned/assets/plant-statue-smaller/plant-statue-basisu.gltf"};        // glTF loaded at startup, empty to skip, isn't drawn yet
+};
+
 class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 {
   public:
@@ -697,18 +764,26 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		// Wait for stuff to finish before deleting
 		vkDeviceWaitIdle(this->m_device);
 
+		this->m_transfer_manager.destroy();
+		this->m_staging_pool.destroy(this->m_memory_allocator);
+
 		this->destroy_buffers();
+		this->destroy_animation_tables();
+		this->destroy_skinned_vertex_buffers();
 		this->destroy_uniform_buffers();
 
+		this->destroy_skinning_pipeline();
 		this->destroy_descriptor_set_layout();
 
 		this->destroy_sync_object();
 
 		this->cleanup_swapchain();
 
+		this->destroy_vertex_animation_texture();
 		this->destroy_texture();
 		this->destroy_texture_sampler();
 
+		this->m_gpu_profiler.destroy();
 		this->destroy_command_pools();
 		this->destroy_descriptor_pools();
 		this->destory_surface();
@@ -717,21 +792,30 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 
 	virtual void temp();
 
-	PhysicalDevice(VkInstance a_instance, void *a_window) :
-	    m_instance(a_instance), m_window(a_window)
+	PhysicalDevice(VkInstance a_instance, void *a_window, const SceneSettings &a_settings = {}) :
+	    m_instance(a_instance), m_window(a_window), m_crowd_size(a_settings.m_crowd_size)
 	{
 		// Order of these calls is important, don't reorder
-		this->create_surface(this->m_window);
-		this->create_physical_device();
-		this->create_device();
-		this->create_swapchain();
-		this->create_imageviews();
+		{
+			utl::CpuZone zone{"create device"};
+
+			this->create_surface(this->m_window);
+			this->create_physical_device();
+			this->create_device();
+			this->create_swapchain();
+			this->create_imageviews();
+		}
 
 		this->create_descriptor_set_layout();
 
 		// Create pipeline etc, to be cleaned out later
-		this->create_render_pass();
-		this->create_graphics_pipeline();
+		{
+			utl::CpuZone zone{"create pipelines"};
+
+			this->create_render_pass();
+			this->create_graphics_pipeline();
+			this->create_skinning_pipeline();
+		}
 
 		this->create_msaa_color_buffer();
 		this->create_depth_buffer();
@@ -739,118 +823,186 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		this->create_command_pools();
 		this->create_descriptor_pools();
 		this->create_command_buffers();
+		this->create_gpu_profiler();
+		this->create_transfer_manager();
 
-		this->create_vertex_buffers();
-		this->create_uniform_buffers();
-		this->create_texture();
-		this->create_descriptor_sets();
-
-		this->record_command_buffers();
-
-		this->create_sync_objects();
-	}
-
-	std::pair<unsigned int, double> get_keyframe_time(bool a_animate)
-	{
-		// Note this is very specific to AstroBoy
-		static double   accumulate_time  = 0.0;
-		static uint32_t current_keyframe = 0;
-		const double    per_frame_time   = 1.166670 / 36.0;
-
-		double new_time = 0.0;
-		double delta    = 0.0;
-
-		new_time = glfwGetTime();
-
-		if (a_animate)
-			delta = new_time - this->m_old_time;
-
-		this->m_old_time = new_time;
-
-		accumulate_time += delta;
-
-		current_keyframe = static_cast<uint32_t>(accumulate_time / per_frame_time);
+		{
+			utl::CpuZone zone{"create scene"};
+
+			this->create_vertex_buffers();
+			this->create_skinned_vertex_buffers();
+			this->create_skeletons();
+			this->create_animation_tables();
+			this->create_uniform_buffers();
+			this->create_texture();
+			this->create_vertex_animation_texture();
+			this->create_descriptor_sets();
+
+			// Everything above recorded into one upload batch, the first frame's submits wait for it on the GPU
+			this->flush_uploads();
+		}
 
-		if (accumulate_time > 1.66670 || (current_keyframe > astro_boy_animation_keyframes_count - 5))        // Last 5 frames don't quite work with the animation loop, so ignored
 		{
-			accumulate_time  = 0.0;
-			current_keyframe = 0;
+			utl::CpuZone zone{"record command buffers"};
+
+			this->record_command_buffers();
+			this->record_skinning_command_buffers();
 		}
 
-		return std::make_pair(current_keyframe, delta);
+		this->create_sync_objects();
 	}
 
 	double m_old_time{0};
+	double m_animation_time{0};
 
-	auto animate(bool a_animate)
+	const std::vector<ror::Matrix4f> &animate(bool a_animate)
 	{
-		std::vector<ror::Matrix4f> astro_boy_joint_matrices;
-		astro_boy_joint_matrices.reserve(astro_boy_nodes_count);
+		utl::CpuZone zone{"animation"};
 
-		auto [current_keyframe, delta_time] = get_keyframe_time(a_animate);
+		double new_time = this->headless() ? this->m_old_time + cfg::get_headless_frame_time() : glfwGetTime();
+		double delta    = a_animate ? new_time - this->m_old_time : 0.0;
 
-		auto astro_boy_matrices = ror::get_world_matrices_for_skinning(astro_boy_tree, astro_boy_nodes_count, current_keyframe, delta_time);
+		this->m_old_time = new_time;
+		this->m_animation_time += delta;
 
-		for (size_t i = 0; i < astro_boy_matrices.size(); ++i)
-		{
-			if (astro_boy_tree[i].m_type == 1)
-				astro_boy_joint_matrices.push_back(astro_boy_matrices[i] * ror::get_ror_matrix4(astro_boy_tree[i].m_inverse));
-		}
+		// Palettes come from animation.comp, only the playheads move on the CPU
+		if (cfg::get_gpu_animation())
+			this->m_astro_boy_animation.advance(static_cast<float32_t>(delta));
+		else
+			this->m_astro_boy_animation.update(static_cast<float32_t>(delta));
 
-		return astro_boy_joint_matrices;
+		return this->m_astro_boy_animation.palettes();
 	}
 
 	void draw_frame(bool a_update_animation)
 	{
-		vkWaitForFences(this->m_device, 1, &this->m_queue_fence[this->m_current_frame], VK_TRUE, UINT64_MAX);
+		utl::CpuZone frame_zone{"frame"};
 
-		uint32_t image_index;
-		VkResult swapchain_res = vkAcquireNextImageKHR(this->m_device, this->m_swapchain, UINT64_MAX, this->m_image_available_semaphore[this->m_current_frame], VK_NULL_HANDLE, &image_index);
-
-		if (swapchain_res == VK_ERROR_OUT_OF_DATE_KHR)
 		{
-			assert(0 && "This should never happen");
-			this->recreate_swapchain();
+			utl::CpuZone zone{"fence wait"};
+			vkWaitForFences(this->m_device, 1, &this->m_queue_fence[this->m_current_frame], VK_TRUE, UINT64_MAX);
 		}
-		else if (swapchain_res != VK_SUCCESS && swapchain_res != VK_SUBOPTIMAL_KHR)
+
+		this->retire_uploads();
+
+		uint32_t image_index = this->m_current_frame;        // Offscreen images are used round robin
+
+		if (!this->headless())
 		{
-			throw std::runtime_error("Acquire Next image failed or its suboptimal!");
+			utl::CpuZone zone{"acquire"};
+
+			VkResult swapchain_res = vkAcquireNextImageKHR(this->m_device, this->m_swapchain, UINT64_MAX, this->m_image_available_semaphore[this->m_current_frame], VK_NULL_HANDLE, &image_index);
+
+			if (swapchain_res == VK_ERROR_OUT_OF_DATE_KHR)
+			{
+				assert(0 && "This should never happen");
+				this->recreate_swapchain();
+			}
+			else if (swapchain_res != VK_SUCCESS && swapchain_res != VK_SUBOPTIMAL_KHR)
+			{
+				throw std::runtime_error("Acquire Next image failed or its suboptimal!");
+			}
 		}
 
 		// Check if a previous frame is using this image (i.e. there is its fence to wait on)
 		if (this->m_queue_fence_in_flight[image_index] != VK_NULL_HANDLE)
 		{
+			utl::CpuZone zone{"image fence wait"};
 			vkWaitForFences(this->m_device, 1, &this->m_queue_fence_in_flight[image_index], VK_TRUE, UINT64_MAX);
 		}
 
 		// Mark the image as now being in use by this frame
 		this->m_queue_fence_in_flight[image_index] = this->m_queue_fence[this->m_current_frame];
 
+		// Last submit of this image's command buffers has finished, so its timestamps are ready
+		this->m_gpu_profiler.resolve(image_index);
+
 		VkSubmitInfo submit_info{};
 		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-		VkSemaphore          waitSemaphores[] = {this->m_image_available_semaphore[this->m_current_frame]};
-		VkPipelineStageFlags waitStages[]     = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-		submit_info.waitSemaphoreCount        = 1;
-		submit_info.pWaitSemaphores           = waitSemaphores;
-		submit_info.pWaitDstStageMask         = waitStages;
-		submit_info.commandBufferCount        = 1;
-		submit_info.pCommandBuffers           = &this->m_graphics_command_buffers[image_index];
+		// Vertex input waits for the skinned vertices, everything before it can overlap with skinning
+		// Offscreen images aren't acquired or presented so headless only waits on skinning and signals nothing
+		VkSemaphore          waitSemaphores[3] = {this->m_skinning_finished_semaphore[this->m_current_frame], this->m_image_available_semaphore[this->m_current_frame]};
+		VkPipelineStageFlags waitStages[3]     = {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+		uint64_t             waitValues[3]     = {0, 0, 0};        // Only read for the upload timeline semaphore
+		uint32_t             wait_count        = this->headless() ? 1 : 2;
+
+		// Until the uploads are seen done every submit waits for them where vertices, indices and textures are first read
+		uint64_t graphics_upload = this->m_transfer_manager.pending();
+		if (graphics_upload != 0)
+		{
+			waitSemaphores[wait_count] = this->m_transfer_manager.semaphore();
+			waitStages[wait_count]     = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			waitValues[wait_count]     = graphics_upload;
+			++wait_count;
+		}
+
+		VkTimelineSemaphoreSubmitInfoKHR timeline_info{};
+		timeline_info.sType                   = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		timeline_info.waitSemaphoreValueCount = wait_count;
+		timeline_info.pWaitSemaphoreValues    = waitValues;
+
+		submit_info.pNext              = graphics_upload != 0 ? &timeline_info : nullptr;
+		submit_info.waitSemaphoreCount = wait_count;
+		submit_info.pWaitSemaphores    = waitSemaphores;
+		submit_info.pWaitDstStageMask  = waitStages;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers    = &this->m_graphics_command_buffers[image_index];
 
 		VkSemaphore signalSemaphores[]   = {m_render_finished_semaphore[this->m_current_frame]};
-		submit_info.signalSemaphoreCount = 1;
+		submit_info.signalSemaphoreCount = this->headless() ? 0 : 1;
 		submit_info.pSignalSemaphores    = signalSemaphores;
 
 		vkResetFences(this->m_device, 1, &this->m_queue_fence[this->m_current_frame]);
 
 		// Update our uniform buffers for this frame
-		this->update_uniform_buffer(image_index, a_update_animation);
+		{
+			utl::CpuZone zone{"update uniforms"};
+			this->update_uniform_buffer(image_index, a_update_animation);
+		}
 
-		if (vkQueueSubmit(this->m_graphics_queue, 1, &submit_info, this->m_queue_fence[this->m_current_frame]) != VK_SUCCESS)
 		{
-			throw std::runtime_error("failed to submit draw command buffer!");
+			utl::CpuZone zone{"submit"};
+
+			// Skin once into this image's vertex buffer, its previous use finished with the fence above
+			VkSubmitInfo compute_submit_info{};
+			compute_submit_info.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			compute_submit_info.commandBufferCount   = 1;
+			compute_submit_info.pCommandBuffers      = &this->m_compute_command_buffers[image_index];
+			compute_submit_info.signalSemaphoreCount = 1;
+			compute_submit_info.pSignalSemaphores    = &this->m_skinning_finished_semaphore[this->m_current_frame];
+
+			// Skinning reads the uploaded vertex buffers and animation tables
+			VkSemaphore          upload_semaphore = this->m_transfer_manager.semaphore();
+			VkPipelineStageFlags upload_stage     = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+			uint64_t             compute_upload   = this->m_transfer_manager.pending();
+
+			VkTimelineSemaphoreSubmitInfoKHR compute_timeline_info{};
+			compute_timeline_info.sType                   = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+			compute_timeline_info.waitSemaphoreValueCount = 1;
+			compute_timeline_info.pWaitSemaphoreValues    = &compute_upload;
+
+			if (compute_upload != 0)
+			{
+				compute_submit_info.pNext              = &compute_timeline_info;
+				compute_submit_info.waitSemaphoreCount = 1;
+				compute_submit_info.pWaitSemaphores    = &upload_semaphore;
+				compute_submit_info.pWaitDstStageMask  = &upload_stage;
+			}
+
+			if (vkQueueSubmit(this->m_compute_queue, 1, &compute_submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to submit skinning command buffer!");
+			}
+
+			if (vkQueueSubmit(this->m_graphics_queue, 1, &submit_info, this->m_queue_fence[this->m_current_frame]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to submit draw command buffer!");
+			}
 		}
 
+		this->m_gpu_profiler.submitted(image_index);
+
 		// VkSubpassDependency dependency{};
 		// dependency.srcSubpass          = VK_SUBPASS_EXTERNAL;
 		// dependency.dstSubpass          = 0;
@@ -862,6 +1014,12 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		// renderPassInfo.dependencyCount = 1;
 		// renderPassInfo.pDependencies   = &dependency;
 
+		if (this->headless())
+		{
+			this->m_current_frame = (this->m_current_frame + 1) % cfg::get_number_of_buffers();
+			return;
+		}
+
 		VkPresentInfoKHR presentInfo{};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -874,7 +1032,9 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		presentInfo.pImageIndices   = &image_index;
 		presentInfo.pResults        = nullptr;        // Optional
 
-		swapchain_res = vkQueuePresentKHR(this->m_present_queue, &presentInfo);
+		utl::CpuZone present_zone{"present"};        // Covers the rest of the frame, which is only error handling
+
+		VkResult swapchain_res = vkQueuePresentKHR(this->m_present_queue, &presentInfo);
 
 		if (swapchain_res == VK_ERROR_OUT_OF_DATE_KHR || swapchain_res == VK_SUBOPTIMAL_KHR)
 		{
@@ -889,6 +1049,91 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		this->m_current_frame = (this->m_current_frame + 1) % cfg::get_number_of_buffers();
 	}
 
+	void wait_idle()
+	{
+		vkDeviceWaitIdle(this->m_device);
+	}
+
+	// Reads back what skinning.comp wrote for the last headless frame and compares it with CPU skinning of the same palettes
+	// Call after wait_idle(), returns false if any component is off by more than a_tolerance
+	bool verify_gpu_skinning(float32_t a_tolerance = 1e-3f)
+	{
+		if (!this->headless() || cfg::get_cpu_skinning() || cfg::get_gpu_animation() || skinning_palette_format == ror::PaletteFormat::dual_quaternion)
+		{
+			ror::log_info("Skinning readback needs headless, skinning.comp, CPU palettes and a matrix palette format, skipped");
+			return true;
+		}
+
+		// Offscreen images are used round robin, so the last frame drew with the image before the current one
+		const uint32_t last_image = (this->m_current_frame + cfg::get_number_of_buffers() - 1) % cfg::get_number_of_buffers();
+		const size_t   size       = astro_boy_vertex_count * sizeof(float32_t) * 6 * this->m_crowd_size;
+
+		VkBuffer         readback        = this->create_buffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		MemoryAllocation readback_memory = this->allocate_bind_buffer_memory(readback);
+
+		VkBufferCopy copy_region{};
+		copy_region.size = size;
+
+		VkMemoryBarrier host_barrier{};
+		host_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		host_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		host_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+		VkCommandBuffer commands = this->begin_upload();
+		vkCmdCopyBuffer(commands, this->m_skinned_vertex_buffers[last_image], readback, 1, &copy_region);
+		vkCmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &host_barrier, 0, nullptr, 0, nullptr);
+
+		this->flush_uploads();
+		this->m_transfer_manager.wait(this->m_transfer_manager.pending());
+		this->retire_uploads();
+
+		// Palettes haven't moved since the last frame wrote them
+		std::vector<float32_t> reference(size / sizeof(float32_t));
+		this->skin_instances(this->m_astro_boy_animation.palettes(), reference.data());
+
+		const float32_t *skinned   = readback_memory.mapped<float32_t>();
+		float32_t        max_error = 0.0f;
+
+		for (size_t i = 0; i < reference.size(); ++i)
+			max_error = std::max(max_error, std::fabs(reference[i] - skinned[i]));
+
+		vkDestroyBuffer(this->m_device, readback, cfg::VkAllocator);
+		this->free_device_memory(readback_memory);
+
+		if (max_error > a_tolerance)
+		{
+			ror::log_critical("GPU skinning is off from CPU skinning by {}, tolerance is {}", max_error, a_tolerance);
+			return false;
+		}
+
+		ror::log_info("GPU skinning matches CPU skinning of {} vertices within {}", reference.size() / 6, max_error);
+		return true;
+	}
+
+	// Compute plus graphics of the last frame that finished in milliseconds, 0 if timestamps aren't supported
+	double gpu_frame_time() const
+	{
+		return this->m_gpu_profiler.milliseconds(this->m_scope_animation) + this->m_gpu_profiler.milliseconds(this->m_scope_skinning) +
+		       this->m_gpu_profiler.milliseconds(this->m_scope_main_pass);
+	}
+
+	// Per scope timings, frame slots are image indices
+	const GpuProfiler &gpu_profiler() const
+	{
+		return this->m_gpu_profiler;
+	}
+
+	// Most device memory allocated at once since startup, staging included
+	VkDeviceSize device_memory_peak() const
+	{
+		return this->m_memory_allocator.statistics().m_peak_allocated_bytes;
+	}
+
+	const MemoryStatistics &memory_statistics() const
+	{
+		return this->m_memory_allocator.statistics();
+	}
+
 	void recreate_swapchain()
 	{
 		vkDeviceWaitIdle(this->m_device);
@@ -912,6 +1157,10 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
   private:
 	void create_surface(void *a_window)
 	{
+		// Headless renders into offscreen images, see create_offscreen_images()
+		if (a_window == nullptr)
+			return;
+
 		// TODO: Remove the #if from here
 #if defined(VULKANED_USE_GLFW)
 		glfw_create_surface(this->m_instance, this->m_surface, reinterpret_cast<GLFWwindow *>(a_window));
@@ -920,6 +1169,9 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 
 	void destory_surface()
 	{
+		if (this->m_surface == VK_NULL_HANDLE)
+			return;
+
 		vkDestroySurfaceKHR(this->m_instance, this->m_surface, nullptr);
 		this->m_surface = nullptr;
 	}
@@ -951,7 +1203,7 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		if (this->m_physical_device == nullptr)
 		{
 			ror::log_critical("Couldn't find suitable discrete physical device, falling back to integrated gpu.");
-			assert(gpus.size() > 1);
+			assert(!gpus.empty() && "No vulkan physical device available");
 			this->m_physical_device = gpus[0];
 		}
 
@@ -976,8 +1228,39 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		auto layers     = vkd::enumerate_properties<VkPhysicalDevice, VkLayerProperties>(this->m_physical_device);
 		auto queues     = vkd::get_queue_indices(this->m_physical_device, this->m_surface, priorities_pointers, queue_data);
 
+		bool timeline_extension = std::find_if(extensions.begin(), extensions.end(), [](const char *a_name) {
+			                          return std::strcmp(a_name, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0;
+		                          }) != extensions.end();
+
+		// Core from 1.2 on, where drivers don't have to list the extension any more
+		VkPhysicalDeviceProperties device_properties{};
+		vkGetPhysicalDeviceProperties(this->m_physical_device, &device_properties);
+
+		bool timeline_core = std::min(device_properties.apiVersion, cfg::get_api_version()) >= CFG_VK_MAKE_VERSION(1, 2, 0);
+
+		VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features{};
+		timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+
+		VkPhysicalDeviceVulkan12Features vulkan12_features{};
+		vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		if (timeline_core || timeline_extension)
+		{
+			VkPhysicalDeviceFeatures2 features{};
+			features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features.pNext = timeline_core ? static_cast<void *>(&vulkan12_features) : static_cast<void *>(&timeline_features);
+
+			vkGetPhysicalDeviceFeatures2(this->m_physical_device, &features);
+		}
+
+		// Only timeline semaphores are taken from the 1.2 features, the device is created with the timeline struct either way
+		if (timeline_core)
+			timeline_features.timelineSemaphore = vulkan12_features.timelineSemaphore;
+
+		this->m_timeline_semaphores = timeline_features.timelineSemaphore == VK_TRUE;
+
 		device_create_info.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-		device_create_info.pNext                   = nullptr;
+		device_create_info.pNext                   = this->m_timeline_semaphores ? &timeline_features : nullptr;
 		device_create_info.flags                   = 0;
 		device_create_info.queueCreateInfoCount    = utl::static_cast_safe<uint32_t>(queues.size());
 		device_create_info.pQueueCreateInfos       = queues.data();
@@ -991,6 +1274,12 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		auto result = vkCreateDevice(this->m_physical_device, &device_create_info, cfg::VkAllocator, &this->m_device);
 		assert(result == VK_SUCCESS);
 
+		this->m_calibrated_timestamps = std::find_if(extensions.begin(), extensions.end(), [](const char *a_name) {
+			                                return std::strcmp(a_name, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) == 0;
+		                                }) != extensions.end();
+
+		this->m_memory_allocator.create(this->m_physical_device, this->m_device);
+
 		// delete priorities_pointers;
 		for (auto priority : priorities_pointers)
 			delete priority;
@@ -1023,12 +1312,55 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 
 	void destroy_device()
 	{
+		this->m_memory_allocator.log_statistics();
+		this->m_memory_allocator.destroy();
+
 		vkDestroyDevice(this->m_device, cfg::VkAllocator);
 		this->m_device = nullptr;
 	}
 
+	bool headless() const
+	{
+		return this->m_window == nullptr;
+	}
+
+	// Stands in for the swapchain without a window, same count and format so the rest of the frame is unchanged
+	void create_offscreen_images()
+	{
+		this->m_swapchain_extent = {cfg::get_headless_width(), cfg::get_headless_height()};
+		this->m_swapchain_format = vkd::get_surface_format();
+
+		this->m_swapchain_images.resize(cfg::get_number_of_buffers());
+		this->m_offscreen_images_memory.resize(cfg::get_number_of_buffers());
+
+		for (size_t i = 0; i < this->m_swapchain_images.size(); ++i)
+		{
+			this->m_swapchain_images[i]        = this->create_image(this->m_swapchain_extent.width, this->m_swapchain_extent.height, this->m_swapchain_format, VK_IMAGE_TILING_OPTIMAL,
+			                                                     VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, 1);
+			this->m_offscreen_images_memory[i] = this->allocate_bind_image_memory(this->m_swapchain_images[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+		}
+	}
+
+	void destroy_offscreen_images()
+	{
+		for (size_t i = 0; i < this->m_offscreen_images_memory.size(); ++i)
+		{
+			vkDestroyImage(this->m_device, this->m_swapchain_images[i], cfg::VkAllocator);
+			this->free_device_memory(this->m_offscreen_images_memory[i]);
+		}
+
+		this->m_swapchain_images.clear();
+		this->m_offscreen_images_memory.clear();
+	}
+
 	void create_swapchain()
 	{
+		if (this->headless())
+		{
+			this->create_offscreen_images();
+			return;
+		}
+
 		VkSurfaceCapabilitiesKHR capabilities;
 		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(this->get_handle(), this->m_surface, &capabilities);
 		assert(capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max());
@@ -1206,28 +1538,37 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 
 		result = vkCreateCommandPool(this->m_device, &command_pool_info, cfg::VkAllocator, &this->m_transfer_command_pool);
 		assert(result == VK_SUCCESS);
+
+		command_pool_info.queueFamilyIndex = this->m_compute_queue_index;
+
+		result = vkCreateCommandPool(this->m_device, &command_pool_info, cfg::VkAllocator, &this->m_compute_command_pool);
+		assert(result == VK_SUCCESS);
 	}
 
 	void destroy_command_pools()
 	{
 		vkDestroyCommandPool(this->m_device, this->m_graphics_command_pool, cfg::VkAllocator);
 		vkDestroyCommandPool(this->m_device, this->m_transfer_command_pool, cfg::VkAllocator);
+		vkDestroyCommandPool(this->m_device, this->m_compute_command_pool, cfg::VkAllocator);
 	}
 
 	void create_descriptor_pools()
 	{
-		std::array<VkDescriptorPoolSize, 2> pool_size{};
-		pool_size[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		std::array<VkDescriptorPoolSize, 3> pool_size{};
+		pool_size[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		pool_size[0].descriptorCount = static_cast<uint32_t>(cfg::get_number_of_buffers());        // This should be more generic, perhaps a pool per thread/per frame/per command buffer, TODO: Find out
 
 		pool_size[1].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		pool_size[1].descriptorCount = static_cast<uint32_t>(cfg::get_number_of_buffers());        // This should be more generic, perhaps a pool per thread/per frame/per command buffer, TODO: Find out
+		pool_size[1].descriptorCount = static_cast<uint32_t>(cfg::get_number_of_buffers()) * 2;        // Diffuse and vertex animation texture, this should be more generic, perhaps a pool per thread/per frame/per command buffer, TODO: Find out
+
+		pool_size[2].type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		pool_size[2].descriptorCount = static_cast<uint32_t>(cfg::get_number_of_buffers()) * 9;        // Skinned vertices and instances per graphics set, palettes, positions, attributes, output, instances, animation tables and clip times per skinning set
 
 		VkDescriptorPoolCreateInfo descriptor_pool_create_info{};
 		descriptor_pool_create_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 		descriptor_pool_create_info.poolSizeCount = pool_size.size();
 		descriptor_pool_create_info.pPoolSizes    = pool_size.data();
-		descriptor_pool_create_info.maxSets       = static_cast<uint32_t>(cfg::get_number_of_buffers());
+		descriptor_pool_create_info.maxSets       = static_cast<uint32_t>(cfg::get_number_of_buffers()) * 2;        // Graphics and skinning set per frame
 		descriptor_pool_create_info.flags         = 0;        // VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
 
 		VkResult result = vkCreateDescriptorPool(this->m_device, &descriptor_pool_create_info, cfg::VkAllocator, &this->m_descriptor_pool);
@@ -1257,22 +1598,33 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		{
 			// VkDescriptorImageInfo image_info{}; // Another option if we are dealing with images
 
+			// All sets point at the uniform ring, the frame's block is picked by the dynamic offset at bind time
 			VkDescriptorBufferInfo buffer_info{};
-			buffer_info.buffer = this->m_uniform_buffers[i];
+			buffer_info.buffer = this->m_uniform_ring.buffer();
 			buffer_info.offset = 0;
-			buffer_info.range  = VK_WHOLE_SIZE;        // sizeof(Uniforms);
+			buffer_info.range  = sizeof(Uniforms);
 
 			VkDescriptorImageInfo image_info{};
 			image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 			image_info.imageView   = this->m_texture_image_view;
 			image_info.sampler     = this->m_texture_sampler;
 
-			std::array<VkWriteDescriptorSet, 2> descriptor_write{};
+			// Vertex shader pulls skinned vertices and instance placement from these
+			std::array<VkDescriptorBufferInfo, 2> storage_buffer_infos{};
+			storage_buffer_infos[0] = {this->m_skinned_vertex_buffers[i], 0, VK_WHOLE_SIZE};
+			storage_buffer_infos[1] = {this->m_instance_buffers[i], 0, VK_WHOLE_SIZE};
+
+			VkDescriptorImageInfo vertex_animation_info{};
+			vertex_animation_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			vertex_animation_info.imageView   = this->m_vat_image_view;
+			vertex_animation_info.sampler     = this->m_texture_sampler;        // Only texelFetch'd so any sampler will do
+
+			std::array<VkWriteDescriptorSet, 5> descriptor_write{};
 			descriptor_write[0].sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 			descriptor_write[0].dstSet           = this->m_descriptor_sets[i];
 			descriptor_write[0].dstBinding       = 0;        // TODO: Another hardcoded binding for descriptor
 			descriptor_write[0].dstArrayElement  = 0;
-			descriptor_write[0].descriptorType   = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			descriptor_write[0].descriptorType   = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 			descriptor_write[0].descriptorCount  = 1;
 			descriptor_write[0].pBufferInfo      = &buffer_info;
 			descriptor_write[0].pImageInfo       = nullptr;        // Optional
@@ -1288,7 +1640,75 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 			descriptor_write[1].pImageInfo       = &image_info;
 			descriptor_write[1].pTexelBufferView = nullptr;        // Optional
 
-			vkUpdateDescriptorSets(this->m_device, descriptor_write.size(), descriptor_write.data(), 0, nullptr);
+			for (uint32_t binding = 2; binding < descriptor_write.size(); ++binding)
+			{
+				descriptor_write[binding].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				descriptor_write[binding].dstSet          = this->m_descriptor_sets[i];
+				descriptor_write[binding].dstBinding      = binding;        // Matches skinned.vert
+				descriptor_write[binding].dstArrayElement = 0;
+				descriptor_write[binding].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				descriptor_write[binding].descriptorCount = 1;
+				descriptor_write[binding].pBufferInfo     = &storage_buffer_infos[binding - 2];
+			}
+
+			descriptor_write[4].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptor_write[4].dstSet          = this->m_descriptor_sets[i];
+			descriptor_write[4].dstBinding      = 4;        // Matches vat.vert
+			descriptor_write[4].dstArrayElement = 0;
+			descriptor_write[4].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			descriptor_write[4].descriptorCount = 1;
+			descriptor_write[4].pImageInfo      = &vertex_animation_info;
+
+			// Vertex animation texture binding stays empty without a baked crowd, no pipeline reads it then
+			uint32_t write_count = this->m_vat_image_view ? 5u : 4u;
+
+			vkUpdateDescriptorSets(this->m_device, write_count, descriptor_write.data(), 0, nullptr);
+		}
+
+		this->create_skinning_descriptor_sets();
+	}
+
+	void create_skinning_descriptor_sets()
+	{
+		std::vector<VkDescriptorSetLayout> layouts(cfg::get_number_of_buffers(), this->m_skinning_descriptor_set_layout);
+
+		VkDescriptorSetAllocateInfo descriptor_set_allocate_info{};
+		descriptor_set_allocate_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptor_set_allocate_info.descriptorPool     = this->m_descriptor_pool;
+		descriptor_set_allocate_info.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+		descriptor_set_allocate_info.pSetLayouts        = layouts.data();
+
+		VkResult result = vkAllocateDescriptorSets(this->m_device, &descriptor_set_allocate_info, this->m_skinning_descriptor_sets.data());
+		assert(result == VK_SUCCESS && "Failed to allocate skinning descriptor sets");
+
+		for (size_t i = 0; i < this->m_skinning_descriptor_sets.size(); i++)
+		{
+			// Palettes and instances are written every frame, the rest are the astro boy vertex buffers
+			std::array<VkDescriptorBufferInfo, 7> buffer_infos{};
+			buffer_infos[0] = {this->m_palette_buffers[i], 0, VK_WHOLE_SIZE};
+			buffer_infos[1] = {this->m_vertex_buffers[0], 0, VK_WHOLE_SIZE};
+			buffer_infos[2] = {this->m_vertex_buffers[1], 0, VK_WHOLE_SIZE};
+			buffer_infos[3] = {this->m_skinned_vertex_buffers[i], 0, VK_WHOLE_SIZE};
+			buffer_infos[4] = {this->m_instance_buffers[i], 0, VK_WHOLE_SIZE};
+			buffer_infos[5] = {this->m_animation_tables_buffer, 0, VK_WHOLE_SIZE};
+			buffer_infos[6] = {this->m_clip_time_buffers[i], 0, VK_WHOLE_SIZE};
+
+			std::array<VkWriteDescriptorSet, 7> descriptor_write{};
+			for (uint32_t binding = 0; binding < descriptor_write.size(); ++binding)
+			{
+				descriptor_write[binding].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				descriptor_write[binding].dstSet          = this->m_skinning_descriptor_sets[i];
+				descriptor_write[binding].dstBinding      = binding;        // Matches skinning.comp and animation.comp
+				descriptor_write[binding].dstArrayElement = 0;
+				descriptor_write[binding].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				descriptor_write[binding].descriptorCount = 1;
+				descriptor_write[binding].pBufferInfo     = &buffer_infos[binding];
+			}
+
+			// Animation tables and clip times only exist for animation.comp, skinning.comp never reads them
+			uint32_t write_count = this->m_animation_tables_buffer ? 7u : 5u;
+
+			vkUpdateDescriptorSets(this->m_device, write_count, descriptor_write.data(), 0, nullptr);
 		}
 	}
 
@@ -1335,6 +1755,7 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		{
 			this->create_semaphore(this->m_image_available_semaphore[i]);
 			this->create_semaphore(this->m_render_finished_semaphore[i]);
+			this->create_semaphore(this->m_skinning_finished_semaphore[i]);
 
 			this->create_fence(this->m_queue_fence[i]);
 
@@ -1349,15 +1770,44 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 			vkDestroyFence(this->m_device, this->m_queue_fence[i], cfg::VkAllocator);
 			vkDestroySemaphore(this->m_device, this->m_image_available_semaphore[i], cfg::VkAllocator);
 			vkDestroySemaphore(this->m_device, this->m_render_finished_semaphore[i], cfg::VkAllocator);
+			vkDestroySemaphore(this->m_device, this->m_skinning_finished_semaphore[i], cfg::VkAllocator);
 		}
 	}
 
+	void create_gpu_profiler()
+	{
+		auto families = enumerate_general_property<VkQueueFamilyProperties, false>(vkGetPhysicalDeviceQueueFamilyProperties, this->m_physical_device);
+
+		uint32_t valid_bits = std::min(families[this->m_graphics_queue_index].timestampValidBits, families[this->m_compute_queue_index].timestampValidBits);
+
+		this->m_gpu_profiler.create(this->m_instance, this->m_physical_device, this->m_device, cfg::get_number_of_buffers(), valid_bits, this->m_calibrated_timestamps);
+
+		// Each command buffer resets its scopes as one range so scopes of a command buffer have to be added together
+		this->m_scope_animation    = this->m_gpu_profiler.add_scope("animation");
+		this->m_scope_skinning     = this->m_gpu_profiler.add_scope("skinning");
+		this->m_scope_main_pass    = this->m_gpu_profiler.add_scope("main pass");
+		this->m_scope_skinned_draw = this->m_gpu_profiler.add_scope("skinned draw");
+		this->m_scope_crowd_draw   = this->m_gpu_profiler.add_scope("crowd draw");
+		this->m_scope_upload       = this->m_gpu_profiler.add_scope("upload");
+
+		// Dedicated transfer families don't have to support timestamps and can't record vkCmdResetQueryPool
+		const auto &transfer_family = families[this->m_transfer_queue_index];
+		this->m_profile_uploads     = this->m_gpu_profiler.enabled() && transfer_family.timestampValidBits > 0 &&
+		                          (transfer_family.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) != 0;
+	}
+
+	void create_transfer_manager()
+	{
+		this->m_transfer_manager.create(this->m_device, this->m_transfer_queue, this->m_transfer_command_pool, this->m_timeline_semaphores);
+		this->m_staging_pool.create(this->m_device, this->m_memory_allocator);
+	}
+
 	void create_graphics_pipeline()
 	{
 		VkShaderModule vert_shader_module;
 		VkShaderModule frag_shader_module;
 
-		vert_shader_module = this->create_shader_module("assets/shaders/tri.vert.spv");
+		vert_shader_module = this->create_shader_module("assets/shaders/skinned.vert.spv");
 		frag_shader_module = this->create_shader_module("assets/shaders/tri.frag.spv");
 
 		VkPipelineShaderStageCreateInfo vert_shader_stage_info = {};
@@ -1382,8 +1832,8 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 
 		// This is where you add where the vertex data is coming from
 		// TODO: To be abstracted later so it can be configured properly
-		auto vertex_attribute_descriptions = utl::get_astro_boy_vertex_attributes();
-		auto vertex_attribute_bindings     = utl::get_astro_boy_vertex_bindings();
+		auto vertex_attribute_descriptions = utl::get_astro_boy_skinned_vertex_attributes();
+		auto vertex_attribute_bindings     = utl::get_astro_boy_skinned_vertex_bindings();
 
 		VkPipelineVertexInputStateCreateInfo pipeline_vertex_input_state_info = {};
 		pipeline_vertex_input_state_info.sType                                = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -1513,10 +1963,16 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		pipeline_layout_info.sType                      = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 		pipeline_layout_info.pNext                      = nullptr;
 		pipeline_layout_info.flags                      = 0;
+		// Vertices per instance in the skinned buffer, skinned.vert strides instances by it
+		VkPushConstantRange push_constant_range{};
+		push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		push_constant_range.offset     = 0;
+		push_constant_range.size       = sizeof(uint32_t);
+
 		pipeline_layout_info.setLayoutCount             = 1;
 		pipeline_layout_info.pSetLayouts                = &this->m_descriptor_set_layout;
-		pipeline_layout_info.pushConstantRangeCount     = 0;              // Optional
-		pipeline_layout_info.pPushConstantRanges        = nullptr;        // Optional
+		pipeline_layout_info.pushConstantRangeCount     = 1;
+		pipeline_layout_info.pPushConstantRanges        = &push_constant_range;
 
 		VkResult result = vkCreatePipelineLayout(this->m_device, &pipeline_layout_info, cfg::VkAllocator, &this->m_pipeline_layout);
 		assert(result == VK_SUCCESS);
@@ -1545,6 +2001,33 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		result = vkCreateGraphicsPipelines(this->m_device, this->m_pipeline_cache, 1, &graphics_pipeline_create_info, cfg::VkAllocator, &this->m_graphics_pipeline);
 		assert(result == VK_SUCCESS);
 
+		// Baked crowd shares all fixed function state, only its vertex stage, inputs and push constants differ
+		if (cfg::get_vat_crowd_size() > 0)
+		{
+			VkShaderModule vat_shader_module = this->create_shader_module("assets/shaders/vat.vert.spv");
+			shader_stages[0].module          = vat_shader_module;
+
+			auto vat_attribute_descriptions = utl::get_astro_boy_vat_vertex_attributes();
+			auto vat_attribute_bindings     = utl::get_astro_boy_vat_vertex_bindings();
+
+			pipeline_vertex_input_state_info.vertexBindingDescriptionCount   = vat_attribute_bindings.size();
+			pipeline_vertex_input_state_info.pVertexBindingDescriptions      = vat_attribute_bindings.data();
+			pipeline_vertex_input_state_info.vertexAttributeDescriptionCount = vat_attribute_descriptions.size();
+			pipeline_vertex_input_state_info.pVertexAttributeDescriptions    = vat_attribute_descriptions.data();
+
+			push_constant_range.size = sizeof(VatLayout);
+
+			result = vkCreatePipelineLayout(this->m_device, &pipeline_layout_info, cfg::VkAllocator, &this->m_vat_pipeline_layout);
+			assert(result == VK_SUCCESS);
+
+			graphics_pipeline_create_info.layout = this->m_vat_pipeline_layout;
+
+			result = vkCreateGraphicsPipelines(this->m_device, this->m_pipeline_cache, 1, &graphics_pipeline_create_info, cfg::VkAllocator, &this->m_vat_pipeline);
+			assert(result == VK_SUCCESS);
+
+			vkDestroyShaderModule(this->m_device, vat_shader_module, cfg::VkAllocator);
+		}
+
 		// cleanup
 		vkDestroyShaderModule(this->m_device, vert_shader_module, cfg::VkAllocator);
 		vkDestroyShaderModule(this->m_device, frag_shader_module, cfg::VkAllocator);
@@ -1557,6 +2040,12 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 
 		vkDestroyPipeline(this->m_device, this->m_graphics_pipeline, cfg::VkAllocator);
 		this->m_graphics_pipeline = nullptr;
+
+		vkDestroyPipelineLayout(this->m_device, this->m_vat_pipeline_layout, cfg::VkAllocator);
+		this->m_vat_pipeline_layout = nullptr;
+
+		vkDestroyPipeline(this->m_device, this->m_vat_pipeline, cfg::VkAllocator);
+		this->m_vat_pipeline = nullptr;
 	}
 
 	void record_command_buffers()
@@ -1574,6 +2063,11 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 			VkResult result = vkBeginCommandBuffer(current_command_buffer, &command_buffer_begin_info);
 			assert(result == VK_SUCCESS);
 
+			const uint32_t slot = static_cast<uint32_t>(i);
+
+			this->m_gpu_profiler.reset(current_command_buffer, slot, this->m_scope_main_pass, 3);
+			this->m_gpu_profiler.begin(current_command_buffer, slot, this->m_scope_main_pass);
+
 			// VkClearValue clear_color = {{{0.028f, 0.028f, 0.03f, 1.0f}}};        // This is the color I want, but I think SRGB is making this very bright than it should be
 			std::array<VkClearValue, 2> clear_color_depth{};
 			clear_color_depth[0].color        = {{0.19f, 0.04f, 0.14f, 1.0f}};
@@ -1605,29 +2099,49 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 			vkCmdBindPipeline(current_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->m_graphics_pipeline);
 			vkCmdSetViewport(current_command_buffer, 0, 1, &viewport);
 
-			VkBuffer vertexBuffers[] = {this->m_vertex_buffers[0],
-			                            this->m_vertex_buffers[1],
-			                            this->m_vertex_buffers[1],
-			                            this->m_vertex_buffers[1],
-			                            this->m_vertex_buffers[1]};
-
-			VkDeviceSize offsets[] = {astro_boy_positions_array_count * 0,
-			                          astro_boy_normals_array_count * 0,                                                                                                                             // Normal offset
-			                          astro_boy_normals_array_count * sizeof(float32_t),                                                                                                             // UV offset
-			                          astro_boy_normals_array_count * sizeof(float32_t) + astro_boy_uvs_array_count * sizeof(float32_t),                                                             // Weight offset
-			                          astro_boy_normals_array_count * sizeof(float32_t) + astro_boy_uvs_array_count * sizeof(float32_t) + astro_boy_weights_array_count * sizeof(float32_t)};        // JointID offset
+			// Positions and normals are skinned by the compute queue into this image's storage buffer and pulled by the vertex shader, uvs are static
+			VkBuffer     vertexBuffers[] = {this->m_vertex_buffers[1]};
+			VkDeviceSize offsets[]       = {astro_boy_normals_array_count * sizeof(float32_t)};        // UV offset
 
-			vkCmdBindVertexBuffers(current_command_buffer, 0, 5, vertexBuffers, offsets);
+			vkCmdBindVertexBuffers(current_command_buffer, 0, 1, vertexBuffers, offsets);
 
 			vkCmdBindIndexBuffer(current_command_buffer, this->m_index_buffer, 0, VK_INDEX_TYPE_UINT32);
 
-			vkCmdBindDescriptorSets(current_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->m_pipeline_layout, 0, 1, &this->m_descriptor_sets[i], 0, nullptr);
+			vkCmdBindDescriptorSets(current_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->m_pipeline_layout, 0, 1, &this->m_descriptor_sets[i], 1, &this->m_uniform_offsets[i]);
+
+			uint32_t vertex_count = astro_boy_vertex_count;
+			vkCmdPushConstants(current_command_buffer, this->m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &vertex_count);
 
 			// vkCmdDraw(current_command_buffer, static_cast<uint32_t>(astro_boy_indices_array_count), 1, 0, 0);
-			vkCmdDrawIndexed(current_command_buffer, astro_boy_indices_array_count, 1, 0, 0, 0);
+			this->m_gpu_profiler.begin(current_command_buffer, slot, this->m_scope_skinned_draw);
+			vkCmdDrawIndexed(current_command_buffer, astro_boy_indices_array_count, this->m_astro_boy_animation.instance_count(), 0, 0, 0);
+			this->m_gpu_profiler.end(current_command_buffer, slot, this->m_scope_skinned_draw);
+
+			// Baked crowd only fetches its vertices, no skinning or palettes involved, index buffer stays bound
+			if (this->m_vat_pipeline)
+			{
+				VkBuffer     vat_vertex_buffers[] = {this->m_vertex_buffers[1], this->m_vat_instance_buffer};
+				VkDeviceSize vat_offsets[]        = {astro_boy_normals_array_count * sizeof(float32_t), 0};
+
+				VatLayout vat_layout{};
+				vat_layout.vertex_count      = this->m_vertex_animation.m_vertex_count;
+				vat_layout.width             = this->m_vertex_animation.m_width;
+				vat_layout.frame_count       = this->m_vertex_animation.m_frame_count;
+				vat_layout.frames_per_second = this->m_vertex_animation.m_frames_per_second;
+
+				vkCmdBindPipeline(current_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->m_vat_pipeline);
+				vkCmdBindVertexBuffers(current_command_buffer, 0, 2, vat_vertex_buffers, vat_offsets);
+				vkCmdBindDescriptorSets(current_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->m_vat_pipeline_layout, 0, 1, &this->m_descriptor_sets[i], 1, &this->m_uniform_offsets[i]);
+				vkCmdPushConstants(current_command_buffer, this->m_vat_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VatLayout), &vat_layout);
+				this->m_gpu_profiler.begin(current_command_buffer, slot, this->m_scope_crowd_draw);
+				vkCmdDrawIndexed(current_command_buffer, astro_boy_indices_array_count, cfg::get_vat_crowd_size(), 0, 0, 0);
+				this->m_gpu_profiler.end(current_command_buffer, slot, this->m_scope_crowd_draw);
+			}
 
 			vkCmdEndRenderPass(current_command_buffer);
 
+			this->m_gpu_profiler.end(current_command_buffer, slot, this->m_scope_main_pass);
+
 			result = vkEndCommandBuffer(current_command_buffer);
 			assert(result == VK_SUCCESS);
 		}
@@ -1676,7 +2190,7 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		resolved_attachment_description.stencilLoadOp           = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		resolved_attachment_description.stencilStoreOp          = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		resolved_attachment_description.initialLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
-		resolved_attachment_description.finalLayout             = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		resolved_attachment_description.finalLayout             = this->headless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;        // Offscreen images are ready to be read back
 
 		VkAttachmentReference resolve_attachment_reference = {};
 		resolve_attachment_reference.attachment            = 2;
@@ -1720,40 +2234,11 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		assert(result == VK_SUCCESS);
 	}
 
-	uint32_t find_memory_type(uint32_t a_type_filter, VkMemoryPropertyFlags a_properties)
-	{
-		VkPhysicalDeviceMemoryProperties memory_properties{};
-		vkGetPhysicalDeviceMemoryProperties(this->m_physical_device, &memory_properties);
-
-		for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
-		{
-			if (a_type_filter & (1 << i) && ((memory_properties.memoryTypes[i].propertyFlags & a_properties) == a_properties))
-			{
-				return i;
-			}
-		}
-
-		throw std::runtime_error("Failed to find suitable memory type!");
-	}
-
 	auto allocate_bind_buffer_memory(VkBuffer a_buffer, VkMemoryPropertyFlags a_properties = (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
 	{
-		VkMemoryRequirements buffer_mem_req{};
-		vkGetBufferMemoryRequirements(this->m_device, a_buffer, &buffer_mem_req);
-
-		VkDeviceMemory buffer_memory;
-
-		VkMemoryAllocateInfo allocation_info{};
-		allocation_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocation_info.allocationSize  = buffer_mem_req.size;
-		allocation_info.memoryTypeIndex = find_memory_type(buffer_mem_req.memoryTypeBits, a_properties);
-		allocation_info.pNext           = nullptr;
+		MemoryAllocation buffer_memory = this->m_memory_allocator.allocate_buffer(a_buffer, a_properties);
 
-		VkResult result = vkAllocateMemory(this->m_device, &allocation_info, cfg::VkAllocator, &buffer_memory);
-		assert(result == VK_SUCCESS && "Failed to allocate vulkan buffer memory!");
-		assert(buffer_memory);
-
-		result = vkBindBufferMemory(this->m_device, a_buffer, buffer_memory, 0);
+		VkResult result = vkBindBufferMemory(this->m_device, a_buffer, buffer_memory.m_memory, buffer_memory.m_offset);
 		assert(result == VK_SUCCESS && "Failed to bind vulkan buffer memory!");
 
 		return buffer_memory;
@@ -1761,17 +2246,22 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 
 	auto create_buffer(size_t a_size, VkBufferUsageFlags a_usage)
 	{
-		// TODO: Change default behaviour of sharing between transfer and graphics only
-		std::vector<uint32_t> indicies{this->m_graphics_queue_index, this->m_transfer_queue_index};
+		// TODO: Change default behaviour of sharing between graphics, transfer and compute
+		std::vector<uint32_t> indicies{this->m_graphics_queue_index};
+
+		// Concurrent sharing needs unique family indices, if everything is on one family the buffer can be exclusive
+		for (auto index : {this->m_transfer_queue_index, this->m_compute_queue_index})
+			if (std::find(indicies.begin(), indicies.end(), index) == indicies.end())
+				indicies.push_back(index);
 
 		VkBufferCreateInfo buffer_info{};
 
 		buffer_info.sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		buffer_info.pNext                 = nullptr;
 		buffer_info.flags                 = 0;
-		buffer_info.size                  = a_size;                            // example: 1024 * 1024 * 2;        // 2kb
-		buffer_info.usage                 = a_usage;                           // example: VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT
-		buffer_info.sharingMode           = VK_SHARING_MODE_CONCURRENT;        // example: VK_SHARING_MODE_EXCLUSIVE; // TODO: Make this more variable, this has performance implications, not all resources are shared either
+		buffer_info.size                  = a_size;                                                                          // example: 1024 * 1024 * 2;        // 2kb
+		buffer_info.usage                 = a_usage;                                                                         // example: VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+		buffer_info.sharingMode           = indicies.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;        // TODO: Make this more variable, this has performance implications, not all resources are shared either
 		buffer_info.queueFamilyIndexCount = ror::static_cast_safe<uint32_t>(indicies.size());
 		buffer_info.pQueueFamilyIndices   = indicies.data();
 
@@ -1786,12 +2276,26 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 
 	void create_uniform_buffers()
 	{
-		VkDeviceSize buffer_size = sizeof(Uniforms);
+		VkDeviceSize palettes_size = this->m_astro_boy_animation.palettes().size() * ror::palette_stride(skinning_palette_format) * sizeof(float32_t);
+		VkDeviceSize instance_size = this->m_astro_boy_animation.instance_count() * sizeof(SkinnedInstance);
+		VkDeviceSize times_size    = this->m_astro_boy_animation.instance_count() * sizeof(ror::GpuAnimationInstance);
 
-		for (size_t i = 0; i < this->m_uniform_buffers.size(); i++)
+		this->m_uniform_ring.create(this->m_physical_device, this->m_device, this->m_memory_allocator, static_cast<uint32_t>(cfg::get_number_of_buffers()));
+		this->m_uniform_offsets.assign(cfg::get_number_of_buffers(), 0u);
+
+		for (size_t i = 0; i < this->m_palette_buffers.size(); i++)
 		{
-			this->m_uniform_buffers[i]        = this->create_buffer(buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-			this->m_uniform_buffers_memory[i] = this->allocate_bind_buffer_memory(this->m_uniform_buffers[i]);
+			this->m_palette_buffers[i]        = this->create_buffer(palettes_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+			this->m_palette_buffers_memory[i] = this->allocate_bind_buffer_memory(this->m_palette_buffers[i]);
+
+			this->m_instance_buffers[i]        = this->create_buffer(instance_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+			this->m_instance_buffers_memory[i] = this->allocate_bind_buffer_memory(this->m_instance_buffers[i]);
+
+			if (cfg::get_gpu_animation())
+			{
+				this->m_clip_time_buffers[i]        = this->create_buffer(times_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+				this->m_clip_time_buffers_memory[i] = this->allocate_bind_buffer_memory(this->m_clip_time_buffers[i]);
+			}
 		}
 	}
 
@@ -1800,7 +2304,7 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		// TODO: This is where you create a layout that works for everything like machinery or do something else
 		VkDescriptorSetLayoutBinding ubo_layout_binding{};
 		ubo_layout_binding.binding            = 0;        // This is the binding in the shader that is hardcoded at this stage
-		ubo_layout_binding.descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		ubo_layout_binding.descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		ubo_layout_binding.descriptorCount    = 1;
 		ubo_layout_binding.stageFlags         = VK_SHADER_STAGE_VERTEX_BIT;        // This should also be something like VK_SHADER_STAGE_ALL or VK_SHADER_STAGE_ALL_GRAPHICS to simplify things but might have perf implications
 		ubo_layout_binding.pImmutableSamplers = nullptr;                           // Optional for uniforms but required for images
@@ -1812,7 +2316,22 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		sampler_layout_binding.pImmutableSamplers = nullptr;
 		sampler_layout_binding.stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-		std::array<VkDescriptorSetLayoutBinding, 2> bindings{ubo_layout_binding, sampler_layout_binding};
+		// Skinned vertices at 2 and instances at 3 are pulled by the vertex shader
+		VkDescriptorSetLayoutBinding skinned_layout_binding{};
+		skinned_layout_binding.binding            = 2;
+		skinned_layout_binding.descriptorType     = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		skinned_layout_binding.descriptorCount    = 1;
+		skinned_layout_binding.pImmutableSamplers = nullptr;
+		skinned_layout_binding.stageFlags         = VK_SHADER_STAGE_VERTEX_BIT;
+
+		VkDescriptorSetLayoutBinding instance_layout_binding{skinned_layout_binding};
+		instance_layout_binding.binding = 3;
+
+		VkDescriptorSetLayoutBinding vertex_animation_layout_binding{sampler_layout_binding};
+		vertex_animation_layout_binding.binding    = 4;
+		vertex_animation_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+		std::array<VkDescriptorSetLayoutBinding, 5> bindings{ubo_layout_binding, sampler_layout_binding, skinned_layout_binding, instance_layout_binding, vertex_animation_layout_binding};
 
 		VkDescriptorSetLayoutCreateInfo layout_info{};
 		layout_info.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
@@ -1822,12 +2341,34 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		VkResult result = vkCreateDescriptorSetLayout(this->m_device, &layout_info, nullptr, &this->m_descriptor_set_layout);
 
 		assert(result == VK_SUCCESS && "Failed to create descriptor set layout");
+
+		// Skinning reads palettes at binding 0, positions and attributes at 1 and 2, instances at 4 and writes skinned vertices to 3
+		// Animation shares the set, it reads tables at 5 and clip times at 6 and writes palettes to 0
+		std::array<VkDescriptorSetLayoutBinding, 7> skinning_bindings{};
+		for (uint32_t binding = 0; binding < skinning_bindings.size(); ++binding)
+		{
+			skinning_bindings[binding].binding            = binding;
+			skinning_bindings[binding].descriptorType     = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			skinning_bindings[binding].descriptorCount    = 1;
+			skinning_bindings[binding].stageFlags         = VK_SHADER_STAGE_COMPUTE_BIT;
+			skinning_bindings[binding].pImmutableSamplers = nullptr;
+		}
+
+		layout_info.bindingCount = skinning_bindings.size();
+		layout_info.pBindings    = skinning_bindings.data();
+
+		result = vkCreateDescriptorSetLayout(this->m_device, &layout_info, nullptr, &this->m_skinning_descriptor_set_layout);
+
+		assert(result == VK_SUCCESS && "Failed to create skinning descriptor set layout");
 	}
 
 	void destroy_descriptor_set_layout()
 	{
 		vkDestroyDescriptorSetLayout(this->m_device, this->m_descriptor_set_layout, cfg::VkAllocator);
 		this->m_descriptor_set_layout = nullptr;
+
+		vkDestroyDescriptorSetLayout(this->m_device, this->m_skinning_descriptor_set_layout, cfg::VkAllocator);
+		this->m_skinning_descriptor_set_layout = nullptr;
 	}
 
 	void update_uniform_buffer(size_t a_index, bool a_animate)
@@ -1843,92 +2384,187 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 
 		model = model_matrix * translation * model;
 
-		Uniforms *uniform_data;
-		vkMapMemory(this->m_device, this->m_uniform_buffers_memory[a_index], 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void **>(&uniform_data));
+		// Same blocks in the same order every frame, so the offsets the command buffers were recorded with hold
+		this->m_uniform_ring.begin_frame(static_cast<uint32_t>(a_index));
+		Uniforms *uniform_data = this->m_uniform_ring.allocate<Uniforms>(this->m_uniform_offsets[a_index]);
+
+		// All palettes go out in one copy, instance i starts at i * joint_count joints
+		auto &skinning_matrices = this->animate(a_animate);
 
 		uniform_data->model           = model;
 		uniform_data->view_projection = ror::vulkan_clip_correction * view_projection;
+		uniform_data->time            = static_cast<float32_t>(this->m_animation_time);
+
+		const uint32_t instance_count = this->m_astro_boy_animation.instance_count();
+
+		if (cfg::get_gpu_animation())
+		{
+			ror::GpuAnimationInstance *clip_times = this->m_clip_time_buffers_memory[a_index].mapped<ror::GpuAnimationInstance>();
 
-		auto skinning_matrices = this->animate(a_animate);
-		memcpy(uniform_data->joints_matrices[0].m_values, skinning_matrices[0].m_values, 44 * sizeof(float) * 16);
+			for (uint32_t i = 0; i < instance_count; ++i)
+			{
+				const ror::ClipPlayer &player = this->m_astro_boy_animation.instance(i).m_layers[0].m_player;
+				clip_times[i]                 = ror::GpuAnimationInstance{player.time(), player.clip()};
+			}
+		}
+		else
+		{
+			float32_t *palette_data = this->m_palette_buffers_memory[a_index].mapped<float32_t>();
+			ror::palette_write(skinning_palette_format, skinning_matrices.data(), static_cast<uint32_t>(skinning_matrices.size()), palette_data);
+		}
+
+		const uint32_t  palette_vec4s = this->m_astro_boy_animation.joint_count() * ror::palette_stride(skinning_palette_format) / 4;
+		const float32_t spacing       = (this->m_astroboy_bbox.maximum() - this->m_astroboy_bbox.minimum()).x;
+
+		SkinnedInstance *instance_data = this->m_instance_buffers_memory[a_index].mapped<SkinnedInstance>();
 
-		vkUnmapMemory(this->m_device, this->m_uniform_buffers_memory[a_index]);
+		// Crowd stands in a row centered on the first character
+		for (uint32_t i = 0; i < instance_count; ++i)
+		{
+			float32_t offset = (static_cast<float32_t>(i) - static_cast<float32_t>(instance_count - 1) * 0.5f) * spacing;
+
+			instance_data[i].model          = ror::matrix4_translation(ror::Vector3f{offset, 0.0f, 0.0f});
+			instance_data[i].palette_offset = i * palette_vec4s;
+		}
+
+		// This image's skinned buffer was last read by the submit its fence covers, so it can be overwritten in place
+		if (cfg::get_cpu_skinning())
+		{
+			utl::CpuZone zone{"cpu skinning"};
+			this->skin_instances(skinning_matrices, this->m_skinned_vertex_buffers_memory[a_index].mapped<float32_t>());
+		}
+	}
+
+	// Same layout skinning.comp writes, position and normal per vertex, instance after instance
+	void skin_instances(const std::vector<ror::Matrix4f> &a_palettes, float32_t *a_out)
+	{
+		const ror::SkinningStreams streams{astro_boy_positions, astro_boy_normals, astro_boy_weights, astro_boy_joints, astro_boy_vertex_count};
+		const uint32_t             joint_count = this->m_astro_boy_animation.joint_count();
+
+		for (uint32_t i = 0; i < this->m_astro_boy_animation.instance_count(); ++i)
+			ror::skin_vertices(streams, a_palettes.data() + i * joint_count, a_out + static_cast<size_t>(i) * astro_boy_vertex_count * 6, this->m_animation_job_system);
 	}
 
 	void destroy_uniform_buffers()
 	{
-		for (size_t i = 0; i < this->m_uniform_buffers.size(); i++)
+		this->m_uniform_ring.destroy(this->m_memory_allocator);
+
+		for (size_t i = 0; i < this->m_palette_buffers.size(); i++)
 		{
-			vkDestroyBuffer(this->m_device, this->m_uniform_buffers[i], cfg::VkAllocator);
-			vkFreeMemory(this->m_device, this->m_uniform_buffers_memory[i], cfg::VkAllocator);
-			this->m_uniform_buffers[i]        = nullptr;
-			this->m_uniform_buffers_memory[i] = nullptr;
+			vkDestroyBuffer(this->m_device, this->m_palette_buffers[i], cfg::VkAllocator);
+			this->free_device_memory(this->m_palette_buffers_memory[i]);
+			this->m_palette_buffers[i] = nullptr;
+
+			vkDestroyBuffer(this->m_device, this->m_instance_buffers[i], cfg::VkAllocator);
+			this->free_device_memory(this->m_instance_buffers_memory[i]);
+			this->m_instance_buffers[i] = nullptr;
+
+			vkDestroyBuffer(this->m_device, this->m_clip_time_buffers[i], cfg::VkAllocator);
+			this->free_device_memory(this->m_clip_time_buffers_memory[i]);
+			this->m_clip_time_buffers[i] = nullptr;
 		}
 	}
 
-	auto begin_single_use_cmd_buffer()
+	// Command buffer of the open upload batch, goes to the GPU with the next flush_uploads()
+	VkCommandBuffer begin_upload()
 	{
-		VkCommandBufferAllocateInfo command_buffer_allocate_info{};
-		command_buffer_allocate_info.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		command_buffer_allocate_info.pNext              = nullptr;
-		command_buffer_allocate_info.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		command_buffer_allocate_info.commandPool        = this->m_transfer_command_pool;
-		command_buffer_allocate_info.commandBufferCount = 1;
-
-		VkCommandBuffer staging_command_buffer;
-		VkResult        result = vkAllocateCommandBuffers(this->m_device, &command_buffer_allocate_info, &staging_command_buffer);
-		assert(result == VK_SUCCESS);
-
-		VkCommandBufferBeginInfo command_buffer_begin_info{};
-		command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		bool            first    = !this->m_transfer_manager.recording();
+		VkCommandBuffer commands = this->m_transfer_manager.commands();
 
-		vkBeginCommandBuffer(staging_command_buffer, &command_buffer_begin_info);
+		// All batches share the immediate slot, so only one is profiled at a time
+		if (first && this->m_profile_uploads && this->m_profiled_upload == 0)
+		{
+			this->m_gpu_profiler.reset(commands, this->m_gpu_profiler.immediate_slot(), this->m_scope_upload, 1);
+			this->m_gpu_profiler.begin(commands, this->m_gpu_profiler.immediate_slot(), this->m_scope_upload);
+			this->m_upload_profiled = true;
+		}
 
-		return staging_command_buffer;
+		return commands;
 	}
 
-	void end_single_use_cmd_buffer(VkCommandBuffer a_command_buffer)
+	void flush_uploads()
 	{
-		vkEndCommandBuffer(a_command_buffer);
+		if (!this->m_transfer_manager.recording())
+			return;
 
-		VkSubmitInfo staging_submit_info{};
-		staging_submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		staging_submit_info.commandBufferCount = 1;
-		staging_submit_info.pCommandBuffers    = &a_command_buffer;
+		if (this->m_upload_profiled)
+			this->m_gpu_profiler.end(this->m_transfer_manager.commands(), this->m_gpu_profiler.immediate_slot(), this->m_scope_upload);
 
-		vkQueueSubmit(this->m_transfer_queue, 1, &staging_submit_info, VK_NULL_HANDLE);
-		vkQueueWaitIdle(this->m_transfer_queue);        // TODO: Should be improved in the future
+		uint64_t value = this->m_transfer_manager.flush();
 
-		vkFreeCommandBuffers(this->m_device, this->m_transfer_command_pool, 1, &a_command_buffer);
+		if (this->m_upload_profiled)
+		{
+			this->m_gpu_profiler.submitted(this->m_gpu_profiler.immediate_slot());
+			this->m_profiled_upload = value;
+			this->m_upload_profiled = false;
+		}
 	}
 
-	void copy_from_staging_buffers_to_buffers(std::vector<std::pair<VkBuffer, size_t>> &a_source, std::vector<VkBuffer> &a_destination)
+	// Frees finished upload batches and their staging buffers, never waits
+	void retire_uploads()
 	{
-		VkCommandBuffer staging_command_buffer = this->begin_single_use_cmd_buffer();
+		this->m_transfer_manager.retire();
+
+		if (this->m_profiled_upload != 0 && this->m_transfer_manager.completed(this->m_profiled_upload))
+		{
+			this->m_gpu_profiler.resolve(this->m_gpu_profiler.immediate_slot());
+			this->m_profiled_upload = 0;
+		}
+	}
 
-		if (a_source.size() != a_destination.size())
-			ror::log_critical("Copying from different size a_source to a_destination, something won't be copied correctly");
+	// Staging memory for the open upload batch, flushes and waits for older uploads if the pool is full
+	StagingRegion allocate_staging(VkDeviceSize a_size, VkDeviceSize a_alignment)
+	{
+		StagingRegion region{};
 
-		// TODO: Could be done in one go
-		for (size_t i = 0; i < a_source.size(); ++i)
+		if (!this->m_staging_pool.allocate(a_size, a_alignment, region))
 		{
-			VkBufferCopy buffer_image_copy_region{};
-			buffer_image_copy_region.srcOffset = 0;        // Optional
-			buffer_image_copy_region.dstOffset = 0;        // Optional
-			buffer_image_copy_region.size      = a_source[i].second;
+			utl::CpuZone zone{"staging wait"};
 
-			vkCmdCopyBuffer(staging_command_buffer, a_source[i].first, a_destination[i], 1, &buffer_image_copy_region);
+			this->flush_uploads();
+			this->m_transfer_manager.wait(this->m_transfer_manager.pending());
+			this->retire_uploads();
+
+			bool allocated = this->m_staging_pool.allocate(a_size, a_alignment, region);
+			assert(allocated && "Staging pool still full after all uploads retired");
+			(void) allocated;
 		}
 
-		this->end_single_use_cmd_buffer(staging_command_buffer);
+		// Recorded in the batch the copy out of it goes into, so it comes back when that batch retires
+		this->begin_upload();
+		this->m_transfer_manager.release([this, region]() { this->m_staging_pool.free(region); });
+
+		return region;
+	}
+
+	// Copies a_size bytes of a_data into a_buffer at a_offset, in chunks of at most cfg::get_staging_chunk_size()
+	void upload_buffer(VkBuffer a_buffer, const void *a_data, VkDeviceSize a_size, VkDeviceSize a_offset = 0)
+	{
+		const uint8_t *data = static_cast<const uint8_t *>(a_data);
+
+		for (VkDeviceSize done = 0; done < a_size;)
+		{
+			VkDeviceSize  chunk   = std::min(a_size - done, cfg::get_staging_chunk_size());
+			StagingRegion staging = this->allocate_staging(chunk, 16);
+
+			memcpy(staging.m_data, data + done, chunk);
+
+			VkBufferCopy buffer_copy_region{};
+			buffer_copy_region.srcOffset = staging.m_offset;
+			buffer_copy_region.dstOffset = a_offset + done;
+			buffer_copy_region.size      = chunk;
+
+			vkCmdCopyBuffer(this->begin_upload(), staging.m_buffer, a_buffer, 1, &buffer_copy_region);
+
+			done += chunk;
+		}
 	}
 
 	void transition_image_layout(VkImage a_image, VkFormat a_format, VkImageLayout a_old_layout, VkImageLayout a_new_layout, uint32_t a_mip_levels)
 	{
 		(void) a_format;
 
-		VkCommandBuffer command_buffer = this->begin_single_use_cmd_buffer();
+		VkCommandBuffer command_buffer = this->begin_upload();
 
 		VkPipelineStageFlags source_stage;
 		VkPipelineStageFlags destination_stage;
@@ -1958,11 +2594,12 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		}
 		else if (a_old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && a_new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
 		{
+			// Transfer queues may not know shader stages, the graphics queue waiting on the upload semaphore makes the writes visible
 			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.dstAccessMask = 0;
 
 			source_stage      = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			destination_stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 		}
 		else
 		{
@@ -1970,46 +2607,46 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		}
 
 		vkCmdPipelineBarrier(command_buffer, source_stage, destination_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-		this->end_single_use_cmd_buffer(command_buffer);
 	}
 
-	// This is taking std::vectors instead of VkBuffer and VkImage so that we only use single cmdbuffer
-	void copy_from_staging_buffers_to_images(std::vector<VkBuffer> &a_source, std::vector<VkImage> &a_destination, utl::TextureImage a_texture)
+	// Copies every mip of a_texture into a_image which has to be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+	// Mips bigger than a chunk go in bands of rows, block compressed bands stay whole rows of blocks
+	void upload_image(VkImage a_image, const utl::TextureImage &a_texture)
 	{
-		VkCommandBuffer staging_command_buffer = this->begin_single_use_cmd_buffer();
+		const uint32_t block_height = utl::format_block_height(a_texture.m_format);
 
-		if (a_source.size() != a_destination.size())
-			ror::log_critical("Copying from different size a_source to a_destination, something won't be copied correctly");
-
-		// TODO: Could this be done in one go?, i.e. remove this loop?
-		for (size_t i = 0; i < a_source.size(); ++i)
+		for (uint32_t mip = 0; mip < a_texture.m_mips.size(); ++mip)
 		{
-			std::vector<VkBufferImageCopy> buffer_image_copy_regions{};
+			const utl::TextureImage::Mipmap &mipmap = a_texture.m_mips[mip];
+
+			VkDeviceSize   mip_end    = mip + 1 < a_texture.m_mips.size() ? a_texture.m_mips[mip + 1].m_offset : a_texture.m_size;
+			VkDeviceSize   mip_size   = mip_end - mipmap.m_offset;
+			uint32_t       block_rows = (mipmap.m_height + block_height - 1) / block_height;
+			VkDeviceSize   row_size   = mip_size / block_rows;
+			uint32_t       band_rows  = static_cast<uint32_t>(std::max<VkDeviceSize>(cfg::get_staging_chunk_size() / row_size, 1));
+			const uint8_t *mip_data   = a_texture.m_data.data() + mipmap.m_offset;
 
-			for (uint32_t j = 0; j < a_texture.get_mip_levels(); j++)
+			for (uint32_t row = 0; row < block_rows; row += band_rows)
 			{
-				VkBufferImageCopy buffer_image_copy_region{};
+				uint32_t      rows    = std::min(band_rows, block_rows - row);
+				StagingRegion staging = this->allocate_staging(rows * row_size, 16);
 
-				buffer_image_copy_region.bufferRowLength   = 0;
-				buffer_image_copy_region.bufferImageHeight = 0;
+				memcpy(staging.m_data, mip_data + row * row_size, rows * row_size);
 
-				buffer_image_copy_region.bufferOffset                    = a_texture.m_mips[j].m_offset;
+				VkBufferImageCopy buffer_image_copy_region{};
+				buffer_image_copy_region.bufferOffset                    = staging.m_offset;
+				buffer_image_copy_region.bufferRowLength                 = 0;
+				buffer_image_copy_region.bufferImageHeight               = 0;
 				buffer_image_copy_region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-				buffer_image_copy_region.imageSubresource.mipLevel       = j;
+				buffer_image_copy_region.imageSubresource.mipLevel       = mip;
 				buffer_image_copy_region.imageSubresource.baseArrayLayer = 0;
 				buffer_image_copy_region.imageSubresource.layerCount     = 1;
-				buffer_image_copy_region.imageOffset                     = {0, 0, 0};
-				buffer_image_copy_region.imageExtent                     = {a_texture.m_mips[j].m_width, a_texture.m_mips[j].m_height, 1};
+				buffer_image_copy_region.imageOffset                     = {0, static_cast<int32_t>(row * block_height), 0};
+				buffer_image_copy_region.imageExtent                     = {mipmap.m_width, std::min(rows * block_height, mipmap.m_height - row * block_height), 1};
 
-				buffer_image_copy_regions.push_back(buffer_image_copy_region);
+				vkCmdCopyBufferToImage(this->begin_upload(), staging.m_buffer, a_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &buffer_image_copy_region);
 			}
-
-			vkCmdCopyBufferToImage(staging_command_buffer, a_source[i], a_destination[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			                       utl::static_cast_safe<uint32_t>(buffer_image_copy_regions.size()), buffer_image_copy_regions.data());
 		}
-
-		this->end_single_use_cmd_buffer(staging_command_buffer);
 	}
 
 	void create_vertex_buffers()
@@ -2022,76 +2659,257 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		constexpr size_t joints_buffer_size        = astro_boy_joints_array_count * sizeof(uint32_t);
 		constexpr size_t non_positions_buffer_size = normals_buffer_size + uvs_buffer_size + joints_buffer_size + weights_buffer_size;
 
-		std::vector<std::pair<VkBuffer, size_t>> staging_buffers{};
-		std::vector<VkDeviceMemory>              staging_buffers_memory{};
-		staging_buffers.resize(3);
-		staging_buffers_memory.resize(3);
+		this->m_vertex_buffers[0] = this->create_buffer(positions_buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		this->m_vertex_buffers[1] = this->create_buffer(non_positions_buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		this->m_index_buffer      = this->create_buffer(index_buffer_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+		this->m_vertex_buffer_memory[0] = this->allocate_bind_buffer_memory(this->m_vertex_buffers[0], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		this->m_vertex_buffer_memory[1] = this->allocate_bind_buffer_memory(this->m_vertex_buffers[1], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		this->m_index_buffer_memory     = this->allocate_bind_buffer_memory(this->m_index_buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		// Goes through the staging pool, non positions are normals, uvs, weights and joints back to back
+		this->upload_buffer(this->m_vertex_buffers[0], astro_boy_positions, positions_buffer_size);
+		this->upload_buffer(this->m_vertex_buffers[1], astro_boy_normals, normals_buffer_size);
+		this->upload_buffer(this->m_vertex_buffers[1], astro_boy_uvs, uvs_buffer_size, normals_buffer_size);
+		this->upload_buffer(this->m_vertex_buffers[1], astro_boy_weights, weights_buffer_size, normals_buffer_size + uvs_buffer_size);
+		this->upload_buffer(this->m_vertex_buffers[1], astro_boy_joints, joints_buffer_size, normals_buffer_size + uvs_buffer_size + weights_buffer_size);
+		this->upload_buffer(this->m_index_buffer, astro_boy_indices, index_buffer_size);
 
-		staging_buffers[0].first = this->create_buffer(positions_buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-		staging_buffers[1].first = this->create_buffer(non_positions_buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-		staging_buffers[2].first = this->create_buffer(index_buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+		this->m_astroboy_bbox.create_from_min_max(ror::Vector3f(astro_boy_bounding_box[0], astro_boy_bounding_box[1], astro_boy_bounding_box[2]),
+		                                          ror::Vector3f(astro_boy_bounding_box[3], astro_boy_bounding_box[4], astro_boy_bounding_box[5]));
 
-		staging_buffers[0].second = positions_buffer_size;
-		staging_buffers[1].second = non_positions_buffer_size;
-		staging_buffers[2].second = index_buffer_size;
+		ror::glfw_camera_visual_volume(this->m_astroboy_bbox.minimum(), this->m_astroboy_bbox.maximum());
+	}
 
-		staging_buffers_memory[0] = this->allocate_bind_buffer_memory(staging_buffers[0].first);        // default of VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-		staging_buffers_memory[1] = this->allocate_bind_buffer_memory(staging_buffers[1].first);        // default of VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-		staging_buffers_memory[2] = this->allocate_bind_buffer_memory(staging_buffers[2].first);        // default of VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+	void create_skinned_vertex_buffers()
+	{
+		const size_t skinned_buffer_size = astro_boy_vertex_count * sizeof(float32_t) * 6 * this->m_crowd_size;        // Position and normal per instance
 
-		uint8_t *position_data;
-		vkMapMemory(this->m_device, staging_buffers_memory[0], 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void **>(&position_data));
-		memcpy(position_data, astro_boy_positions, positions_buffer_size);        // Positions
-		vkUnmapMemory(this->m_device, staging_buffers_memory[0]);
+		// CPU skinning writes straight into the buffer the vertex shader pulls from
+		const VkMemoryPropertyFlags skinned_properties = cfg::get_cpu_skinning() ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 
-		uint8_t *non_position_data;
-		vkMapMemory(this->m_device, staging_buffers_memory[1], 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void **>(&non_position_data));
-		memcpy(non_position_data, astro_boy_normals, normals_buffer_size);        // Normals
+		for (size_t i = 0; i < cfg::get_number_of_buffers(); ++i)
+		{
+			this->m_skinned_vertex_buffers[i]        = this->create_buffer(skinned_buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+			this->m_skinned_vertex_buffers_memory[i] = this->allocate_bind_buffer_memory(this->m_skinned_vertex_buffers[i], skinned_properties);
+		}
+	}
 
-		non_position_data += normals_buffer_size;
-		memcpy(non_position_data, astro_boy_uvs, uvs_buffer_size);        // UVs
+	void destroy_skinned_vertex_buffers()
+	{
+		for (size_t i = 0; i < cfg::get_number_of_buffers(); ++i)
+		{
+			vkDestroyBuffer(this->m_device, this->m_skinned_vertex_buffers[i], cfg::VkAllocator);
+			this->free_device_memory(this->m_skinned_vertex_buffers_memory[i]);
 
-		non_position_data += uvs_buffer_size;
-		memcpy(non_position_data, astro_boy_weights, weights_buffer_size);        // Weights
+			this->m_skinned_vertex_buffers[i] = nullptr;
+		}
+	}
 
-		non_position_data += weights_buffer_size;
-		memcpy(non_position_data, astro_boy_joints, joints_buffer_size);        // JoinIds
+	void create_skinning_pipeline()
+	{
+		VkShaderModule compute_shader_module = this->create_shader_module("assets/shaders/skinning.comp.spv");
 
-		vkUnmapMemory(this->m_device, staging_buffers_memory[1]);
+		uint32_t palette_format = static_cast<uint32_t>(skinning_palette_format);
 
-		uint8_t *index_data;
-		vkMapMemory(this->m_device, staging_buffers_memory[2], 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void **>(&index_data));
-		memcpy(index_data, astro_boy_indices, index_buffer_size);        // Indices
+		VkSpecializationMapEntry palette_format_entry{};
+		palette_format_entry.constantID = 0;
+		palette_format_entry.offset     = 0;
+		palette_format_entry.size       = sizeof(uint32_t);
 
-		vkUnmapMemory(this->m_device, staging_buffers_memory[2]);
+		VkSpecializationInfo specialization_info{};
+		specialization_info.mapEntryCount = 1;
+		specialization_info.pMapEntries   = &palette_format_entry;
+		specialization_info.dataSize      = sizeof(uint32_t);
+		specialization_info.pData         = &palette_format;
 
-		// Here copy from staging buffers into vbo and ibo
-		this->m_vertex_buffers[0] = this->create_buffer(positions_buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
-		this->m_vertex_buffers[1] = this->create_buffer(non_positions_buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
-		this->m_index_buffer      = this->create_buffer(index_buffer_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		VkPipelineShaderStageCreateInfo compute_shader_stage_info = {};
+		compute_shader_stage_info.sType                           = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		compute_shader_stage_info.pNext                           = nullptr;
+		compute_shader_stage_info.flags                           = 0;
+		compute_shader_stage_info.stage                           = VK_SHADER_STAGE_COMPUTE_BIT;
+		compute_shader_stage_info.module                          = compute_shader_module;
+		compute_shader_stage_info.pName                           = "main";
+		compute_shader_stage_info.pSpecializationInfo             = &specialization_info;
 
-		this->m_vertex_buffer_memory[0] = this->allocate_bind_buffer_memory(this->m_vertex_buffers[0], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		this->m_vertex_buffer_memory[1] = this->allocate_bind_buffer_memory(this->m_vertex_buffers[1], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		this->m_index_buffer_memory     = this->allocate_bind_buffer_memory(this->m_index_buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		VkPushConstantRange push_constant_range{};
+		push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		push_constant_range.offset     = 0;
+		push_constant_range.size       = sizeof(SkinningLayout);
+
+		VkPipelineLayoutCreateInfo pipeline_layout_info = {};
+		pipeline_layout_info.sType                      = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipeline_layout_info.pNext                      = nullptr;
+		pipeline_layout_info.flags                      = 0;
+		pipeline_layout_info.setLayoutCount             = 1;
+		pipeline_layout_info.pSetLayouts                = &this->m_skinning_descriptor_set_layout;
+		pipeline_layout_info.pushConstantRangeCount     = 1;
+		pipeline_layout_info.pPushConstantRanges        = &push_constant_range;
 
-		std::vector<VkBuffer> astro_boy_buffers{this->m_vertex_buffers[0], this->m_vertex_buffers[1], this->m_index_buffer};
+		VkResult result = vkCreatePipelineLayout(this->m_device, &pipeline_layout_info, cfg::VkAllocator, &this->m_skinning_pipeline_layout);
+		assert(result == VK_SUCCESS);
+
+		VkComputePipelineCreateInfo compute_pipeline_create_info = {};
+		compute_pipeline_create_info.sType                       = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		compute_pipeline_create_info.pNext                       = nullptr;
+		compute_pipeline_create_info.flags                       = 0;
+		compute_pipeline_create_info.stage                       = compute_shader_stage_info;
+		compute_pipeline_create_info.layout                      = this->m_skinning_pipeline_layout;
+		compute_pipeline_create_info.basePipelineHandle          = VK_NULL_HANDLE;
+		compute_pipeline_create_info.basePipelineIndex           = -1;
+
+		result = vkCreateComputePipelines(this->m_device, this->m_pipeline_cache, 1, &compute_pipeline_create_info, cfg::VkAllocator, &this->m_skinning_pipeline);
+		assert(result == VK_SUCCESS);
 
-		this->copy_from_staging_buffers_to_buffers(staging_buffers, astro_boy_buffers);
+		vkDestroyShaderModule(this->m_device, compute_shader_module, cfg::VkAllocator);
 
-		// Cleanup staging buffers
-		for (size_t i = 0; i < staging_buffers.size(); ++i)
+		// Same layout and palette format, animation.comp just ignores the push constants
+		if (cfg::get_gpu_animation())
 		{
-			vkDestroyBuffer(this->m_device, staging_buffers[i].first, cfg::VkAllocator);
-			vkFreeMemory(this->m_device, staging_buffers_memory[i], cfg::VkAllocator);
+			VkShaderModule animation_shader_module = this->create_shader_module("assets/shaders/animation.comp.spv");
 
-			staging_buffers[i].first  = nullptr;
-			staging_buffers_memory[i] = nullptr;
+			compute_pipeline_create_info.stage.module = animation_shader_module;
+
+			result = vkCreateComputePipelines(this->m_device, this->m_pipeline_cache, 1, &compute_pipeline_create_info, cfg::VkAllocator, &this->m_animation_pipeline);
+			assert(result == VK_SUCCESS);
+
+			vkDestroyShaderModule(this->m_device, animation_shader_module, cfg::VkAllocator);
 		}
+	}
 
-		this->m_astroboy_bbox.create_from_min_max(ror::Vector3f(astro_boy_bounding_box[0], astro_boy_bounding_box[1], astro_boy_bounding_box[2]),
-		                                          ror::Vector3f(astro_boy_bounding_box[3], astro_boy_bounding_box[4], astro_boy_bounding_box[5]));
+	void destroy_skinning_pipeline()
+	{
+		vkDestroyPipelineLayout(this->m_device, this->m_skinning_pipeline_layout, cfg::VkAllocator);
+		this->m_skinning_pipeline_layout = nullptr;
 
-		ror::glfw_camera_visual_volume(this->m_astroboy_bbox.minimum(), this->m_astroboy_bbox.maximum());
+		vkDestroyPipeline(this->m_device, this->m_skinning_pipeline, cfg::VkAllocator);
+		this->m_skinning_pipeline = nullptr;
+
+		vkDestroyPipeline(this->m_device, this->m_animation_pipeline, cfg::VkAllocator);
+		this->m_animation_pipeline = nullptr;
+	}
+
+	// Skinning doesn't depend on the swapchain so these are recorded once and resubmitted every frame
+	void record_skinning_command_buffers()
+	{
+		this->m_compute_command_buffers.resize(cfg::get_number_of_buffers());
+
+		VkCommandBufferAllocateInfo command_buffer_allocation_info = {};
+		command_buffer_allocation_info.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		command_buffer_allocation_info.pNext                       = nullptr;
+		command_buffer_allocation_info.commandPool                 = this->m_compute_command_pool;
+		command_buffer_allocation_info.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		command_buffer_allocation_info.commandBufferCount          = static_cast<uint32_t>(this->m_compute_command_buffers.size());
+
+		VkResult result = vkAllocateCommandBuffers(this->m_device, &command_buffer_allocation_info, this->m_compute_command_buffers.data());
+		assert(result == VK_SUCCESS);
+
+		SkinningLayout skinning_layout{};
+		skinning_layout.vertex_count     = astro_boy_vertex_count;
+		skinning_layout.normals_offset   = 0;
+		skinning_layout.weights_offset   = astro_boy_normals_array_count + astro_boy_uvs_array_count;
+		skinning_layout.joint_ids_offset = astro_boy_normals_array_count + astro_boy_uvs_array_count + astro_boy_weights_array_count;
+
+		for (size_t i = 0; i < this->m_compute_command_buffers.size(); i++)
+		{
+			const VkCommandBuffer &current_command_buffer = this->m_compute_command_buffers[i];
+
+			VkCommandBufferBeginInfo command_buffer_begin_info = {};
+			command_buffer_begin_info.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			command_buffer_begin_info.pNext                    = nullptr;
+			command_buffer_begin_info.flags                    = 0;
+			command_buffer_begin_info.pInheritanceInfo         = nullptr;
+
+			result = vkBeginCommandBuffer(current_command_buffer, &command_buffer_begin_info);
+			assert(result == VK_SUCCESS);
+
+			const uint32_t slot = static_cast<uint32_t>(i);
+
+			this->m_gpu_profiler.reset(current_command_buffer, slot, this->m_scope_animation, 2);
+
+			vkCmdBindDescriptorSets(current_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->m_skinning_pipeline_layout, 0, 1, &this->m_skinning_descriptor_sets[i], 0, nullptr);
+
+			if (this->m_animation_pipeline)
+			{
+				vkCmdBindPipeline(current_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->m_animation_pipeline);
+				this->m_gpu_profiler.begin(current_command_buffer, slot, this->m_scope_animation);
+				vkCmdDispatch(current_command_buffer, this->m_astro_boy_animation.instance_count(), 1, 1);
+				this->m_gpu_profiler.end(current_command_buffer, slot, this->m_scope_animation);
+
+				// Palettes written above are read by skinning below
+				VkMemoryBarrier palette_barrier{};
+				palette_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+				palette_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+				palette_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+				vkCmdPipelineBarrier(current_command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &palette_barrier, 0, nullptr, 0, nullptr);
+			}
+
+			// With CPU skinning the submit still signals the semaphore the graphics submit waits on, it just has no work
+			if (!cfg::get_cpu_skinning())
+			{
+				vkCmdBindPipeline(current_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->m_skinning_pipeline);
+				vkCmdPushConstants(current_command_buffer, this->m_skinning_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SkinningLayout), &skinning_layout);
+
+				// The semaphore the graphics submit waits on makes these writes visible to vertex input, no barrier needed here
+				this->m_gpu_profiler.begin(current_command_buffer, slot, this->m_scope_skinning);
+				vkCmdDispatch(current_command_buffer, (astro_boy_vertex_count + skinning_group_size - 1) / skinning_group_size, this->m_astro_boy_animation.instance_count(), 1);
+				this->m_gpu_profiler.end(current_command_buffer, slot, this->m_scope_skinning);
+			}
+
+			result = vkEndCommandBuffer(current_command_buffer);
+			assert(result == VK_SUCCESS);
+		}
+	}
+
+	void create_skeletons()
+	{
+		// Generated with AnimationConverter astro_boy assets/astroboy/astro_boy.vean
+		if (!this->m_astro_boy_asset.load("assets/astroboy/astro_boy.vean") || this->m_astro_boy_asset.clip_count() == 0)
+			throw std::runtime_error("Failed to load astro boy animation asset!");
+
+		this->m_astro_boy_animation = ror::AnimationSystem{this->m_astro_boy_asset.skeleton(), {this->m_astro_boy_asset.clip(0)}, this->m_animation_job_system};
+
+		// Staggered instances never land on the same clip time, so sharing would only cost the grouping
+		ror::AnimationLodPolicy lod_policy{};
+		lod_policy.m_share_quantum = 0.0f;
+		this->m_astro_boy_animation.set_lod_policy(lod_policy);
+
+		// Staggered so the crowd doesn't move in lockstep
+		for (uint32_t i = 0; i < this->m_crowd_size; ++i)
+			this->m_astro_boy_animation.add_instance(0, static_cast<float32_t>(i) * 0.25f);
+
+		assert(ror::verify_matrix_kernels() && "Matrix kernels don't match the scalar reference");
+		assert(ror::verify_skinning_kernels() && "Skinning kernels don't match the scalar reference");
+
+		ror::log_info("Using {} matrix kernels for pose evaluation", ror::matrix_kernel_name(ror::matrix_kernel_best_path()));
+		ror::log_info("Uploading {} skinning palettes for {} characters, {} bytes per frame", ror::palette_format_name(skinning_palette_format), this->m_astro_boy_animation.instance_count(),
+		              this->m_astro_boy_animation.palettes().size() * ror::palette_stride(skinning_palette_format) * sizeof(float32_t));
+		ror::log_info("Astro boy clip mapped with {} bytes and {} keys", this->m_astro_boy_asset.clip(0).size_in_bytes(), this->m_astro_boy_asset.clip(0).m_keys.size());
+	}
+
+	// Skeleton and clips for animation.comp, uploaded once to device local memory
+	void create_animation_tables()
+	{
+		if (!cfg::get_gpu_animation())
+			return;
+
+		ror::GpuAnimationTables tables = ror::build_gpu_animation_tables(this->m_astro_boy_asset.skeleton(), {this->m_astro_boy_asset.clip(0)});
+
+		this->m_animation_tables_buffer        = this->create_buffer(tables.size_in_bytes(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		this->m_animation_tables_buffer_memory = this->allocate_bind_buffer_memory(this->m_animation_tables_buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		this->upload_buffer(this->m_animation_tables_buffer, tables.m_words.data(), tables.size_in_bytes());
+
+		ror::log_info("Animating {} characters on the GPU from {} bytes of animation tables", this->m_astro_boy_animation.instance_count(), tables.size_in_bytes());
+	}
+
+	void destroy_animation_tables()
+	{
+		vkDestroyBuffer(this->m_device, this->m_animation_tables_buffer, cfg::VkAllocator);
+		this->free_device_memory(this->m_animation_tables_buffer_memory);
+
+		this->m_animation_tables_buffer = nullptr;
 	}
 
 	void destroy_buffers()
@@ -2100,17 +2918,21 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		vkDestroyBuffer(this->m_device, this->m_vertex_buffers[1], cfg::VkAllocator);
 		vkDestroyBuffer(this->m_device, this->m_index_buffer, cfg::VkAllocator);
 
-		vkFreeMemory(this->m_device, this->m_vertex_buffer_memory[0], cfg::VkAllocator);
-		vkFreeMemory(this->m_device, this->m_vertex_buffer_memory[1], cfg::VkAllocator);
-		vkFreeMemory(this->m_device, this->m_index_buffer_memory, cfg::VkAllocator);
+		this->free_device_memory(this->m_vertex_buffer_memory[0]);
+		this->free_device_memory(this->m_vertex_buffer_memory[1]);
+		this->free_device_memory(this->m_index_buffer_memory);
 
 		this->m_vertex_buffers[0] = nullptr;
 		this->m_vertex_buffers[1] = nullptr;
 		this->m_index_buffer      = nullptr;
 	}
 
-	VkImage create_image(uint32_t a_width, uint32_t a_height, VkFormat a_format, VkImageTiling a_tiling, VkImageUsageFlags a_usage, uint32_t a_mip_levels, VkSampleCountFlagBits a_samples_count = VK_SAMPLE_COUNT_1_BIT)
+	// a_uploaded images are written on the transfer queue and read on graphics, they are concurrent if those families differ
+	VkImage create_image(uint32_t a_width, uint32_t a_height, VkFormat a_format, VkImageTiling a_tiling, VkImageUsageFlags a_usage, uint32_t a_mip_levels, VkSampleCountFlagBits a_samples_count = VK_SAMPLE_COUNT_1_BIT, bool a_uploaded = false)
 	{
+		std::array<uint32_t, 2> indicies{this->m_graphics_queue_index, this->m_transfer_queue_index};
+		bool                    concurrent = a_uploaded && indicies[0] != indicies[1];
+
 		VkImageCreateInfo image_info{};
 		image_info.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		image_info.imageType     = VK_IMAGE_TYPE_2D;
@@ -2124,9 +2946,12 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		image_info.usage         = a_usage;
 		image_info.samples       = a_samples_count;        // VK_SAMPLE_COUNT_1_BIT;
-		image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
 		image_info.flags         = 0;        // Optional
 
+		image_info.sharingMode           = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+		image_info.queueFamilyIndexCount = concurrent ? 2u : 0u;
+		image_info.pQueueFamilyIndices   = concurrent ? indicies.data() : nullptr;
+
 		VkImage  image;
 		VkResult result = vkCreateImage(this->m_device, &image_info, nullptr, &image);
 		assert(result == VK_SUCCESS);
@@ -2139,25 +2964,18 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		vkDestroyImage(this->m_device, a_image, cfg::VkAllocator);
 	}
 
-	// TODO: This and allocate_bind_buffer_memory() should be one function
-	auto allocate_bind_image_memory(VkImage a_image, VkMemoryPropertyFlags a_properties)
+	// Resets a_memory so freeing twice is harmless
+	void free_device_memory(MemoryAllocation &a_memory)
 	{
-		VkMemoryRequirements image_mem_requirements;
-		vkGetImageMemoryRequirements(this->m_device, a_image, &image_mem_requirements);
-
-		VkMemoryAllocateInfo allocation_info{};
-		allocation_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocation_info.pNext           = nullptr;
-		allocation_info.allocationSize  = image_mem_requirements.size;
-		allocation_info.memoryTypeIndex = find_memory_type(image_mem_requirements.memoryTypeBits, a_properties);
-
-		VkDeviceMemory image_memory;
-		VkResult       result = vkAllocateMemory(this->m_device, &allocation_info, cfg::VkAllocator, &image_memory);
-		assert(result == VK_SUCCESS && "Failed to allocate vulkan image memory!");
-		assert(image_memory);
+		this->m_memory_allocator.free(a_memory);
+	}
 
-		result = vkBindImageMemory(this->m_device, a_image, image_memory, 0);
+	// a_dedicated gives the image its own allocation, use it for render targets
+	auto allocate_bind_image_memory(VkImage a_image, VkMemoryPropertyFlags a_properties, bool a_dedicated = false)
+	{
+		MemoryAllocation image_memory = this->m_memory_allocator.allocate_image(a_image, a_properties, a_dedicated);
 
+		VkResult result = vkBindImageMemory(this->m_device, a_image, image_memory.m_memory, image_memory.m_offset);
 		assert(result == VK_SUCCESS && "Failed to bind vulkan image memory!");
 
 		return image_memory;
@@ -2168,35 +2986,79 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		utl::TextureImage texture = utl::read_texture_from_file("./assets/astroboy/astro_boy_uastc.ktx2");
 		// Texture texture = utl::read_texture_from_file("./assets/astroboy/astro_boy.jpg");
 
-		VkBuffer       staging_buffer{};
-		VkDeviceMemory staging_buffer_memory{};
-
-		staging_buffer        = this->create_buffer(texture.m_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-		staging_buffer_memory = this->allocate_bind_buffer_memory(staging_buffer);
-
-		uint8_t *texture_data;
-		vkMapMemory(this->m_device, staging_buffer_memory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void **>(&texture_data));
-		memcpy(texture_data, texture.m_data.data(), texture.m_size);
-		vkUnmapMemory(this->m_device, staging_buffer_memory);
-
-		this->m_texture_image        = this->create_image(texture.get_width(), texture.get_height(), texture.get_format(), VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, texture.get_mip_levels());
+		this->m_texture_image        = this->create_image(texture.get_width(), texture.get_height(), texture.get_format(), VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, texture.get_mip_levels(), VK_SAMPLE_COUNT_1_BIT, true);
 		this->m_texture_image_memory = this->allocate_bind_image_memory(this->m_texture_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 		this->m_texture_image_view   = this->create_image_view(this->m_texture_image, texture.get_format(), VK_IMAGE_ASPECT_COLOR_BIT, texture.get_mip_levels());
 
-		std::vector<VkImage>  texture_images{this->m_texture_image};
-		std::vector<VkBuffer> source_textures{staging_buffer};
-
 		this->transition_image_layout(this->m_texture_image, texture.get_format(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture.get_mip_levels());
-		this->copy_from_staging_buffers_to_images(source_textures, texture_images, texture);
+		this->upload_image(this->m_texture_image, texture);
 		this->transition_image_layout(this->m_texture_image, texture.get_format(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, texture.get_mip_levels());
 		this->create_texture_sampler(static_cast<float32_t>(texture.get_mip_levels()));
+	}
 
-		// Cleanup staging buffers
-		vkDestroyBuffer(this->m_device, staging_buffer, cfg::VkAllocator);
-		vkFreeMemory(this->m_device, staging_buffer_memory, cfg::VkAllocator);
+	void create_vertex_animation_texture()
+	{
+		if (cfg::get_vat_crowd_size() == 0)
+			return;
 
-		staging_buffer        = nullptr;
-		staging_buffer_memory = nullptr;
+		ror::SkinningStreams streams{astro_boy_positions, astro_boy_normals, astro_boy_weights, astro_boy_joints, astro_boy_vertex_count};
+		this->m_vertex_animation = ror::bake_vertex_animation(this->m_astro_boy_asset.skeleton(), this->m_astro_boy_asset.clip(0), streams, this->m_animation_job_system);
+
+		ror::log_info("Baked {} frames of astro boy into a {}x{} vertex animation texture of {} bytes", this->m_vertex_animation.m_frame_count,
+		              this->m_vertex_animation.m_width, this->m_vertex_animation.m_height, this->m_vertex_animation.size_in_bytes());
+
+		// Goes through the same upload path as any other single mip texture
+		utl::TextureImage texture;
+		texture.allocate(this->m_vertex_animation.size_in_bytes());
+		memcpy(texture.m_data.data(), this->m_vertex_animation.m_texels.data(), texture.m_size);
+		texture.m_format = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+		utl::TextureImage::Mipmap mip0;
+		mip0.m_width  = this->m_vertex_animation.m_width;
+		mip0.m_height = this->m_vertex_animation.m_height;
+		texture.m_mips.emplace_back(mip0);
+
+		this->m_vertex_animation.m_texels = std::vector<uint16_t>{};        // Only the layout is needed from here on
+
+		this->m_vat_image        = this->create_image(texture.get_width(), texture.get_height(), texture.get_format(), VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 1, VK_SAMPLE_COUNT_1_BIT, true);
+		this->m_vat_image_memory = this->allocate_bind_image_memory(this->m_vat_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		this->m_vat_image_view   = this->create_image_view(this->m_vat_image, texture.get_format(), VK_IMAGE_ASPECT_COLOR_BIT, 1);
+
+		this->transition_image_layout(this->m_vat_image, texture.get_format(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1);
+		this->upload_image(this->m_vat_image, texture);
+		this->transition_image_layout(this->m_vat_image, texture.get_format(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+
+		// Crowd stands on a grid behind the skinned characters, +y in model space is away from the camera
+		const uint32_t  crowd_size = cfg::get_vat_crowd_size();
+		const uint32_t  columns    = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float32_t>(crowd_size))));
+		const float32_t spacing    = (this->m_astroboy_bbox.maximum() - this->m_astroboy_bbox.minimum()).x;
+		const float32_t duration   = static_cast<float32_t>(this->m_vertex_animation.m_frame_count) / this->m_vertex_animation.m_frames_per_second;
+
+		this->m_vat_instance_buffer        = this->create_buffer(crowd_size * sizeof(float32_t) * 4, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		this->m_vat_instance_buffer_memory = this->allocate_bind_buffer_memory(this->m_vat_instance_buffer);
+
+		float32_t *placements = this->m_vat_instance_buffer_memory.mapped<float32_t>();
+
+		for (uint32_t i = 0; i < crowd_size; ++i, placements += 4)
+		{
+			placements[0] = (static_cast<float32_t>(i % columns) - static_cast<float32_t>(columns - 1) * 0.5f) * spacing;
+			placements[1] = static_cast<float32_t>(i / columns + 1) * spacing;
+			placements[2] = 0.0f;
+			placements[3] = std::fmod(static_cast<float32_t>(i) * 0.618034f, 1.0f) * duration;        // Golden ratio spreads start times evenly
+		}
+	}
+
+	void destroy_vertex_animation_texture()
+	{
+		vkDestroyBuffer(this->m_device, this->m_vat_instance_buffer, cfg::VkAllocator);
+		this->free_device_memory(this->m_vat_instance_buffer_memory);
+		this->m_vat_instance_buffer = nullptr;
+
+		vkDestroyImageView(this->m_device, this->m_vat_image_view, cfg::VkAllocator);
+		vkDestroyImage(this->m_device, this->m_vat_image, cfg::VkAllocator);
+		this->free_device_memory(this->m_vat_image_memory);
+		this->m_vat_image_view = nullptr;
+		this->m_vat_image      = nullptr;
 	}
 
 	void destroy_texture()
@@ -2204,7 +3066,7 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 		vkDestroyImageView(this->m_device, this->m_texture_image_view, cfg::VkAllocator);
 
 		this->destroy_image(this->m_texture_image);
-		vkFreeMemory(this->m_device, this->m_texture_image_memory, cfg::VkAllocator);
+		this->free_device_memory(this->m_texture_image_memory);
 	}
 
 	void create_texture_sampler(float a_mip_levels)
@@ -2271,6 +3133,12 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 
 	void destroy_swapchain()
 	{
+		if (this->headless())
+		{
+			this->destroy_offscreen_images();
+			return;
+		}
+
 		vkDestroySwapchainKHR(this->m_device, this->m_swapchain, cfg::VkAllocator);
 		this->m_swapchain = nullptr;
 	}
@@ -2352,7 +3220,7 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 
 		VkFormat depth_format      = VK_FORMAT_D24_UNORM_S8_UINT;        // TODO: Make more generic and flexible
 		this->m_depth_image        = this->create_image(this->m_swapchain_extent.width, this->m_swapchain_extent.height, VK_FORMAT_D24_UNORM_S8_UINT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 1, samples);
-		this->m_depth_image_memory = this->allocate_bind_image_memory(this->m_depth_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		this->m_depth_image_memory = this->allocate_bind_image_memory(this->m_depth_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
 		this->m_depth_image_view   = this->create_image_view(this->m_depth_image, depth_format, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 	}
 
@@ -2363,7 +3231,7 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 
 		this->m_msaa_color_image        = this->create_image(this->m_swapchain_extent.width, this->m_swapchain_extent.height, this->m_swapchain_format, VK_IMAGE_TILING_OPTIMAL,
 		                                                     VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 1, samples);
-		this->m_msaa_color_image_memory = this->allocate_bind_image_memory(this->m_msaa_color_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		this->m_msaa_color_image_memory = this->allocate_bind_image_memory(this->m_msaa_color_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
 		this->m_msaa_color_image_view   = this->create_image_view(this->m_msaa_color_image, this->m_swapchain_format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 	}
 
@@ -2371,74 +3239,118 @@ class PhysicalDevice : public VulkanObject<VkPhysicalDevice>
 	{
 		this->destroy_image(this->m_msaa_color_image);
 		this->destroy_imageview(this->m_msaa_color_image_view);
-		vkFreeMemory(this->m_device, this->m_msaa_color_image_memory, cfg::VkAllocator);
+		this->free_device_memory(this->m_msaa_color_image_memory);
 	}
 
 	void destroy_depth_buffer()
 	{
 		this->destroy_image(this->m_depth_image);
 		this->destroy_imageview(this->m_depth_image_view);
-		vkFreeMemory(this->m_device, this->m_depth_image_memory, cfg::VkAllocator);
-	}
-
-	VkInstance                   m_instance{nullptr};               // Alias
-	VkPhysicalDevice             m_physical_device{nullptr};        // TODO: This is not required, its already in handle, change will finalize the name of the class
-	VkDevice                     m_device{nullptr};
-	VkSurfaceKHR                 m_surface{nullptr};
-	VkPhysicalDeviceFeatures     m_physical_device_features{};
-	VkPhysicalDeviceProperties   m_physical_device_properties;
-	uint32_t                     m_graphics_queue_index{0};
-	uint32_t                     m_present_queue_index{0};
-	uint32_t                     m_transfer_queue_index{0};
-	uint32_t                     m_compute_queue_index{0};
-	VkQueue                      m_graphics_queue{nullptr};
-	VkQueue                      m_compute_queue{nullptr};
-	VkQueue                      m_transfer_queue{nullptr};
-	VkQueue                      m_present_queue{nullptr};
-	VkQueue                      m_sparse_queue{nullptr};
-	VkQueue                      m_protected_queue{nullptr};
-	std::vector<VkImage>         m_swapchain_images;
-	std::vector<VkImageView>     m_swapchain_image_views;
-	std::vector<VkFramebuffer>   m_framebuffers;
-	std::vector<VkCommandBuffer> m_graphics_command_buffers;
-	std::vector<VkCommandBuffer> m_compute_command_buffers;
-	std::vector<VkCommandBuffer> m_transfer_command_buffers;
-	VkSwapchainKHR               m_swapchain{nullptr};
-	VkFormat                     m_swapchain_format{VK_FORMAT_B8G8R8A8_SRGB};
-	VkExtent2D                   m_swapchain_extent{1024, 800};
-	VkPipeline                   m_graphics_pipeline{nullptr};
-	VkPipelineLayout             m_pipeline_layout{nullptr};
-	VkDescriptorSetLayout        m_descriptor_set_layout{nullptr};
-	VkDescriptorPool             m_descriptor_pool{nullptr};
-	std::vector<VkDescriptorSet> m_descriptor_sets{cfg::get_number_of_buffers()};
-	VkPipelineCache              m_pipeline_cache{nullptr};
-	VkRenderPass                 m_render_pass{nullptr};
+		this->free_device_memory(this->m_depth_image_memory);
+	}
+
+	VkInstance                    m_instance{nullptr};               // Alias
+	VkPhysicalDevice              m_physical_device{nullptr};        // TODO: This is not required, its already in handle, change will finalize the name of the class
+	VkDevice                      m_device{nullptr};
+	VkSurfaceKHR                  m_surface{nullptr};
+	VkPhysicalDeviceFeatures      m_physical_device_features{};
+	VkPhysicalDeviceProperties    m_physical_device_properties;
+	uint32_t                      m_graphics_queue_index{0};
+	uint32_t                      m_present_queue_index{0};
+	uint32_t                      m_transfer_queue_index{0};
+	uint32_t                      m_compute_queue_index{0};
+	VkQueue                       m_graphics_queue{nullptr};
+	VkQueue                       m_compute_queue{nullptr};
+	VkQueue                       m_transfer_queue{nullptr};
+	VkQueue                       m_present_queue{nullptr};
+	VkQueue                       m_sparse_queue{nullptr};
+	VkQueue                       m_protected_queue{nullptr};
+	std::vector<VkImage>          m_swapchain_images;                                            // Owned by the swapchain, or offscreen images when headless
+	std::vector<MemoryAllocation> m_offscreen_images_memory;                                     // Only used headless
+	std::vector<VkImageView>      m_swapchain_image_views;
+	std::vector<VkFramebuffer>    m_framebuffers;
+	std::vector<VkCommandBuffer>  m_graphics_command_buffers;
+	std::vector<VkCommandBuffer>  m_compute_command_buffers;
+	std::vector<VkCommandBuffer>  m_transfer_command_buffers;
+	VkSwapchainKHR                m_swapchain{nullptr};
+	VkFormat                      m_swapchain_format{VK_FORMAT_B8G8R8A8_SRGB};
+	VkExtent2D                    m_swapchain_extent{1024, 800};
+	VkPipeline                    m_graphics_pipeline{nullptr};
+	VkPipelineLayout              m_pipeline_layout{nullptr};
+	VkDescriptorSetLayout         m_descriptor_set_layout{nullptr};
+	VkDescriptorPool              m_descriptor_pool{nullptr};
+	std::vector<VkDescriptorSet>  m_descriptor_sets{cfg::get_number_of_buffers()};
+	VkPipelineCache               m_pipeline_cache{nullptr};
+	VkRenderPass                  m_render_pass{nullptr};
 	void                        *m_window{nullptr};        // Window type that can be glfw or nullptr
-	VkCommandPool                m_graphics_command_pool{nullptr};
-	VkCommandPool                m_transfer_command_pool{nullptr};
-	VkSemaphore                  m_image_available_semaphore[cfg::get_number_of_buffers()];
-	VkSemaphore                  m_render_finished_semaphore[cfg::get_number_of_buffers()];
-	VkFence                      m_queue_fence[cfg::get_number_of_buffers()];
-	VkFence                      m_queue_fence_in_flight[cfg::get_number_of_buffers()];
-	uint32_t                     m_current_frame{0};
-	VkBuffer                     m_vertex_buffers[2];                                           // Temporary buffers for Astro_boy geometry
-	VkBuffer                     m_index_buffer{nullptr};                                       // Temporary buffers for Astro_boy geometry
-	VkDeviceMemory               m_vertex_buffer_memory[2];                                     // Temporary vertex memory buffers for Astro_boy geometry
-	VkDeviceMemory               m_index_buffer_memory{nullptr};                                // Temporary index memory buffers for Astro_boy geometry
-	std::vector<VkBuffer>        m_uniform_buffers{cfg::get_number_of_buffers()};               // Uniforms buffers for all frames in flight
-	std::vector<VkDeviceMemory>  m_uniform_buffers_memory{cfg::get_number_of_buffers()};        // Uniforms buffers memory for all frames in flight
-	VkImage                      m_msaa_color_image{nullptr};                                   // Color image used for unresolved MSAA RT
-	VkDeviceMemory               m_msaa_color_image_memory{nullptr};
-	VkImageView                  m_msaa_color_image_view{nullptr};
-	VkImage                      m_depth_image{nullptr};
-	VkImageView                  m_depth_image_view{nullptr};
-	VkDeviceMemory               m_depth_image_memory{nullptr};
-	VkImage                      m_texture_image{nullptr};
-	VkDeviceMemory               m_texture_image_memory{nullptr};
-	VkImageView                  m_texture_image_view{nullptr};
-	VkSampler                    m_texture_sampler{nullptr};
-	ror::BoundingBoxf            m_astroboy_bbox{};
-
+	VkCommandPool                 m_graphics_command_pool{nullptr};
+	VkCommandPool                 m_transfer_command_pool{nullptr};
+	VkCommandPool                 m_compute_command_pool{nullptr};
+	VkSemaphore                   m_image_available_semaphore[cfg::get_number_of_buffers()];
+	VkSemaphore                   m_render_finished_semaphore[cfg::get_number_of_buffers()];
+	VkSemaphore                   m_skinning_finished_semaphore[cfg::get_number_of_buffers()];        // Signalled by the compute queue, waited on by vertex input
+	VkFence                       m_queue_fence[cfg::get_number_of_buffers()];
+	VkFence                       m_queue_fence_in_flight[cfg::get_number_of_buffers()];
+	uint32_t                      m_current_frame{0};
+	VkBuffer                      m_vertex_buffers[2];                                           // Temporary buffers for Astro_boy geometry
+	VkBuffer                      m_index_buffer{nullptr};                                       // Temporary buffers for Astro_boy geometry
+	MemoryAllocation              m_vertex_buffer_memory[2];                                     // Temporary vertex memory buffers for Astro_boy geometry
+	MemoryAllocation              m_index_buffer_memory{};                                       // Temporary index memory buffers for Astro_boy geometry
+	VkBuffer                      m_skinned_vertex_buffers[cfg::get_number_of_buffers()];        // Astro boy positions and normals skinned by compute for every instance, one per frame in flight
+	MemoryAllocation              m_skinned_vertex_buffers_memory[cfg::get_number_of_buffers()];
+	VkPipeline                    m_skinning_pipeline{nullptr};
+	VkPipelineLayout              m_skinning_pipeline_layout{nullptr};
+	VkPipeline                    m_animation_pipeline{nullptr};                                 // Writes palettes from clip times when cfg::get_gpu_animation() is on
+	VkDescriptorSetLayout         m_skinning_descriptor_set_layout{nullptr};
+	std::vector<VkDescriptorSet>  m_skinning_descriptor_sets{cfg::get_number_of_buffers()};
+	UniformRing                   m_uniform_ring{};                                              // Uniform blocks of all frames in flight, bound with dynamic offsets
+	std::vector<uint32_t>         m_uniform_offsets{};                                           // Dynamic offset of the Uniforms block per frame in flight
+	std::vector<VkBuffer>         m_palette_buffers{cfg::get_number_of_buffers()};               // Skinning palettes of every instance back to back, per frame in flight
+	std::vector<MemoryAllocation> m_palette_buffers_memory{cfg::get_number_of_buffers()};
+	std::vector<VkBuffer>         m_instance_buffers{cfg::get_number_of_buffers()};              // SkinnedInstance per character, per frame in flight
+	std::vector<MemoryAllocation> m_instance_buffers_memory{cfg::get_number_of_buffers()};
+	std::vector<VkBuffer>         m_clip_time_buffers{cfg::get_number_of_buffers()};             // GpuAnimationInstance per character for animation.comp, per frame in flight
+	std::vector<MemoryAllocation> m_clip_time_buffers_memory{cfg::get_number_of_buffers()};
+	VkBuffer                      m_animation_tables_buffer{nullptr};                            // Skeleton and compressed clips, see gpu_animation.hpp
+	MemoryAllocation              m_animation_tables_buffer_memory{};
+	VkImage                       m_msaa_color_image{nullptr};                                   // Color image used for unresolved MSAA RT
+	MemoryAllocation              m_msaa_color_image_memory{};
+	VkImageView                   m_msaa_color_image_view{nullptr};
+	VkImage                       m_depth_image{nullptr};
+	VkImageView                   m_depth_image_view{nullptr};
+	MemoryAllocation              m_depth_image_memory{};
+	VkImage                       m_texture_image{nullptr};
+	MemoryAllocation              m_texture_image_memory{};
+	VkImageView                   m_texture_image_view{nullptr};
+	VkSampler                     m_texture_sampler{nullptr};
+	VkImage                       m_vat_image{nullptr};                                          // Baked astro boy crowd, see vertex_animation_texture.hpp
+	MemoryAllocation              m_vat_image_memory{};
+	VkImageView                   m_vat_image_view{nullptr};
+	VkBuffer                      m_vat_instance_buffer{nullptr};                                // Placement and time offset per baked character
+	MemoryAllocation              m_vat_instance_buffer_memory{};
+	VkPipeline                    m_vat_pipeline{nullptr};
+	VkPipelineLayout              m_vat_pipeline_layout{nullptr};
+	ror::VertexAnimationTexture   m_vertex_animation{};                                          // Layout of the baked texture, texels are dropped after upload
+	ror::BoundingBoxf             m_astroboy_bbox{};
+	ror::AnimationAsset           m_astro_boy_asset{};                                           // Mapped astro boy skeleton and clip, used in place
+	utl::JobSystem                m_animation_job_system{};                                      // One thread per hardware thread, runs the crowd animation, CPU skinning and the vertex animation bake
+	ror::AnimationSystem          m_astro_boy_animation{};                                       // Blends and evaluates astro boy, feeds joints_palette
+	uint32_t                      m_crowd_size{1};                                               // Skinned astro boys, see SceneSettings
+	GpuProfiler                   m_gpu_profiler{};                                              // Frame slots are image indices, uploads use the immediate slot
+	uint32_t                      m_scope_animation{0};
+	uint32_t                      m_scope_skinning{0};
+	uint32_t                      m_scope_main_pass{0};
+	uint32_t                      m_scope_skinned_draw{0};
+	uint32_t                      m_scope_crowd_draw{0};
+	uint32_t                      m_scope_upload{0};
+	bool                          m_profile_uploads{false};                                      // Transfer queue supports timestamps
+	bool                          m_calibrated_timestamps{false};                                // VK_EXT_calibrated_timestamps is enabled
+	MemoryAllocator               m_memory_allocator{};                                          // Every buffer and image is bound to memory from here
+	TransferManager               m_transfer_manager{};                                          // Batches uploads on the transfer queue
+	StagingPool                   m_staging_pool{};                                              // Source of every upload, recycled as batches retire
+	bool                          m_timeline_semaphores{false};                                  // Timeline semaphores are enabled, from core 1.2 or VK_KHR_timeline_semaphore
+	bool                          m_upload_profiled{false};                                      // Open upload batch has the upload scope begun
+	uint64_t                      m_profiled_upload{0};                                          // Upload batch whose scope isn't resolved yet, 0 if none
 };        // namespace vkd
 
 void PhysicalDevice::temp()
@@ -2462,17 +3374,31 @@ class Context
 		this->m_gpus[this->m_current_gpu]->recreate_swapchain();
 	}
 
-	FORCE_INLINE Context(GLFWwindow *a_window)
+	// A null a_window runs headless, rendering into offscreen images instead of a swapchain
+	FORCE_INLINE Context(GLFWwindow *a_window, const SceneSettings &a_settings = {})
 	{
+		utl::CpuZone zone{"startup"};
+
 		ast::GLTFModel mdl;
 		// mdl.load_from_file("/development/Vulkan-samples-assets/scenes/sponza-orig/Sponza01.gltf");
 		// mdl.load_from_file("/development/Vulkan-samples-assets/scenes/bonza/Bonza.gltf");
-		mdl.load_from_file("/personal/vulkaned/assets/plant-statue-smaller/plant-statue-basisu.gltf");
+		if (!a_settings.m_scene.empty())
+		{
+			utl::CpuZone load_zone{"load scene"};
+			mdl.load_from_file(a_settings.m_scene);
+		}
 
-		ror::glfw_camera_init(a_window);
+		if (a_window)
+			ror::glfw_camera_init(a_window);
+		else
+			ror::glfw_camera_init(static_cast<int>(cfg::get_headless_width()), static_cast<int>(cfg::get_headless_height()));
 
-		this->m_instances.emplace_back(std::make_shared<Instance>());
-		this->m_gpus[this->m_current_gpu] = std::make_shared<PhysicalDevice>(this->m_instances[this->m_current_instance]->get_handle(), a_window);
+		{
+			utl::CpuZone instance_zone{"create instance"};
+			this->m_instances.emplace_back(std::make_shared<Instance>());
+		}
+
+		this->m_gpus[this->m_current_gpu] = std::make_shared<PhysicalDevice>(this->m_instances[this->m_current_instance]->get_handle(), a_window, a_settings);
 	}
 
 	void draw_frame(bool a_update_animation)
@@ -2480,6 +3406,31 @@ class Context
 		this->m_gpus[this->m_current_gpu]->draw_frame(a_update_animation);
 	}
 
+	void wait_idle()
+	{
+		this->m_gpus[this->m_current_gpu]->wait_idle();
+	}
+
+	bool verify_gpu_skinning(float32_t a_tolerance = 1e-3f)
+	{
+		return this->m_gpus[this->m_current_gpu]->verify_gpu_skinning(a_tolerance);
+	}
+
+	double gpu_frame_time() const
+	{
+		return this->m_gpus.at(this->m_current_gpu)->gpu_frame_time();
+	}
+
+	const GpuProfiler &gpu_profiler() const
+	{
+		return this->m_gpus.at(this->m_current_gpu)->gpu_profiler();
+	}
+
+	VkDeviceSize device_memory_peak() const
+	{
+		return this->m_gpus.at(this->m_current_gpu)->device_memory_peak();
+	}
+
   protected:
   private:
 	std::vector<std::shared_ptr<Instance>>                        m_instances;
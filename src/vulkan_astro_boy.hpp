@@ -2,7 +2,6 @@
 #pragma once
 
 #include "assets/astroboy/astro_boy_geometry.hpp"
-#include "assets/astroboy/astro_boy_animation.hpp"
 #include "common.hpp"
 #include "roar.hpp"
 #include <array>
@@ -103,4 +102,61 @@ static auto get_astro_boy_vertex_bindings()
 	return bindings;
 }
 
+// Skinned positions and normals are pulled from a storage buffer by instance, only uvs come from a vertex buffer
+static auto get_astro_boy_skinned_vertex_attributes()
+{
+	std::array<VkVertexInputAttributeDescription, 1> attributes;
+
+	attributes[0].location = 2;        // UV, same location as in shader.vert
+	attributes[0].binding  = 0;
+	attributes[0].format   = VK_FORMAT_R32G32_SFLOAT;
+	attributes[0].offset   = 0;
+
+	return attributes;
+}
+
+static auto get_astro_boy_skinned_vertex_bindings()
+{
+	std::array<VkVertexInputBindingDescription, 1> bindings;
+
+	bindings[0].binding   = 0;
+	bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	bindings[0].stride    = sizeof(float32_t) * 2;
+
+	return bindings;
+}
+
+// Baked crowd reads uvs per vertex and its placement per instance, positions and normals come from the vertex animation texture
+static auto get_astro_boy_vat_vertex_attributes()
+{
+	std::array<VkVertexInputAttributeDescription, 2> attributes;
+
+	attributes[0].location = 2;        // UV
+	attributes[0].binding  = 0;
+	attributes[0].format   = VK_FORMAT_R32G32_SFLOAT;
+	attributes[0].offset   = 0;
+
+	attributes[1].location = 4;        // Placement, xyz offset and w time offset
+	attributes[1].binding  = 1;
+	attributes[1].format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+	attributes[1].offset   = 0;
+
+	return attributes;
+}
+
+static auto get_astro_boy_vat_vertex_bindings()
+{
+	std::array<VkVertexInputBindingDescription, 2> bindings;
+
+	bindings[0].binding   = 0;
+	bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	bindings[0].stride    = sizeof(float32_t) * 2;
+
+	bindings[1].binding   = 1;
+	bindings[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	bindings[1].stride    = sizeof(float32_t) * 4;
+
+	return bindings;
+}
+
 }        // namespace utl